@@ -114,18 +114,6 @@ Book* avl_search(AVLNode* root, const char* title) {
     if (cmp < 0) return avl_search(root->left, title);
     return avl_search(root->right, title);
 }
-/* Imprime os livros em ordem alfabética */
-void avl_print_inorder(AVLNode* root) {
-    if (!root) return;
-
-    avl_print_inorder(root->left);
-
-    Book* b = root->book;
-    printf("ISBN %I64d | \"%s\" | %s | %d\n",
-           (long long)b->isbn, b->title, b->author, b->year);
-
-    avl_print_inorder(root->right);
-}
 /* Libera toda a árvore da memória */
 void avl_free(AVLNode* root) {
     if (!root) return;
@@ -141,3 +129,18 @@ AVLNode* avl_build_from_list(BookNode* head) {
     }
     return root;
 }
+
+/* ---------- Iterador em ordem ---------- */
+
+void avl_iter_init(AvlIter* it, AVLNode* root) {
+    it->top = 0;
+    /* desce pela esquerda guardando o caminho */
+    for (AVLNode* n = root; n; n = n->left) it->stack[it->top++] = n;
+}
+
+Book* avl_iter_next(AvlIter* it) {
+    if (it->top == 0) return NULL;
+    AVLNode* n = it->stack[--it->top];
+    for (AVLNode* c = n->right; c; c = c->left) it->stack[it->top++] = c;
+    return n->book;
+}
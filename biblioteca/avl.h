@@ -16,8 +16,17 @@ AVLNode* avl_insert(AVLNode* root, Book* book);
 /* Busca por título */
 Book* avl_search(AVLNode* root, const char* title);
 
-/* Listagem ordenada */
-void avl_print_inorder(AVLNode* root);
+/* Listagem ordenada: percorre em ordem alfabética sem recursão.
+   A altura de uma AVL é no máximo ~1.44 log2(n), então 64 níveis bastam. */
+#define AVL_ITER_DEPTH 64
+
+typedef struct {
+    AVLNode* stack[AVL_ITER_DEPTH];
+    int top;
+} AvlIter;
+
+void  avl_iter_init(AvlIter* it, AVLNode* root);
+Book* avl_iter_next(AvlIter* it);   /* NULL quando acabou */
 
 /* Liberação de memória  */
 void avl_free(AVLNode* root);
@@ -0,0 +1,536 @@
+#include "banco.h"
+#include "plataforma.h"
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+/* página de mapa: próxima página do mapa + números das páginas de dados */
+#define DB_MAP_ENTRIES ((DB_PAYLOAD - 4) / 4)
+/* marca das páginas de mapa (o resto é o número da tabela) */
+#define DB_TAG_MAP 0x100
+/* cabeçalho: início do diretório e tamanho de cada entrada */
+#define DB_DIR_OFFSET 36
+#define DB_DIR_ENTRY  32
+
+static const char* table_names[DB_N_TABLES] = {
+    "livros", "usuarios", "emprestimos", "filas", "historico",
+    "hist_blocos", "hist_indice"
+};
+static const unsigned int table_recs[DB_N_TABLES] = {
+    DB_REC_BOOK, DB_REC_USER, DB_REC_LOAN, 0, DB_REC_HIST,
+    0, DB_REC_HIST_IDX
+};
+
+/* ---------- Funções auxiliares ---------- */
+
+static void* xmalloc(size_t n) {
+    void* p = malloc(n);
+    if (!p) {
+        printf("Erro: sem memória.\n");
+        exit(1);
+    }
+    return p;
+}
+
+static void* xrealloc(void* p, size_t n) {
+    void* q = realloc(p, n);
+    if (!q) {
+        printf("Erro: sem memória.\n");
+        exit(1);
+    }
+    return q;
+}
+
+static void push_page(unsigned int** arr, unsigned int* n, unsigned int* cap, unsigned int page) {
+    if (*n == *cap) {
+        *cap = *cap ? *cap * 2 : 16;
+        *arr = (unsigned int*)xrealloc(*arr, (size_t)*cap * sizeof(unsigned int));
+    }
+    (*arr)[(*n)++] = page;
+}
+
+/* ---------- CRC-32 ---------- */
+
+static unsigned int crc_table[256];
+static pthread_once_t crc_once = PTHREAD_ONCE_INIT;
+
+static void crc_init(void) {
+    for (unsigned int i = 0; i < 256; i++) {
+        unsigned int c = i;
+        for (int k = 0; k < 8; k++) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+        crc_table[i] = c;
+    }
+}
+
+static unsigned int crc32_of(const unsigned char* p, size_t n) {
+    pthread_once(&crc_once, crc_init);
+    unsigned int crc = 0xFFFFFFFFu;
+    for (size_t i = 0; i < n; i++) crc = crc_table[(crc ^ p[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+/* ---------- Páginas ---------- */
+
+/* Lê uma página inteira e confere o CRC (todo acesso é direto no
+   descritor, sem o buffer do stdio) */
+static int page_load(FILE* f, unsigned int page, unsigned char* out) {
+    if (plat_pread(plat_fileno(f), out, DB_PAGE_SIZE, (long long)page * DB_PAGE_SIZE) != 0) return 0;
+    return le_get32(out) == crc32_of(out + 4, DB_PAGE_SIZE - 4);
+}
+
+static int page_read(Db* db, unsigned int page, unsigned char* out) {
+    if (page < 2 || page >= db->n_pages) return 0;
+    return page_load(db->f, page, out);
+}
+
+/* Fecha a página (CRC no começo) e grava */
+static int page_write(Db* db, unsigned int page, unsigned char* p) {
+    le_put32(p, crc32_of(p + 4, DB_PAGE_SIZE - 4));
+    return plat_pwrite(plat_fileno(db->f), p, DB_PAGE_SIZE, (long long)page * DB_PAGE_SIZE) == 0;
+}
+
+/* Página para gravar: uma livre, ou uma nova no fim do arquivo */
+static unsigned int page_alloc(Db* db) {
+    if (db->n_free > 0) return db->free_pages[--db->n_free];
+    return db->n_pages++;
+}
+
+static void page_release(Db* db, unsigned int page) {
+    push_page(&db->released, &db->n_released, &db->cap_released, page);
+}
+
+/* ---------- Cabeçalho ---------- */
+
+static int header_write(Db* db, int slot) {
+    unsigned char* p = (unsigned char*)calloc(1, DB_PAGE_SIZE);
+    if (!p) return 0;
+    le_put32(p + 4, DB_MAGIC);
+    le_put32(p + 8, DB_VERSION);
+    le_put32(p + 12, DB_PAGE_SIZE);
+    le_put64(p + 16, db->generation);
+    le_put32(p + 24, db->n_pages);
+    le_put32(p + 28, db->journal_seg);
+    le_put32(p + 32, DB_N_TABLES);
+    for (int i = 0; i < DB_N_TABLES; i++) {
+        unsigned char* e = p + DB_DIR_OFFSET + i * DB_DIR_ENTRY;
+        DbTable* t = &db->tables[i];
+        memcpy(e, t->name, sizeof(t->name));
+        le_put32(e + 12, t->rec_size);
+        le_put64(e + 16, t->bytes);
+        le_put32(e + 24, t->map_page);
+    }
+    int ok = page_write(db, (unsigned int)slot, p);
+    free(p);
+    return ok;
+}
+
+/* Lê um cabeçalho; 1 se é válido */
+static int header_read(FILE* f, int slot, unsigned char* p) {
+    if (!page_load(f, (unsigned int)slot, p)) return 0;
+    return le_get32(p + 4) == DB_MAGIC && le_get32(p + 8) == DB_VERSION &&
+           le_get32(p + 12) == DB_PAGE_SIZE;
+}
+
+/* Lê a cadeia do mapa de uma tabela */
+static int map_load(Db* db, DbTable* t) {
+    unsigned long long chunks = (t->bytes + DB_PAYLOAD - 1) / DB_PAYLOAD;
+    unsigned char* p = (unsigned char*)xmalloc(DB_PAGE_SIZE);
+    unsigned int page = t->map_page;
+    int ok = 1;
+
+    while (ok && t->n_pages < chunks) {
+        if (page == 0 || !page_read(db, page, p) || le_get32(p + 4) != DB_TAG_MAP + (unsigned int)(t - db->tables)) {
+            ok = 0;
+            break;
+        }
+        push_page(&t->map_pages, &t->n_map, &t->cap_map, page);
+        const unsigned char* body = p + DB_PAGE_HEADER;
+        for (unsigned int i = 0; i < DB_MAP_ENTRIES && t->n_pages < chunks; i++) {
+            push_page(&t->pages, &t->n_pages, &t->cap_pages, le_get32(body + 4 + i * 4));
+        }
+        page = le_get32(body);
+    }
+    free(p);
+    return ok;
+}
+
+static void tables_reset(Db* db) {
+    for (int i = 0; i < DB_N_TABLES; i++) {
+        DbTable* t = &db->tables[i];
+        memset(t, 0, sizeof(*t));
+        snprintf(t->name, sizeof(t->name), "%s", table_names[i]);
+        t->rec_size = table_recs[i];
+    }
+}
+
+static void tx_discard(DbTable* t) {
+    if (t->dirty) {
+        for (unsigned int i = 0; i < t->cap_dirty; i++) free(t->dirty[i]);
+        free(t->dirty);
+    }
+    t->dirty = NULL;
+    t->cap_dirty = 0;
+    t->changed = 0;
+}
+
+/* ---------- Abrir / criar ---------- */
+
+int db_open(Db* db, const char* path) {
+    memset(db, 0, sizeof(*db));
+    snprintf(db->path, sizeof(db->path), "%s", path);
+    tables_reset(db);
+
+    db->f = fopen(path, "r+b");
+    if (!db->f) return 0;
+
+    /* vale o cabeçalho íntegro de maior geração */
+    unsigned char* h[2];
+    int valid[2];
+    for (int s = 0; s < 2; s++) {
+        h[s] = (unsigned char*)calloc(1, DB_PAGE_SIZE);
+        if (!h[s]) {
+            printf("Erro: sem memória.\n");
+            exit(1);
+        }
+        valid[s] = header_read(db->f, s, h[s]);
+    }
+    int slot = -1;
+    if (valid[0]) slot = 0;
+    if (valid[1] && (slot < 0 || le_get64(h[1] + 16) > le_get64(h[0] + 16))) slot = 1;
+
+    if (slot < 0) {
+        /* nenhum cabeçalho: banco criado e nunca gravado, ou estragado */
+        int empty = 1;
+        for (int s = 0; s < 2 && empty; s++) {
+            for (int i = 0; i < DB_PAGE_SIZE; i++) if (h[s][i]) { empty = 0; break; }
+        }
+        free(h[0]);
+        free(h[1]);
+        db_close(db);
+        return empty ? 0 : -1;
+    }
+
+    int ok = 1;
+    const unsigned char* p = h[slot];
+    db->header_slot = slot;
+    db->generation = le_get64(p + 16);
+    db->n_pages = le_get32(p + 24);
+    db->journal_seg = le_get32(p + 28);
+    unsigned int n_tables = le_get32(p + 32);
+
+    /* tabelas são achadas pelo nome; as que faltam ficam vazias */
+    for (unsigned int i = 0; i < n_tables && DB_DIR_OFFSET + (i + 1) * DB_DIR_ENTRY <= DB_PAGE_SIZE; i++) {
+        const unsigned char* e = p + DB_DIR_OFFSET + i * DB_DIR_ENTRY;
+        for (int k = 0; k < DB_N_TABLES; k++) {
+            DbTable* t = &db->tables[k];
+            if (strncmp((const char*)e, t->name, sizeof(t->name)) != 0) continue;
+            if (le_get32(e + 12) != t->rec_size) {
+                db->bad_tables++;
+                break;
+            }
+            t->bytes = le_get64(e + 16);
+            t->map_page = le_get32(e + 24);
+            if (!map_load(db, t)) ok = 0;
+        }
+    }
+    free(h[0]);
+    free(h[1]);
+
+    if (!ok) {
+        db_close(db);
+        return -1;
+    }
+
+    /* páginas que o cabeçalho atual não usa estão livres */
+    unsigned char* used = (unsigned char*)calloc(db->n_pages ? db->n_pages : 1, 1);
+    if (!used) {
+        printf("Erro: sem memória.\n");
+        exit(1);
+    }
+    if (db->n_pages > 0) used[0] = 1;
+    if (db->n_pages > 1) used[1] = 1;
+    for (int k = 0; k < DB_N_TABLES; k++) {
+        DbTable* t = &db->tables[k];
+        for (unsigned int i = 0; i < t->n_pages; i++) if (t->pages[i] < db->n_pages) used[t->pages[i]] = 1;
+        for (unsigned int i = 0; i < t->n_map; i++) if (t->map_pages[i] < db->n_pages) used[t->map_pages[i]] = 1;
+    }
+    for (unsigned int pg = db->n_pages; pg > 2; pg--) {
+        if (!used[pg - 1]) push_page(&db->free_pages, &db->n_free, &db->cap_free, pg - 1);
+    }
+    free(used);
+    return 1;
+}
+
+int db_create(Db* db, const char* path) {
+    memset(db, 0, sizeof(*db));
+    snprintf(db->path, sizeof(db->path), "%s", path);
+    tables_reset(db);
+
+    db->f = fopen(path, "w+b");
+    if (!db->f) return 0;
+    db->n_pages = 2;
+    db->generation = 0;
+    db->journal_seg = 1;
+
+    /* sem cabeçalho válido até o primeiro db_commit: um banco criado e
+       nunca gravado é tratado como inexistente */
+    unsigned char* zero = (unsigned char*)calloc(2, DB_PAGE_SIZE);
+    if (!zero) return 0;
+    int ok = plat_pwrite(plat_fileno(db->f), zero, 2 * DB_PAGE_SIZE, 0) == 0 &&
+             plat_fsync(plat_fileno(db->f)) == 0;
+    free(zero);
+    if (ok) plat_sync_dir();
+    if (!ok) {
+        db_close(db);
+        remove(path);
+        return 0;
+    }
+    db->header_slot = 0;
+    return 1;
+}
+
+void db_close(Db* db) {
+    for (int i = 0; i < DB_N_TABLES; i++) {
+        DbTable* t = &db->tables[i];
+        tx_discard(t);
+        free(t->pages);
+        free(t->map_pages);
+        t->pages = t->map_pages = NULL;
+        t->n_pages = t->n_map = 0;
+    }
+    free(db->free_pages);
+    free(db->released);
+    db->free_pages = db->released = NULL;
+    db->n_free = db->n_released = 0;
+    if (db->f) fclose(db->f);
+    db->f = NULL;
+}
+
+/* ---------- Leitura ---------- */
+
+unsigned long long db_table_size(Db* db, int table) {
+    return db->tables[table].bytes;
+}
+
+long db_table_records(Db* db, int table) {
+    DbTable* t = &db->tables[table];
+    return t->rec_size ? (long)(t->bytes / t->rec_size) : 0;
+}
+
+void db_reader_open(Db* db, int table, DbReader* r) {
+    r->db = db;
+    r->t = &db->tables[table];
+    r->pos = 0;
+    r->chunk = 0;
+    r->loaded = 0;
+    r->error = 0;
+}
+
+void db_reader_seek(DbReader* r, unsigned long long pos) {
+    r->pos = pos;
+}
+
+size_t db_read(DbReader* r, void* out, size_t n) {
+    unsigned char* dst = (unsigned char*)out;
+    size_t done = 0;
+    unsigned char page[DB_PAGE_SIZE];
+
+    while (done < n && r->pos < r->t->bytes && !r->error) {
+        unsigned int chunk = (unsigned int)(r->pos / DB_PAYLOAD);
+        if (!r->loaded || chunk != r->chunk) {
+            unsigned int tag = (unsigned int)(r->t - r->db->tables);
+            if (chunk >= r->t->n_pages || !page_read(r->db, r->t->pages[chunk], page) ||
+                le_get32(page + 4) != tag || le_get32(page + 8) != chunk) {
+                r->db->bad_pages++;
+                r->error = 1;
+                break;
+            }
+            memcpy(r->buf, page + DB_PAGE_HEADER, DB_PAYLOAD);
+            r->chunk = chunk;
+            r->loaded = 1;
+        }
+        size_t in_page = (size_t)(r->pos % DB_PAYLOAD);
+        size_t take = DB_PAYLOAD - in_page;
+        if (take > n - done) take = n - done;
+        if (take > r->t->bytes - r->pos) take = (size_t)(r->t->bytes - r->pos);
+        memcpy(dst + done, r->buf + in_page, take);
+        done += take;
+        r->pos += take;
+    }
+    return done;
+}
+
+/* ---------- Gravação ---------- */
+
+/* Pedaço idx da tabela para alterar (cópia do que está no arquivo) */
+static unsigned char* tx_chunk(Db* db, DbTable* t, unsigned int idx) {
+    if (idx >= t->cap_dirty) {
+        unsigned int nc = t->cap_dirty ? t->cap_dirty : 16;
+        while (nc <= idx) nc *= 2;
+        t->dirty = (unsigned char**)xrealloc(t->dirty, (size_t)nc * sizeof(unsigned char*));
+        memset(t->dirty + t->cap_dirty, 0, (size_t)(nc - t->cap_dirty) * sizeof(unsigned char*));
+        t->cap_dirty = nc;
+    }
+    if (!t->dirty[idx]) {
+        unsigned char* c = (unsigned char*)calloc(1, DB_PAYLOAD);
+        if (!c) {
+            printf("Erro: sem memória.\n");
+            exit(1);
+        }
+        if (idx < t->n_pages) {
+            unsigned char page[DB_PAGE_SIZE];
+            if (!page_read(db, t->pages[idx], page)) {
+                free(c);
+                return NULL;
+            }
+            memcpy(c, page + DB_PAGE_HEADER, DB_PAYLOAD);
+        }
+        t->dirty[idx] = c;
+    }
+    t->changed = 1;
+    return t->dirty[idx];
+}
+
+int db_write_at(Db* db, int table, unsigned long long off, const void* data, size_t len) {
+    DbTable* t = &db->tables[table];
+    const unsigned char* src = (const unsigned char*)data;
+    size_t done = 0;
+
+    /* escrita depois do fim: o resto do último pedaço pode ter sobras de
+       antes de um corte; os pedaços seguintes já nascem zerados */
+    if (off > t->bytes && t->bytes % DB_PAYLOAD != 0) {
+        unsigned char* c = tx_chunk(db, t, (unsigned int)(t->bytes / DB_PAYLOAD));
+        if (!c) return 0;
+        size_t from = (size_t)(t->bytes % DB_PAYLOAD);
+        unsigned long long gap = off - t->bytes;
+        size_t n = DB_PAYLOAD - from;
+        if (gap < n) n = (size_t)gap;
+        memset(c + from, 0, n);
+    }
+
+    while (done < len) {
+        unsigned long long pos = off + done;
+        unsigned char* c = tx_chunk(db, t, (unsigned int)(pos / DB_PAYLOAD));
+        if (!c) return 0;
+        size_t in_page = (size_t)(pos % DB_PAYLOAD);
+        size_t take = DB_PAYLOAD - in_page;
+        if (take > len - done) take = len - done;
+        memcpy(c + in_page, src + done, take);
+        done += take;
+    }
+    if (off + len > t->bytes) t->bytes = off + len;
+    t->changed = 1;
+    return 1;
+}
+
+int db_truncate(Db* db, int table, unsigned long long len) {
+    DbTable* t = &db->tables[table];
+    if (len >= t->bytes) return 1;
+
+    unsigned int keep = (unsigned int)((len + DB_PAYLOAD - 1) / DB_PAYLOAD);
+    for (unsigned int i = keep; i < t->n_pages; i++) page_release(db, t->pages[i]);
+    if (t->n_pages > keep) t->n_pages = keep;
+    for (unsigned int i = keep; i < t->cap_dirty; i++) {
+        free(t->dirty[i]);
+        t->dirty[i] = NULL;
+    }
+    t->bytes = len;
+    t->changed = 1;
+    return 1;
+}
+
+int db_replace(Db* db, int table, const void* data, size_t len) {
+    if (!db_truncate(db, table, 0)) return 0;
+    return len == 0 || db_write_at(db, table, 0, data, len);
+}
+
+/* Grava os pedaços alterados em páginas novas e refaz o mapa da tabela */
+static int tx_flush_table(Db* db, DbTable* t, unsigned char* page) {
+    unsigned int tag = (unsigned int)(t - db->tables);
+    unsigned int chunks = (unsigned int)((t->bytes + DB_PAYLOAD - 1) / DB_PAYLOAD);
+
+    for (unsigned int idx = 0; idx < chunks; idx++) {
+        /* um buraco (escrita depois do fim) vira página de zeros */
+        int is_new = idx >= t->n_pages;
+        if (!is_new && (idx >= t->cap_dirty || !t->dirty[idx])) continue;
+        unsigned char* c = tx_chunk(db, t, idx);
+        if (!c) return 0;
+
+        unsigned long long used = t->bytes - (unsigned long long)idx * DB_PAYLOAD;
+        memset(page, 0, DB_PAGE_SIZE);
+        le_put32(page + 4, tag);
+        le_put32(page + 8, idx);
+        le_put32(page + 12, (unsigned int)(used < DB_PAYLOAD ? used : DB_PAYLOAD));
+        memcpy(page + DB_PAGE_HEADER, c, DB_PAYLOAD);
+
+        unsigned int pg = page_alloc(db);
+        if (!page_write(db, pg, page)) return 0;
+        if (is_new) {
+            push_page(&t->pages, &t->n_pages, &t->cap_pages, pg);
+        } else {
+            page_release(db, t->pages[idx]);
+            t->pages[idx] = pg;
+        }
+    }
+
+    /* mapa novo inteiro: 4 bytes por página da tabela */
+    for (unsigned int i = 0; i < t->n_map; i++) page_release(db, t->map_pages[i]);
+    t->n_map = 0;
+    unsigned int n_map = (t->n_pages + DB_MAP_ENTRIES - 1) / DB_MAP_ENTRIES;
+    for (unsigned int i = 0; i < n_map; i++) {
+        push_page(&t->map_pages, &t->n_map, &t->cap_map, page_alloc(db));
+    }
+    for (unsigned int i = 0; i < n_map; i++) {
+        memset(page, 0, DB_PAGE_SIZE);
+        le_put32(page + 4, DB_TAG_MAP + tag);
+        le_put32(page + 8, i);
+        unsigned char* body = page + DB_PAGE_HEADER;
+        le_put32(body, i + 1 < n_map ? t->map_pages[i + 1] : 0);
+        unsigned int first = i * DB_MAP_ENTRIES;
+        unsigned int count = t->n_pages - first;
+        if (count > DB_MAP_ENTRIES) count = DB_MAP_ENTRIES;
+        le_put32(page + 12, 4 + count * 4);
+        for (unsigned int k = 0; k < count; k++) le_put32(body + 4 + k * 4, t->pages[first + k]);
+        if (!page_write(db, t->map_pages[i], page)) return 0;
+    }
+    t->map_page = n_map ? t->map_pages[0] : 0;
+    return 1;
+}
+
+int db_commit(Db* db, unsigned int journal_seg) {
+    if (!db->f) return 0;
+
+    unsigned char* page = (unsigned char*)xmalloc(DB_PAGE_SIZE);
+    int ok = 1;
+    for (int i = 0; ok && i < DB_N_TABLES; i++) {
+        if (db->tables[i].changed) ok = tx_flush_table(db, &db->tables[i], page);
+    }
+    free(page);
+
+    /* páginas no disco antes do cabeçalho que aponta para elas */
+    if (ok) ok = plat_fsync(plat_fileno(db->f)) == 0;
+    if (ok) {
+        db->generation++;
+        db->journal_seg = journal_seg;
+        int slot = 1 - db->header_slot;
+        ok = header_write(db, slot) && plat_fsync(plat_fileno(db->f)) == 0;
+        if (ok) db->header_slot = slot;
+    }
+
+    if (!ok) {
+        /* volta ao que está no disco */
+        char path[64];
+        snprintf(path, sizeof(path), "%s", db->path);
+        db_close(db);
+        db_open(db, path);
+        return 0;
+    }
+
+    for (int i = 0; i < DB_N_TABLES; i++) tx_discard(&db->tables[i]);
+    /* o que esta gravação liberou pode ser usado pela próxima */
+    for (unsigned int i = 0; i < db->n_released; i++) {
+        push_page(&db->free_pages, &db->n_free, &db->cap_free, db->released[i]);
+    }
+    db->n_released = 0;
+    return 1;
+}
@@ -0,0 +1,148 @@
+#ifndef BANCO_H
+#define BANCO_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+/* Banco em um arquivo só (biblioteca.db), dividido em páginas de 4 KB.
+
+   - Páginas 0 e 1: cabeçalhos alternados (versão, geração, segmento do
+     diário e diretório das tabelas). Vale o de maior geração com CRC ok.
+   - Cada tabela (livros, usuários, empréstimos, filas, histórico) é uma
+     sequência de bytes espalhada em páginas de dados; um mapa (cadeia de
+     páginas) diz em que página está cada pedaço.
+   - Toda página tem CRC-32 e os campos são little-endian de tamanho fixo,
+     então o arquivo não depende do compilador nem da máquina.
+
+   Gravação por cópia (shadow paging): páginas alteradas vão para páginas
+   livres, depois os mapas, fsync, e por último o outro cabeçalho. Uma queda
+   no meio deixa o cabeçalho antigo valendo, inteiro. */
+
+#define BANCO_FILE      "biblioteca.db"
+#define DB_PAGE_SIZE    4096
+#define DB_PAGE_HEADER  16
+#define DB_PAYLOAD      (DB_PAGE_SIZE - DB_PAGE_HEADER)
+#define DB_MAGIC        0x42444942   /* "BIDB" */
+#define DB_VERSION      1
+
+/* Tamanho de cada registro gravado (little-endian, sem padding) */
+#define DB_REC_BOOK     224   /* isbn 8, título 120, autor 80, 4 x int 4 */
+#define DB_REC_USER     164   /* id 4, nome 80, email 80 */
+#define DB_REC_LOAN     12    /* user_id 4, isbn 8 */
+#define DB_REC_HIST     24    /* tipo 4, user_id 4, isbn 8, instante 8 (tabela antiga) */
+#define DB_REC_HIST_IDX 16    /* posição 8, bytes 4, primeiro instante 4 */
+
+typedef enum {
+    DB_BOOKS = 0,
+    DB_USERS,
+    DB_LOANS,
+    DB_QUEUES,
+    DB_HISTORY,          /* histórico em registros fixos (só para migrar) */
+    DB_HIST_BLOCKS,      /* histórico em blocos compactos (historico.h) */
+    DB_HIST_INDEX,       /* um registro por bloco, para achar cada um */
+    DB_N_TABLES
+} DbTableId;
+
+/* Entrada do diretório de tabelas */
+typedef struct {
+    char name[12];
+    unsigned int rec_size;        /* 0 = sequência de bytes sem registros */
+    unsigned long long bytes;     /* tamanho do conteúdo */
+    unsigned int map_page;        /* primeira página do mapa (0 = vazia) */
+
+    /* em memória */
+    unsigned int* pages;          /* página de cada pedaço da tabela */
+    unsigned int n_pages, cap_pages;
+    unsigned int* map_pages;      /* páginas do mapa (para liberar) */
+    unsigned int n_map, cap_map;
+
+    /* transação em andamento */
+    unsigned char** dirty;        /* pedaços alterados (NULL = igual) */
+    unsigned int cap_dirty;
+    int changed;
+} DbTable;
+
+typedef struct {
+    FILE* f;
+    char path[64];
+    unsigned long long generation;
+    int header_slot;              /* página do cabeçalho atual (0 ou 1) */
+    unsigned int n_pages;         /* páginas no arquivo */
+    unsigned int journal_seg;     /* primeiro segmento do diário a reaplicar */
+    DbTable tables[DB_N_TABLES];
+
+    unsigned int* free_pages;     /* livres para a próxima gravação */
+    unsigned int n_free, cap_free;
+    unsigned int* released;       /* liberadas nesta gravação (só na próxima) */
+    unsigned int n_released, cap_released;
+
+    /* problemas achados na leitura (quem abriu decide como avisar) */
+    unsigned int bad_tables;      /* tabelas com registro de outro tamanho (ignoradas) */
+    unsigned int bad_pages;       /* páginas corrompidas (a leitura da tabela para nelas) */
+} Db;
+
+/* Leitura de uma tabela em sequência, página a página */
+typedef struct {
+    Db* db;
+    DbTable* t;
+    unsigned long long pos;
+    unsigned int chunk;           /* pedaço que está em buf */
+    unsigned char buf[DB_PAYLOAD];
+    int loaded;
+    int error;                    /* CRC errado ou erro de leitura */
+} DbReader;
+
+/* Abre o banco: 1 = ok, 0 = não existe (ou nunca foi gravado),
+   -1 = estragado (nenhum cabeçalho ou mapa válido) */
+int  db_open(Db* db, const char* path);
+/* Cria um banco vazio (substitui o que houver) */
+int  db_create(Db* db, const char* path);
+void db_close(Db* db);
+
+/* ---------- Leitura ---------- */
+
+unsigned long long db_table_size(Db* db, int table);
+long db_table_records(Db* db, int table);   /* bytes / rec_size */
+void db_reader_open(Db* db, int table, DbReader* r);
+/* Lê até n bytes; retorna quantos leu (menos = fim ou erro) */
+size_t db_read(DbReader* r, void* out, size_t n);
+/* Pula para a posição 'pos' da tabela */
+void db_reader_seek(DbReader* r, unsigned long long pos);
+
+/* ---------- Gravação (transação até db_commit) ---------- */
+
+/* Substitui o conteúdo inteiro */
+int  db_replace(Db* db, int table, const void* data, size_t len);
+/* Escreve em uma posição (crescendo a tabela se passar do fim) */
+int  db_write_at(Db* db, int table, unsigned long long off, const void* data, size_t len);
+/* Corta a tabela em len bytes */
+int  db_truncate(Db* db, int table, unsigned long long len);
+
+/* Grava as páginas alteradas e o novo cabeçalho (com o segmento do diário
+   que passa a valer). 1 = ok; se falhar, o banco é reaberto como estava. */
+int  db_commit(Db* db, unsigned int journal_seg);
+
+/* ---------- Little-endian ---------- */
+
+static inline void le_put32(unsigned char* p, unsigned int v) {
+    p[0] = (unsigned char)v;
+    p[1] = (unsigned char)(v >> 8);
+    p[2] = (unsigned char)(v >> 16);
+    p[3] = (unsigned char)(v >> 24);
+}
+
+static inline unsigned int le_get32(const unsigned char* p) {
+    return (unsigned int)p[0] | ((unsigned int)p[1] << 8) |
+           ((unsigned int)p[2] << 16) | ((unsigned int)p[3] << 24);
+}
+
+static inline void le_put64(unsigned char* p, unsigned long long v) {
+    le_put32(p, (unsigned int)v);
+    le_put32(p + 4, (unsigned int)(v >> 32));
+}
+
+static inline unsigned long long le_get64(const unsigned char* p) {
+    return (unsigned long long)le_get32(p) | ((unsigned long long)le_get32(p + 4) << 32);
+}
+
+#endif
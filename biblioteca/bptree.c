@@ -10,8 +10,8 @@ static BPNode* bp_new(int leaf) {
     n->nkeys = 0; /* começa sem chaves */
     n->next = NULL; /* usado só em folhas */
     // zera filhos e valores
-    for (int i = 0; i < BP_ORDER; i++) n->child[i] = NULL;
-    for (int i = 0; i < BP_ORDER - 1; i++) n->vals[i] = NULL;
+    for (int i = 0; i <= BP_ORDER; i++) n->child[i] = NULL;
+    for (int i = 0; i < BP_ORDER; i++) n->vals[i] = NULL;
     return n;
 }
 
@@ -199,10 +199,10 @@ void bpt_insert(BPTree* t, long long isbn, Book* book) {
         free(p);
 
         /* abre espaço no pai */
-        for (int j = parent->nkeys; j >= idx; j--) {
+        for (int j = parent->nkeys - 1; j >= idx; j--) {
             parent->keys[j + 1] = parent->keys[j];
         }
-        for (int j = parent->nkeys + 1; j >= idx + 1; j--) {
+        for (int j = parent->nkeys; j >= idx + 1; j--) {
             parent->child[j + 1] = parent->child[j];
         }
         parent->keys[idx] = promote;
@@ -224,32 +224,32 @@ void bpt_insert(BPTree* t, long long isbn, Book* book) {
     ps_free(st);
 }
 
-void bpt_print_range(BPTree* t, long long a, long long b) {
-    if (!t || !t->root) return;
+/* Começa a percorrer [a, b] pela folha onde 'a' estaria */
+void bpt_range(BPTree* t, long long a, long long b, BptIter* it) {
     if (a > b) { long long tmp = a; a = b; b = tmp; }
+    it->leaf = (t && t->root) ? find_leaf(t->root, a) : NULL;
+    it->i = 0;
+    it->lo = a;
+    it->hi = b;
+}
 
-    BPNode* leaf = find_leaf(t->root, a);
-    printf("\n---- ISBN no intervalo [%I64d, %I64d] ----\n", (long long)a, (long long)b);
-
-    int printed = 0;
-    while (leaf) {
-        for (int i = 0; i < leaf->nkeys; i++) {
-            long long k = leaf->keys[i];
-            if (k < a) continue;
-            if (k > b) {
-                if (!printed) printf("(nenhum)\n");
-                return;
-            }
-            Book* bk = leaf->vals[i];
-            if (bk) {
-                printf("%I64d | \"%s\" | %s | %d\n",
-                       (long long)bk->isbn, bk->title, bk->author, bk->year);
-                printed = 1;
+Book* bpt_range_next(BptIter* it) {
+    while (it->leaf) {
+        while (it->i < it->leaf->nkeys) {
+            long long k = it->leaf->keys[it->i];
+            Book* bk = it->leaf->vals[it->i];
+            it->i++;
+            if (k < it->lo) continue;
+            if (k > it->hi) {
+                it->leaf = NULL;   /* folhas em ordem: acabou o intervalo */
+                return NULL;
             }
+            if (bk) return bk;
         }
-        leaf = leaf->next;
+        it->leaf = it->leaf->next;
+        it->i = 0;
     }
-    if (!printed) printf("(nenhum)\n");
+    return NULL;
 }
 /* Cria a B+ Tree a partir de uma lista */
 BPTree* bpt_build_from_list(BookNode* books) {
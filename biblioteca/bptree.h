@@ -9,12 +9,14 @@
 typedef struct BPNode {
     int leaf;
     int nkeys;
-    long long keys[BP_ORDER - 1];
+    /* uma posição a mais: o nó fica cheio demais por um instante, entre
+       receber a chave e ser dividido */
+    long long keys[BP_ORDER];
 
-    struct BPNode* child[BP_ORDER];  /* internos */
-    Book* vals[BP_ORDER - 1];        /* folhas */
+    struct BPNode* child[BP_ORDER + 1];  /* internos */
+    Book* vals[BP_ORDER];                /* folhas */
 
-    struct BPNode* next;             /* folhas encadeadas */
+    struct BPNode* next;                 /* folhas encadeadas */
 } BPNode;
 
 typedef struct {
@@ -29,8 +31,15 @@ void    bpt_free(BPTree* t);
 Book*   bpt_search(BPTree* t, long long isbn);
 void    bpt_insert(BPTree* t, long long isbn, Book* book);
 
-/* Mostra todos os livros com ISBN entre a e b */
-void    bpt_print_range(BPTree* t, long long a, long long b);
+/* Livros com ISBN entre a e b, em ordem, andando pelas folhas encadeadas */
+typedef struct {
+    BPNode* leaf;
+    int i;
+    long long lo, hi;
+} BptIter;
+
+void    bpt_range(BPTree* t, long long a, long long b, BptIter* it);
+Book*   bpt_range_next(BptIter* it);   /* NULL quando acabou */
 
 /* Cria a B+ Tree a partir da lista de livros */
 BPTree* bpt_build_from_list(BookNode* books);
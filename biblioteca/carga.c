@@ -0,0 +1,387 @@
+/* Gerador de carga para o modo servidor (biblioteca.exe --servidor).
+
+   Abre várias conexões, cada uma numa thread, e mantém em cada uma um
+   número fixo de pedidos em voo (pipelining) pelo tempo pedido. No fim
+   mostra a vazão e os percentis da latência (do envio do pedido até a
+   chegada da resposta).
+
+   Uso: carga.exe [-c conexões] [-p em voo] [-s segundos] [-m leitura|misto]
+                  [-u usuário] endereço */
+
+#include <stdio.h>
+
+#ifdef _WIN32
+
+int main(void) {
+    printf("Gerador de carga indisponível no Windows.\n");
+    return 1;
+}
+
+#else
+
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <ctype.h>
+#include <time.h>
+#include <errno.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "protocolo.h"
+#include "resultado.h"
+#include "rede.h"
+
+#define LOAD_SAMPLE   PR_MAX_HITS   /* ISBNs sorteados nos pedidos */
+#define LOAD_REQ_MAX  (PR_LEN_BYTES + PR_HEAD_BYTES + 2 + 64)
+#define LOAD_IN_BUF   (1 << 16)
+
+typedef struct {
+    const char* addr;
+    int conns;
+    int depth;
+    double secs;
+    int mixed;                 /* 0 = só leitura; 1 = com empréstimos/devoluções */
+    int user_id;
+    long long isbns[LOAD_SAMPLE];
+    int n_isbns;
+    char word[64];             /* palavra para as buscas ("" = sem busca) */
+} Load;
+
+typedef struct {
+    const Load* cfg;
+    pthread_t th;
+    int fd;
+    unsigned int seed;
+    float* lat;                /* ms, uma por resposta */
+    long n_lat, cap_lat;
+    long ok, other, bad;
+    int failed;
+} Worker;
+
+static double now_secs(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (double)t.tv_sec + (double)t.tv_nsec / 1e9;
+}
+
+static void* xmalloc(size_t n) {
+    void* p = malloc(n);
+    if (!p) {
+        printf("Erro: sem memória.\n");
+        exit(1);
+    }
+    return p;
+}
+
+static int write_all(int fd, const unsigned char* p, size_t n) {
+    while (n > 0) {
+        ssize_t w = write(fd, p, n);
+        if (w < 0 && errno == EINTR) continue;
+        if (w <= 0) return 0;
+        p += w;
+        n -= (size_t)w;
+    }
+    return 1;
+}
+
+/* Lê um quadro inteiro (conexão de controle); retorna o tamanho do corpo */
+static long read_frame(int fd, unsigned char* buf, size_t cap) {
+    size_t got = 0, need = PR_LEN_BYTES;
+    while (got < need) {
+        ssize_t r = read(fd, buf + got, need - got);
+        if (r < 0 && errno == EINTR) continue;
+        if (r <= 0) return -1;
+        got += (size_t)r;
+        if (got == PR_LEN_BYTES) {
+            need = PR_LEN_BYTES + le_get32(buf);
+            if (need > cap) return -1;
+        }
+    }
+    return (long)(need - PR_LEN_BYTES);
+}
+
+/* ---------- Pedidos ---------- */
+
+static size_t req_head(unsigned char* p, int op, unsigned int id, size_t args) {
+    le_put32(p, (unsigned int)(PR_HEAD_BYTES + args));
+    p[4] = (unsigned char)op;
+    le_put32(p + 5, id);
+    return PR_LEN_BYTES + PR_HEAD_BYTES;
+}
+
+static size_t req_user_isbn(unsigned char* p, int op, unsigned int id, int user_id, long long isbn) {
+    size_t n = req_head(p, op, id, 12);
+    le_put32(p + n, (unsigned int)user_id);
+    le_put64(p + n + 4, (unsigned long long)isbn);
+    return n + 12;
+}
+
+static size_t req_lookup(unsigned char* p, unsigned int id, long long isbn) {
+    size_t n = req_head(p, PR_LOOKUP, id, 8);
+    le_put64(p + n, (unsigned long long)isbn);
+    return n + 8;
+}
+
+static size_t req_range(unsigned char* p, unsigned int id, long long lo, long long hi, int max) {
+    size_t n = req_head(p, PR_RANGE, id, 18);
+    le_put64(p + n, (unsigned long long)lo);
+    le_put64(p + n + 8, (unsigned long long)hi);
+    le_put16(p + n + 16, (unsigned int)max);
+    return n + 18;
+}
+
+static size_t req_search(unsigned char* p, unsigned int id, const char* word, int max) {
+    size_t wl = strlen(word);
+    size_t n = req_head(p, PR_SEARCH, id, 2 + wl);
+    le_put16(p + n, (unsigned int)max);
+    memcpy(p + n + 2, word, wl);
+    return n + 2 + wl;
+}
+
+/* Sorteia o próximo pedido da mistura */
+static size_t next_request(Worker* w, unsigned char* p, unsigned int id) {
+    const Load* cfg = w->cfg;
+    int dice = (int)(rand_r(&w->seed) % 100);
+    long long isbn = cfg->isbns[rand_r(&w->seed) % (unsigned int)cfg->n_isbns];
+
+    if (!cfg->mixed) {
+        /* 70% ISBN, 20% intervalo, 10% palavra */
+        if (dice < 70 || (dice >= 90 && !cfg->word[0])) return req_lookup(p, id, isbn);
+        if (dice < 90) return req_range(p, id, isbn, LLONG_MAX, 10);
+        return req_search(p, id, cfg->word, 10);
+    }
+    /* 40% ISBN, 10% intervalo, 10% palavra, 20% empréstimo, 20% devolução */
+    if (dice < 40 || (dice >= 50 && dice < 60 && !cfg->word[0])) return req_lookup(p, id, isbn);
+    if (dice < 50) return req_range(p, id, isbn, LLONG_MAX, 10);
+    if (dice < 60) return req_search(p, id, cfg->word, 10);
+    return req_user_isbn(p, dice < 80 ? PR_BORROW : PR_RETURN, id, cfg->user_id, isbn);
+}
+
+/* ---------- Conexões ---------- */
+
+static void record(Worker* w, double ms, int status) {
+    if (w->n_lat == w->cap_lat) {
+        w->cap_lat = w->cap_lat ? w->cap_lat * 2 : 65536;
+        float* nl = (float*)realloc(w->lat, sizeof(float) * (size_t)w->cap_lat);
+        if (!nl) {
+            printf("Erro: sem memória.\n");
+            exit(1);
+        }
+        w->lat = nl;
+    }
+    w->lat[w->n_lat++] = (float)ms;
+    if (status == BIB_OK) w->ok++;
+    else if (status == PR_BAD_REQUEST) w->bad++;
+    else w->other++;
+}
+
+static void* worker_run(void* arg) {
+    Worker* w = (Worker*)arg;
+    const Load* cfg = w->cfg;
+    int depth = cfg->depth;
+    double* sent = (double*)xmalloc(sizeof(double) * (size_t)depth);
+    unsigned char* out = (unsigned char*)xmalloc(LOAD_REQ_MAX * (size_t)depth);
+    unsigned char* in = (unsigned char*)xmalloc(LOAD_IN_BUF);
+    size_t in_len = 0;
+    unsigned long sent_n = 0, recv_n = 0;
+
+    double t = now_secs();
+    double deadline = t + cfg->secs;
+    size_t out_len = 0;
+    for (int i = 0; i < depth; i++) {
+        sent[sent_n % (unsigned long)depth] = t;
+        out_len += next_request(w, out + out_len, (unsigned int)sent_n);
+        sent_n++;
+    }
+    if (!write_all(w->fd, out, out_len)) w->failed = 1;
+
+    while (!w->failed && recv_n < sent_n) {
+        ssize_t r = read(w->fd, in + in_len, LOAD_IN_BUF - in_len);
+        if (r < 0 && errno == EINTR) continue;
+        if (r <= 0) {
+            w->failed = 1;
+            break;
+        }
+        in_len += (size_t)r;
+        t = now_secs();
+
+        size_t pos = 0;
+        out_len = 0;
+        while (in_len - pos >= PR_LEN_BYTES) {
+            size_t len = le_get32(in + pos);
+            if (len < PR_HEAD_BYTES || len > LOAD_IN_BUF - PR_LEN_BYTES) {
+                w->failed = 1;
+                break;
+            }
+            if (in_len - pos - PR_LEN_BYTES < len) break;
+            int status = in[pos + PR_LEN_BYTES];
+            record(w, (t - sent[recv_n % (unsigned long)depth]) * 1000.0, status);
+            recv_n++;
+            pos += PR_LEN_BYTES + len;
+
+            /* uma resposta libera um lugar: o próximo pedido entra */
+            if (t < deadline) {
+                sent[sent_n % (unsigned long)depth] = t;
+                out_len += next_request(w, out + out_len, (unsigned int)sent_n);
+                sent_n++;
+            }
+        }
+        memmove(in, in + pos, in_len - pos);
+        in_len -= pos;
+        if (out_len > 0 && !write_all(w->fd, out, out_len)) w->failed = 1;
+    }
+
+    free(sent);
+    free(out);
+    free(in);
+    return NULL;
+}
+
+/* Pega uma amostra de ISBNs e uma palavra do primeiro título */
+static int prepare(Load* cfg) {
+    int fd = net_connect(cfg->addr);
+    if (fd < 0) return 0;
+
+    unsigned char buf[LOAD_IN_BUF];
+    size_t n = req_range(buf, 1, LLONG_MIN, LLONG_MAX, LOAD_SAMPLE);
+    long len = write_all(fd, buf, n) ? read_frame(fd, buf, sizeof(buf)) : -1;
+    if (len < PR_HEAD_BYTES + 4 || buf[4] != BIB_OK) {
+        printf("Resposta inválida de %s.\n", cfg->addr);
+        close(fd);
+        return 0;
+    }
+    unsigned int count = le_get32(buf + 9);
+    for (unsigned int i = 0; i < count && i < LOAD_SAMPLE; i++) {
+        cfg->isbns[cfg->n_isbns++] = (long long)le_get64(buf + 13 + 8 * i);
+    }
+    if (cfg->n_isbns == 0) {
+        printf("Catálogo vazio: nada para pedir.\n");
+        close(fd);
+        return 0;
+    }
+
+    n = req_lookup(buf, 2, cfg->isbns[0]);
+    len = write_all(fd, buf, n) ? read_frame(fd, buf, sizeof(buf)) : -1;
+    if (len > PR_HEAD_BYTES + 24 && buf[4] == BIB_OK) {
+        /* livro: isbn, 4 x i32, depois u16 + título */
+        const unsigned char* title = buf + 9 + 24 + 2;
+        size_t tl = le_get16(buf + 9 + 24);
+        size_t i = 0;
+        while (i < tl) {
+            size_t start = i;
+            while (i < tl && isalnum(title[i])) i++;
+            if (i - start >= 3 && i - start < sizeof(cfg->word)) {
+                memcpy(cfg->word, title + start, i - start);
+                cfg->word[i - start] = '\0';
+                break;
+            }
+            i++;
+        }
+    }
+    close(fd);
+    return 1;
+}
+
+static int cmp_float(const void* a, const void* b) {
+    float x = *(const float*)a, y = *(const float*)b;
+    return (x > y) - (x < y);
+}
+
+static double percentile(const float* v, long n, double p) {
+    long i = (long)(p * (double)(n - 1) + 0.5);
+    return v[i];
+}
+
+static void usage(const char* prog) {
+    printf("Uso: %s [-c conexões] [-p em voo] [-s segundos] [-m leitura|misto] [-u usuário] endereço\n", prog);
+}
+
+int main(int argc, char** argv) {
+    static Load cfg;
+    cfg.conns = 4;
+    cfg.depth = 16;
+    cfg.secs = 5.0;
+    cfg.user_id = 17022026;
+
+    int i;
+    for (i = 1; i + 1 < argc && argv[i][0] == '-'; i += 2) {
+        const char* v = argv[i + 1];
+        switch (argv[i][1]) {
+            case 'c': cfg.conns = atoi(v); break;
+            case 'p': cfg.depth = atoi(v); break;
+            case 's': cfg.secs = atof(v); break;
+            case 'm': cfg.mixed = strcmp(v, "misto") == 0; break;
+            case 'u': cfg.user_id = atoi(v); break;
+            default: usage(argv[0]); return 1;
+        }
+    }
+    if (i != argc - 1 || cfg.conns <= 0 || cfg.depth <= 0 || cfg.secs <= 0) {
+        usage(argv[0]);
+        return 1;
+    }
+    cfg.addr = argv[i];
+    if (!prepare(&cfg)) return 1;
+
+    printf("Carga em %s: %d conexão(ões) x %d em voo, %.1f s, mistura %s\n",
+           cfg.addr, cfg.conns, cfg.depth, cfg.secs, cfg.mixed ? "misto" : "leitura");
+    fflush(stdout);
+
+    Worker* ws = (Worker*)calloc((size_t)cfg.conns, sizeof(Worker));
+    if (!ws) {
+        printf("Erro: sem memória.\n");
+        return 1;
+    }
+    int started = 0;
+    double t0 = now_secs();
+    for (int k = 0; k < cfg.conns; k++) {
+        ws[k].cfg = &cfg;
+        ws[k].seed = 12345u + (unsigned int)k * 7919u;
+        ws[k].fd = net_connect(cfg.addr);
+        if (ws[k].fd < 0) break;
+        if (pthread_create(&ws[k].th, NULL, worker_run, &ws[k]) != 0) {
+            close(ws[k].fd);
+            break;
+        }
+        started++;
+    }
+    long total = 0, ok = 0, other = 0, bad = 0;
+    int failed = 0;
+    for (int k = 0; k < started; k++) {
+        pthread_join(ws[k].th, NULL);
+        close(ws[k].fd);
+        total += ws[k].n_lat;
+        ok += ws[k].ok;
+        other += ws[k].other;
+        bad += ws[k].bad;
+        failed += ws[k].failed;
+    }
+    double secs = now_secs() - t0;
+    if (total == 0) {
+        printf("Nenhuma resposta.\n");
+        return 1;
+    }
+
+    float* all = (float*)xmalloc(sizeof(float) * (size_t)total);
+    long at = 0;
+    for (int k = 0; k < started; k++) {
+        memcpy(all + at, ws[k].lat, sizeof(float) * (size_t)ws[k].n_lat);
+        at += ws[k].n_lat;
+        free(ws[k].lat);
+    }
+    qsort(all, (size_t)total, sizeof(float), cmp_float);
+
+    printf("%ld pedido(s) em %.2f s: %.0f pedidos/s\n", total, secs, (double)total / secs);
+    printf("Latência (ms): p50 %.3f | p90 %.3f | p99 %.3f | p99.9 %.3f | máx %.3f\n",
+           percentile(all, total, 0.50), percentile(all, total, 0.90),
+           percentile(all, total, 0.99), percentile(all, total, 0.999), all[total - 1]);
+    printf("Respostas: %ld ok, %ld com outro status, %ld inválida(s)", ok, other, bad);
+    if (started < cfg.conns) printf("; %d conexão(ões) não abriram", cfg.conns - started);
+    if (failed) printf("; %d conexão(ões) caíram", failed);
+    printf("\n");
+
+    free(all);
+    free(ws);
+    return failed || bad ? 1 : 0;
+}
+
+#endif
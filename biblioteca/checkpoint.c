@@ -0,0 +1,158 @@
+#include "checkpoint.h"
+#include "diario.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* ---------- Funções auxiliares ---------- */
+
+/* Escreve cada registro alterado no seu slot */
+static int apply_patches(Db* db, const CkTable* ct) {
+    size_t step = sizeof(long long) + ct->rec_size;
+    for (size_t off = 0; off + step <= ct->len; off += step) {
+        long long slot;
+        memcpy(&slot, ct->data + off, sizeof(long long));
+        if (!db_write_at(db, ct->table, (unsigned long long)slot * ct->rec_size,
+                         ct->data + off + sizeof(long long), ct->rec_size)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static void* ck_main(void* arg) {
+    Checkpoint* c = (Checkpoint*)arg;
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+
+    int ok = 1;
+    for (int i = 0; ok && i < c->n_tables; i++) {
+        const CkTable* ct = &c->tables[i];
+        if (ct->at >= 0) {
+            /* o que passou de 'at' não é de nenhum checkpoint completo */
+            unsigned long long at = (unsigned long long)ct->at;
+            ok = db_truncate(c->db, ct->table, at) &&
+                 (ct->len == 0 || db_write_at(c->db, ct->table, at, ct->data, ct->len));
+        } else if (ct->rec_size) {
+            ok = apply_patches(c->db, ct);
+        } else {
+            ok = db_replace(c->db, ct->table, ct->data, ct->len);
+        }
+    }
+
+    /* só agora a foto vale: o cabeçalho novo aponta para ela */
+    if (ok) ok = db_commit(c->db, c->seg);
+
+    /* segmentos cobertos pela foto podem sair */
+    if (ok) {
+        char path[96];
+        for (unsigned int s = c->seg; s > 1; s--) {
+            jr_segment_path(c->jr_prefix, s - 1, path, sizeof(path));
+            if (remove(path) != 0) break;
+        }
+        remove(DIARIO_LEGACY);
+        remove(CHECKPOINT_FILE);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    pthread_mutex_lock(&c->mu);
+    c->ok = ok;
+    c->secs = (double)(t1.tv_sec - t0.tv_sec) + (double)(t1.tv_nsec - t0.tv_nsec) / 1e9;
+    c->finished = 1;
+    pthread_mutex_unlock(&c->mu);
+    return NULL;
+}
+
+/* Libera os buffers da foto */
+static void ck_clear(Checkpoint* c) {
+    for (int i = 0; i < c->n_tables; i++) free(c->tables[i].data);
+    c->n_tables = 0;
+}
+
+static void ck_push(Checkpoint* c, int table, unsigned char* data, size_t len,
+                    size_t rec_size, long long at) {
+    if (c->n_tables == CK_MAX_TABLES) {
+        free(data);
+        return;
+    }
+    c->tables[c->n_tables].table = table;
+    c->tables[c->n_tables].data = data;
+    c->tables[c->n_tables].len = len;
+    c->tables[c->n_tables].rec_size = rec_size;
+    c->tables[c->n_tables].at = at;
+    c->n_tables++;
+}
+
+/* ---------- API ---------- */
+
+int ck_read_manifest(CkManifest* m) {
+    FILE* f = fopen(CHECKPOINT_FILE, "rb");
+    if (!f) return 0;
+
+    unsigned char b[16];
+    int ok = fread(b, 1, sizeof(b), f) == sizeof(b);
+    fclose(f);
+
+    if (!ok || (int)le_get32(b) != CHECKPOINT_MAGIC) return 0;
+    m->seg = le_get32(b + 4);
+    m->hist_count = (long long)le_get64(b + 8);
+    return 1;
+}
+
+void ck_init(Checkpoint* c) {
+    memset(c, 0, sizeof(*c));
+    pthread_mutex_init(&c->mu, NULL);
+}
+
+void ck_add_table(Checkpoint* c, int table, unsigned char* data, size_t len) {
+    ck_push(c, table, data, len, 0, -1);
+}
+
+void ck_add_patches(Checkpoint* c, int table, size_t rec_size, unsigned char* data, size_t len) {
+    ck_push(c, table, data, len, rec_size, -1);
+}
+
+void ck_add_tail(Checkpoint* c, int table, long long at, unsigned char* data, size_t len) {
+    ck_push(c, table, data, len, 0, at);
+}
+
+int ck_start(Checkpoint* c, Db* db, const char* jr_prefix, unsigned int seg) {
+    if (c->running) return 0;
+    c->db = db;
+    c->jr_prefix = jr_prefix;
+    c->seg = seg;
+    c->finished = 0;
+    c->ok = 0;
+    if (pthread_create(&c->thread, NULL, ck_main, c) != 0) {
+        ck_clear(c);
+        return 0;
+    }
+    c->running = 1;
+    return 1;
+}
+
+int ck_running(Checkpoint* c) {
+    return c->running;
+}
+
+int ck_poll(Checkpoint* c) {
+    if (!c->running) return 0;
+    pthread_mutex_lock(&c->mu);
+    int done = c->finished;
+    pthread_mutex_unlock(&c->mu);
+    if (!done) return 0;
+
+    pthread_join(c->thread, NULL);
+    c->running = 0;
+    ck_clear(c);
+    return 1;
+}
+
+int ck_wait(Checkpoint* c) {
+    if (!c->running) return c->ok;
+    pthread_join(c->thread, NULL);
+    c->running = 0;
+    ck_clear(c);
+    return c->ok;
+}
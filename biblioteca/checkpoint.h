@@ -0,0 +1,80 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <stddef.h>
+#include <pthread.h>
+#include "banco.h"
+
+/* Checkpoint: grava em segundo plano uma foto consistente do estado
+   (livros, usuários, empréstimos, filas e os eventos novos do histórico)
+   no biblioteca.db e depois apaga os segmentos do diário que ela cobre.
+   Assim a inicialização só reaplica o diário desde o último checkpoint.
+
+   A foto é tirada na thread principal (buffers já serializados) e a
+   thread de fundo só escreve: livros e usuários recebem só os registros
+   alterados, empréstimos e filas são substituídos, o histórico só tem o
+   final regravado. Tudo vira uma única gravação do banco (db_commit),
+   cujo cabeçalho também diz a partir de qual segmento o diário vale. */
+
+#define CHECKPOINT_BYTES (1L << 20)   /* diário com 1 MB dispara um checkpoint */
+#define CHECKPOINT_SECS  300          /* ... ou 5 minutos com alguma alteração */
+
+/* Manifesto dos checkpoints em .dat soltos (antes do biblioteca.db) */
+#define CHECKPOINT_FILE  "checkpoint.dat"
+#define CHECKPOINT_MAGIC 0x31504B43   /* "CKP1" */
+
+#define CK_MAX_TABLES 8
+
+/* O que o último checkpoint em .dat soltos cobre */
+typedef struct {
+    unsigned int seg;         /* primeiro segmento do diário a reaplicar */
+    long long hist_count;     /* eventos válidos no historico.dat */
+} CkManifest;
+
+/* Conteúdo de uma tabela (o buffer passa a ser do checkpoint): inteiro,
+   só remendos (long long slot, registro) se rec_size > 0, ou o novo final
+   a partir de 'at' se at >= 0 */
+typedef struct {
+    int table;
+    unsigned char* data;
+    size_t len;
+    size_t rec_size;
+    long long at;
+} CkTable;
+
+typedef struct {
+    CkTable tables[CK_MAX_TABLES];
+    int n_tables;
+
+    Db* db;
+    const char* jr_prefix;
+    unsigned int seg;         /* segmento aberto quando a foto foi tirada */
+    int announce;             /* pedido de quem quer saber do fim (vale até o próximo) */
+
+    pthread_t thread;
+    pthread_mutex_t mu;
+    int running;
+    int finished;
+    int ok;
+    double secs;
+} Checkpoint;
+
+/* Lê o checkpoint.dat antigo; 0 se não existe */
+int  ck_read_manifest(CkManifest* m);
+
+void ck_init(Checkpoint* c);
+void ck_add_table(Checkpoint* c, int table, unsigned char* data, size_t len);
+void ck_add_patches(Checkpoint* c, int table, size_t rec_size, unsigned char* data, size_t len);
+/* Corta a tabela em 'at' bytes e grava 'data' a partir dali */
+void ck_add_tail(Checkpoint* c, int table, long long at, unsigned char* data, size_t len);
+
+/* Dispara a gravação em segundo plano (1 = ok). O banco é só da thread do
+   checkpoint até ck_poll/ck_wait devolverem. */
+int  ck_start(Checkpoint* c, Db* db, const char* jr_prefix, unsigned int seg);
+
+/* 1 = terminou agora (resultado em c->ok), 0 = ainda gravando ou parado */
+int  ck_poll(Checkpoint* c);
+int  ck_running(Checkpoint* c);
+int  ck_wait(Checkpoint* c);   /* espera terminar; retorna c->ok */
+
+#endif
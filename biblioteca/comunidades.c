@@ -0,0 +1,225 @@
+#include "comunidades.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#define CM_INITIAL 1024
+
+/* ---------- Funções auxiliares ---------- */
+
+static void* xcalloc(size_t n, size_t sz) {
+    void* p = calloc(n, sz);
+    if (!p) {
+        printf("Erro: sem memória.\n");
+        exit(1);
+    }
+    return p;
+}
+
+static unsigned int mix(unsigned long long x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return (unsigned int)(x & 0xFFFFFFFFu);
+}
+
+static int user_bucket(int user_id, int size) {
+    return (int)(mix((unsigned long long)(unsigned int)user_id) % (unsigned int)size);
+}
+
+static int isbn_bucket(long long isbn, int size) {
+    return (int)(mix((unsigned long long)isbn) % (unsigned int)size);
+}
+
+/* Dobra a hash de usuários quando fica cheia demais */
+static void users_grow(Communities* c) {
+    int newsize = c->users_size * 2;
+    CommUser** nb = (CommUser**)xcalloc((size_t)newsize, sizeof(CommUser*));
+    for (int i = 0; i < c->users_size; i++) {
+        CommUser* u = c->users[i];
+        while (u) {
+            CommUser* nx = u->next;
+            int b = user_bucket(u->user_id, newsize);
+            u->next = nb[b];
+            nb[b] = u;
+            u = nx;
+        }
+    }
+    free(c->users);
+    c->users = nb;
+    c->users_size = newsize;
+}
+
+static void isbns_grow(Communities* c) {
+    int newsize = c->isbns_size * 2;
+    CommIsbn** nb = (CommIsbn**)xcalloc((size_t)newsize, sizeof(CommIsbn*));
+    for (int i = 0; i < c->isbns_size; i++) {
+        CommIsbn* e = c->isbns[i];
+        while (e) {
+            CommIsbn* nx = e->next;
+            int b = isbn_bucket(e->isbn, newsize);
+            e->next = nb[b];
+            nb[b] = e;
+            e = nx;
+        }
+    }
+    free(c->isbns);
+    c->isbns = nb;
+    c->isbns_size = newsize;
+}
+
+/* Índice do usuário; cria um elemento novo no DSU se ainda não existe */
+static int user_get_or_add(Communities* c, int user_id) {
+    int b = user_bucket(user_id, c->users_size);
+    for (CommUser* u = c->users[b]; u; u = u->next) {
+        if (u->user_id == user_id) return u->idx;
+    }
+
+    int cap_before = c->dsu.cap;
+    int idx = dsu_add(&c->dsu);
+    if (idx < 0) {
+        printf("Erro: sem memória.\n");
+        exit(1);
+    }
+    if (c->dsu.cap != cap_before || !c->user_of) {
+        int* tmp = (int*)realloc(c->user_of, sizeof(int) * (size_t)c->dsu.cap);
+        if (!tmp) {
+            printf("Erro: sem memória.\n");
+            exit(1);
+        }
+        c->user_of = tmp;
+    }
+    c->user_of[idx] = user_id;
+
+    CommUser* u = (CommUser*)malloc(sizeof(CommUser));
+    if (!u) {
+        printf("Erro: sem memória.\n");
+        exit(1);
+    }
+    u->user_id = user_id;
+    u->idx = idx;
+    u->next = c->users[b];
+    c->users[b] = u;
+
+    if (c->dsu.n > 2 * c->users_size) users_grow(c);
+    return idx;
+}
+
+/* ---------- API ---------- */
+
+int cm_init(Communities* c) {
+    c->user_of = NULL;
+    c->valid = 0;
+    c->n_isbns = 0;
+    c->users_size = CM_INITIAL;
+    c->isbns_size = CM_INITIAL;
+    c->users = (CommUser**)calloc((size_t)c->users_size, sizeof(CommUser*));
+    c->isbns = (CommIsbn**)calloc((size_t)c->isbns_size, sizeof(CommIsbn*));
+    if (!c->users || !c->isbns) return 0;
+    return dsu_init(&c->dsu, 0);
+}
+
+/* Esvazia as tabelas e o DSU; a próxima consulta reconstrói */
+void cm_clear(Communities* c) {
+    for (int i = 0; i < c->users_size; i++) {
+        CommUser* u = c->users[i];
+        while (u) {
+            CommUser* nx = u->next;
+            free(u);
+            u = nx;
+        }
+        c->users[i] = NULL;
+    }
+    for (int i = 0; i < c->isbns_size; i++) {
+        CommIsbn* e = c->isbns[i];
+        while (e) {
+            CommIsbn* nx = e->next;
+            free(e);
+            e = nx;
+        }
+        c->isbns[i] = NULL;
+    }
+    c->dsu.n = 0;
+    c->n_isbns = 0;
+    c->valid = 0;
+}
+
+void cm_free(Communities* c) {
+    if (!c || !c->users) return;
+    cm_clear(c);
+    free(c->users);
+    free(c->isbns);
+    free(c->user_of);
+    dsu_free(&c->dsu);
+    c->users = NULL;
+    c->isbns = NULL;
+    c->user_of = NULL;
+}
+
+int cm_pair(Communities* c, int user_id, long long isbn, int* out_a, int* out_b) {
+    int idx = user_get_or_add(c, user_id);
+
+    int b = isbn_bucket(isbn, c->isbns_size);
+    for (CommIsbn* e = c->isbns[b]; e; e = e->next) {
+        if (e->isbn == isbn) {
+            *out_a = e->first_idx;
+            *out_b = idx;
+            return 1;
+        }
+    }
+
+    /* primeiro leitor desse ISBN */
+    CommIsbn* e = (CommIsbn*)malloc(sizeof(CommIsbn));
+    if (!e) {
+        printf("Erro: sem memória.\n");
+        exit(1);
+    }
+    e->isbn = isbn;
+    e->first_idx = idx;
+    e->next = c->isbns[b];
+    c->isbns[b] = e;
+    c->n_isbns++;
+
+    if (c->n_isbns > 2 * c->isbns_size) isbns_grow(c);
+    return 0;
+}
+
+void cm_link(Communities* c, int user_id, long long isbn) {
+    int a, b;
+    if (cm_pair(c, user_id, isbn, &a, &b)) dsu_union(&c->dsu, a, b);
+}
+
+void cm_set_dsu(Communities* c, DSU* d) {
+    dsu_free(&c->dsu);
+    c->dsu = *d;
+    /* user_of acompanha a capacidade do DSU */
+    int* tmp = (int*)realloc(c->user_of, sizeof(int) * (size_t)(c->dsu.cap > 0 ? c->dsu.cap : 1));
+    if (!tmp) {
+        printf("Erro: sem memória.\n");
+        exit(1);
+    }
+    c->user_of = tmp;
+}
+
+int cm_index(Communities* c, int user_id) {
+    int b = user_bucket(user_id, c->users_size);
+    for (CommUser* u = c->users[b]; u; u = u->next) {
+        if (u->user_id == user_id) return u->idx;
+    }
+    return -1;
+}
+
+int cm_same(Communities* c, int a, int b) {
+    if (a == b) return 1;
+    int ia = cm_index(c, a);
+    int ib = cm_index(c, b);
+    if (ia < 0 || ib < 0) return 0;
+    return dsu_same(&c->dsu, ia, ib);
+}
+
+int cm_size(Communities* c, int user_id) {
+    int idx = cm_index(c, user_id);
+    if (idx < 0) return 1;
+    return dsu_size(&c->dsu, idx);
+}
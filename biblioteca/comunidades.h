@@ -0,0 +1,53 @@
+#ifndef COMUNIDADES_H
+#define COMUNIDADES_H
+
+#include "dsu.h"
+
+/* Usuário -> índice no DSU */
+typedef struct CommUser {
+    int user_id;
+    int idx;
+    struct CommUser* next;
+} CommUser;
+
+/* ISBN -> primeiro usuário (índice) que pegou o livro */
+typedef struct CommIsbn {
+    long long isbn;
+    int first_idx;
+    struct CommIsbn* next;
+} CommIsbn;
+
+/* Comunidades de leitores mantidas a cada empréstimo.
+   Dois usuários ficam na mesma comunidade quando pegaram o mesmo livro. */
+typedef struct {
+    DSU dsu;              /* cresce conforme novos usuários emprestam */
+    int* user_of;         /* índice -> user_id */
+    CommUser** users;     /* hash user_id -> índice */
+    int users_size;
+    CommIsbn** isbns;     /* hash ISBN -> primeiro usuário */
+    int isbns_size;
+    int n_isbns;
+    int valid;            /* 0 = precisa reconstruir a partir do histórico */
+} Communities;
+
+/* lifecycle */
+int  cm_init(Communities* c);
+void cm_free(Communities* c);
+void cm_clear(Communities* c);   /* esvazia e marca como inválido */
+
+/* evento de empréstimo: liga o usuário ao primeiro leitor do ISBN */
+void cm_link(Communities* c, int user_id, long long isbn);
+
+/* igual a cm_link, mas sem unir: devolve 1 e o par a ser unido
+   (usado na carga em lote, que une os pares em paralelo) */
+int  cm_pair(Communities* c, int user_id, long long isbn, int* out_a, int* out_b);
+
+/* substitui o DSU pelo resultado da carga em lote (mesmos índices) */
+void cm_set_dsu(Communities* c, DSU* d);
+
+/* consultas (usuário sem empréstimos: comunidade só dele) */
+int  cm_index(Communities* c, int user_id);   /* -1 se não participa */
+int  cm_same(Communities* c, int a, int b);
+int  cm_size(Communities* c, int user_id);
+
+#endif
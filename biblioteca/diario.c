@@ -0,0 +1,312 @@
+#include "diario.h"
+#include "plataforma.h"
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+
+/* cabeçalho de cada registro: tamanho (4) + crc (4) + tipo (1) */
+#define JR_HEADER 9
+/* com tanto pendente, grava sem esperar o prazo */
+#define JR_FLUSH_BYTES (256 * 1024)
+
+/* ---------- CRC-32 (detecta registro cortado ou corrompido) ---------- */
+
+static unsigned int crc_table[256];
+static pthread_once_t crc_once = PTHREAD_ONCE_INIT;
+
+static void crc_init(void) {
+    for (unsigned int i = 0; i < 256; i++) {
+        unsigned int c = i;
+        for (int k = 0; k < 8; k++) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+        crc_table[i] = c;
+    }
+}
+
+static unsigned int crc_update(unsigned int crc, const unsigned char* p, size_t n) {
+    crc = ~crc;
+    for (size_t i = 0; i < n; i++) crc = crc_table[(crc ^ p[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+/* ---------- Funções auxiliares ---------- */
+
+static void put_u32(unsigned char* p, unsigned int v) {
+    p[0] = (unsigned char)v;
+    p[1] = (unsigned char)(v >> 8);
+    p[2] = (unsigned char)(v >> 16);
+    p[3] = (unsigned char)(v >> 24);
+}
+
+static unsigned int get_u32(const unsigned char* p) {
+    return (unsigned int)p[0] | ((unsigned int)p[1] << 8) |
+           ((unsigned int)p[2] << 16) | ((unsigned int)p[3] << 24);
+}
+
+/* Garante espaço no buffer pendente (com o lock) */
+static void buf_reserve(Journal* j, size_t extra) {
+    if (j->len + extra <= j->cap) return;
+    size_t nc = j->cap ? j->cap : 4096;
+    while (nc < j->len + extra) nc *= 2;
+    unsigned char* nb = (unsigned char*)realloc(j->buf, nc);
+    if (!nb) {
+        printf("Erro: sem memória.\n");
+        exit(1);
+    }
+    j->buf = nb;
+    j->cap = nc;
+}
+
+/* Prazo absoluto daqui a ms milissegundos */
+static void deadline_in(struct timespec* ts, int ms) {
+    clock_gettime(CLOCK_REALTIME, ts);
+    ts->tv_sec += ms / 1000;
+    ts->tv_nsec += (long)(ms % 1000) * 1000000L;
+    if (ts->tv_nsec >= 1000000000L) {
+        ts->tv_sec++;
+        ts->tv_nsec -= 1000000000L;
+    }
+}
+
+/* ---------- Thread de gravação (group commit) ---------- */
+
+static void* writer_main(void* arg) {
+    Journal* j = (Journal*)arg;
+    unsigned char* spare = NULL;
+    size_t spare_cap = 0;
+
+    pthread_mutex_lock(&j->mu);
+    while (1) {
+        while (j->len == 0 && !j->stop) pthread_cond_wait(&j->wake, &j->mu);
+        if (j->len == 0 && j->stop) break;
+
+        /* espera o prazo para juntar mais registros no mesmo fsync */
+        if (!j->stop && j->len < JR_FLUSH_BYTES) {
+            struct timespec dl;
+            deadline_in(&dl, j->latency_ms);
+            while (!j->stop && j->len < JR_FLUSH_BYTES) {
+                if (pthread_cond_timedwait(&j->wake, &j->mu, &dl) == ETIMEDOUT) break;
+            }
+        }
+
+        /* troca de buffer e grava sem segurar o lock */
+        unsigned char* out = j->buf;
+        size_t out_cap = j->cap;
+        size_t n = j->len;
+        unsigned long long upto = j->next_lsn - 1;
+        j->buf = spare;
+        j->cap = spare_cap;
+        j->len = 0;
+        j->flushing = 1;
+        pthread_mutex_unlock(&j->mu);
+
+        int ok = (n == 0) || (fwrite(out, 1, n, j->f) == n && plat_sync_file(j->f) == 0);
+
+        pthread_mutex_lock(&j->mu);
+        spare = out;
+        spare_cap = out_cap;
+        j->flushing = 0;
+        if (ok) {
+            j->size += (long long)n;
+            j->durable_lsn = upto;
+        } else {
+            j->failed = 1;   /* quem chama vê em jr_failed */
+        }
+        pthread_cond_broadcast(&j->durable);
+    }
+    pthread_mutex_unlock(&j->mu);
+    free(spare);
+    return NULL;
+}
+
+/* ---------- API ---------- */
+
+void jr_segment_path(const char* prefix, unsigned int seg, char* out, size_t out_sz) {
+    snprintf(out, out_sz, "%s.%06u.dat", prefix, seg);
+}
+
+int jr_open(Journal* j, const char* prefix, unsigned int seg, int latency_ms) {
+    pthread_once(&crc_once, crc_init);
+    memset(j, 0, sizeof(*j));
+
+    snprintf(j->prefix, sizeof(j->prefix), "%s", prefix);
+    j->seg = seg;
+    char path[96];
+    jr_segment_path(prefix, seg, path, sizeof(path));
+    j->f = fopen(path, "ab");
+    if (!j->f) return 0;
+    plat_sync_dir();   /* o segmento novo precisa sobreviver a uma queda */
+    fseek(j->f, 0, SEEK_END);
+    j->size = ftell(j->f);
+
+    j->latency_ms = latency_ms > 0 ? latency_ms : DIARIO_LATENCY_MS;
+    j->next_lsn = 1;
+    pthread_mutex_init(&j->mu, NULL);
+    pthread_cond_init(&j->wake, NULL);
+    pthread_cond_init(&j->durable, NULL);
+
+    if (pthread_create(&j->thread, NULL, writer_main, j) != 0) {
+        fclose(j->f);
+        j->f = NULL;
+        return 0;
+    }
+    return 1;
+}
+
+void jr_close(Journal* j) {
+    if (!j->f) return;
+
+    pthread_mutex_lock(&j->mu);
+    j->stop = 1;
+    pthread_cond_signal(&j->wake);
+    pthread_mutex_unlock(&j->mu);
+    pthread_join(j->thread, NULL);
+
+    fclose(j->f);
+    j->f = NULL;
+    free(j->buf);
+    j->buf = NULL;
+    pthread_mutex_destroy(&j->mu);
+    pthread_cond_destroy(&j->wake);
+    pthread_cond_destroy(&j->durable);
+}
+
+unsigned long long jr_append2(Journal* j, int op, const void* a, size_t alen, const void* b, size_t blen) {
+    size_t plen = alen + blen;
+    unsigned char hdr[JR_HEADER];
+    unsigned char opb = (unsigned char)op;
+
+    unsigned int crc = crc_update(0, &opb, 1);
+    if (alen) crc = crc_update(crc, (const unsigned char*)a, alen);
+    if (blen) crc = crc_update(crc, (const unsigned char*)b, blen);
+    put_u32(hdr, (unsigned int)plen);
+    put_u32(hdr + 4, crc);
+    hdr[8] = opb;
+
+    pthread_mutex_lock(&j->mu);
+    if (j->failed) {
+        pthread_mutex_unlock(&j->mu);
+        return 0;
+    }
+    buf_reserve(j, JR_HEADER + plen);
+    memcpy(j->buf + j->len, hdr, JR_HEADER);
+    if (alen) memcpy(j->buf + j->len + JR_HEADER, a, alen);
+    if (blen) memcpy(j->buf + j->len + JR_HEADER + alen, b, blen);
+    j->len += JR_HEADER + plen;
+    unsigned long long lsn = j->next_lsn++;
+    if (j->len - (JR_HEADER + plen) == 0 || j->len >= JR_FLUSH_BYTES) pthread_cond_signal(&j->wake);
+    pthread_mutex_unlock(&j->mu);
+    return lsn;
+}
+
+unsigned long long jr_append(Journal* j, int op, const void* payload, size_t len) {
+    return jr_append2(j, op, payload, len, NULL, 0);
+}
+
+void jr_wait(Journal* j, unsigned long long lsn) {
+    pthread_mutex_lock(&j->mu);
+    while (j->durable_lsn < lsn && !j->failed) pthread_cond_wait(&j->durable, &j->mu);
+    pthread_mutex_unlock(&j->mu);
+}
+
+int jr_failed(Journal* j) {
+    pthread_mutex_lock(&j->mu);
+    int f = j->failed;
+    pthread_mutex_unlock(&j->mu);
+    return f;
+}
+
+unsigned long long jr_last(Journal* j) {
+    pthread_mutex_lock(&j->mu);
+    unsigned long long l = j->next_lsn - 1;
+    pthread_mutex_unlock(&j->mu);
+    return l;
+}
+
+unsigned int jr_rotate(Journal* j) {
+    pthread_mutex_lock(&j->mu);
+    while (j->flushing) pthread_cond_wait(&j->durable, &j->mu);
+
+    /* o que está pendente fecha o segmento atual */
+    int ok = !j->failed;
+    if (ok && j->len > 0) {
+        ok = fwrite(j->buf, 1, j->len, j->f) == j->len;
+        j->len = 0;
+    }
+    if (ok) ok = plat_sync_file(j->f) == 0;
+
+    unsigned int seg = 0;
+    if (ok) {
+        char path[96];
+        jr_segment_path(j->prefix, j->seg + 1, path, sizeof(path));
+        FILE* nf = fopen(path, "ab");
+        if (nf) {
+            plat_sync_dir();
+            fclose(j->f);
+            j->f = nf;
+            j->seg++;
+            j->size = 0;
+            seg = j->seg;
+        }
+    }
+    if (ok) {
+        j->durable_lsn = j->next_lsn - 1;
+        pthread_cond_broadcast(&j->durable);
+    }
+    pthread_mutex_unlock(&j->mu);
+    return seg;
+}
+
+long long jr_size(Journal* j) {
+    pthread_mutex_lock(&j->mu);
+    long long n = j->size + (long long)j->len;
+    pthread_mutex_unlock(&j->mu);
+    return n;
+}
+
+long jr_replay(const char* path, JournalApply fn, void* ctx, long long* torn) {
+    pthread_once(&crc_once, crc_init);
+
+    FILE* f = fopen(path, "rb");
+    if (!f) return -1;
+
+    unsigned char hdr[JR_HEADER];
+    unsigned char* p = NULL;
+    size_t pcap = 0;
+    long applied = 0;
+    long long good = 0;
+
+    while (fread(hdr, 1, JR_HEADER, f) == JR_HEADER) {
+        size_t plen = get_u32(hdr);
+        if (plen > (64u << 20)) break;          /* tamanho absurdo: lixo */
+        if (plen > pcap) {
+            unsigned char* np = (unsigned char*)realloc(p, plen);
+            if (!np) break;
+            p = np;
+            pcap = plen;
+        }
+        if (plen && fread(p, 1, plen, f) != plen) break;
+
+        unsigned int crc = crc_update(0, hdr + 8, 1);
+        if (plen) crc = crc_update(crc, p, plen);
+        if (crc != get_u32(hdr + 4)) break;
+
+        fn(ctx, hdr[8], p, plen);
+        applied++;
+        good += JR_HEADER + (long long)plen;
+    }
+    free(p);
+
+    /* cauda incompleta: corta para o próximo acréscimo começar no lugar certo */
+    fseek(f, 0, SEEK_END);
+    long long size = ftell(f);
+    fclose(f);
+    if (size > good) {
+        FILE* w = fopen(path, "r+b");
+        if (w) {
+            if (plat_ftruncate(plat_fileno(w), good) == 0 && torn) *torn += size - good;
+            fclose(w);
+        }
+    }
+    return applied;
+}
@@ -0,0 +1,101 @@
+#ifndef DIARIO_H
+#define DIARIO_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <pthread.h>
+
+/* Diário (write-ahead log) das alterações feitas desde o último save.
+   Cada alteração vira um registro físico e idempotente (imagem do livro,
+   do usuário, da fila; empréstimo criado/apagado; evento do histórico com
+   número de sequência), então reaplicar o diário sobre um estado que já
+   contém parte dele dá o mesmo resultado.
+
+   Os registros vão para um buffer; uma thread grava e faz fsync em grupo,
+   no máximo a cada 'latency_ms' (group commit). Quem precisa de garantia
+   espera o seu número (jr_wait).
+
+   O diário é dividido em segmentos (diario.000001.dat, ...). Um checkpoint
+   começa um segmento novo, grava o estado e então apaga os anteriores. */
+
+#define DIARIO_PREFIX "diario"
+#define DIARIO_LEGACY "diario.dat"  /* diário antigo, de um segmento só */
+#define DIARIO_LATENCY_MS 10    /* padrão; BIBLIOTECA_LATENCIA_MS muda */
+
+/* Tipos de registro. Os campos são little-endian em posição fixa, como
+   as tabelas do banco (livro e usuário usam o mesmo registro de lá). Numa
+   máquina little-endian é o mesmo leiaute das imagens de struct gravadas
+   antes, então um diário antigo ainda é reaplicado. */
+typedef enum {
+    J_BOOK_PUT = 1,   /* DB_REC_BOOK (insere ou substitui) */
+    J_BOOK_DEL = 2,   /* isbn 8 */
+    J_USER_PUT = 3,   /* DB_REC_USER */
+    J_USER_DEL = 4,   /* id 4 */
+    J_LOAN_ADD = 5,   /* JR_REC_LOAN */
+    J_LOAN_DEL = 6,   /* JR_REC_LOAN */
+    J_QUEUE    = 7,   /* JR_QUEUE_HDR + count x id 4 (fila inteira) */
+    J_HIST     = 8    /* JR_REC_HIST */
+} JournalOp;
+
+#define JR_REC_LOAN  16   /* user_id 4, zero 4, isbn 8 */
+#define JR_REC_HIST  32   /* seq 8 (posição no log), tipo 4, user_id 4, isbn 8, instante 8 */
+#define JR_QUEUE_HDR 12   /* isbn 8, count 4 */
+
+typedef struct {
+    FILE* f;
+    char prefix[64];
+    unsigned int seg;         /* segmento aberto */
+    pthread_t thread;
+    pthread_mutex_t mu;
+    pthread_cond_t wake;      /* acorda a thread de gravação */
+    pthread_cond_t durable;   /* avisa quem espera um fsync */
+
+    unsigned char* buf;       /* registros ainda não gravados */
+    size_t len;
+    size_t cap;
+
+    unsigned long long next_lsn;     /* número do próximo registro */
+    unsigned long long durable_lsn;  /* todos <= durable_lsn já estão no disco */
+    long long size;                  /* bytes no segmento aberto */
+    int latency_ms;
+    int stop;
+    int failed;                      /* erro de escrita: para de aceitar */
+    int flushing;                    /* a thread está gravando (sem o lock) */
+} Journal;
+
+/* Nome do arquivo de um segmento */
+void jr_segment_path(const char* prefix, unsigned int seg, char* out, size_t out_sz);
+
+/* Abre (criando se preciso) o segmento 'seg' para acréscimo e liga a
+   thread de gravação */
+int  jr_open(Journal* j, const char* prefix, unsigned int seg, int latency_ms);
+void jr_close(Journal* j);     /* grava o que falta e desliga */
+
+/* Enfileira um registro; retorna o número dele */
+unsigned long long jr_append(Journal* j, int op, const void* payload, size_t len);
+/* Idem, com o registro montado em duas partes (cabeçalho + vetor) */
+unsigned long long jr_append2(Journal* j, int op, const void* a, size_t alen, const void* b, size_t blen);
+
+/* Bloqueia até o registro 'lsn' (e os anteriores) estar no disco */
+void jr_wait(Journal* j, unsigned long long lsn);
+/* Último número entregue (0 = nenhum) */
+unsigned long long jr_last(Journal* j);
+/* 1 = uma gravação falhou: o diário parou e o que vem depois não está
+   protegido */
+int jr_failed(Journal* j);
+
+/* Grava o que está pendente, fecha o segmento e abre o próximo.
+   Retorna o número do segmento novo (0 = erro). */
+unsigned int jr_rotate(Journal* j);
+
+/* Bytes no segmento aberto (gravados + pendentes) */
+long long jr_size(Journal* j);
+
+/* Reaplica os registros íntegros de um arquivo; corta uma cauda
+   incompleta (queda no meio da gravação) e soma em *torn os bytes
+   cortados (pode ser NULL). Retorna quantos aplicou (-1 = o arquivo não
+   existe). */
+typedef void (*JournalApply)(void* ctx, int op, const unsigned char* p, size_t len);
+long jr_replay(const char* path, JournalApply fn, void* ctx, long long* torn);
+
+#endif
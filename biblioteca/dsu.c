@@ -3,10 +3,11 @@
 
 int dsu_init(DSU* d, int n) {
     d->n = n;
+    d->cap = (n > 16) ? n : 16;
     /*aloca vetores*/
-    d->parent = (int*)malloc(sizeof(int) * (size_t)n);
-    d->rnk    = (int*)malloc(sizeof(int) * (size_t)n);
-    d->sz     = (int*)malloc(sizeof(int) * (size_t)n);
+    d->parent = (int*)malloc(sizeof(int) * (size_t)d->cap);
+    d->rnk    = (int*)malloc(sizeof(int) * (size_t)d->cap);
+    d->sz     = (int*)malloc(sizeof(int) * (size_t)d->cap);
 
     if (!d->parent || !d->rnk || !d->sz) return 0;
     /* cada elemento começa em seu próprio grupo */
@@ -27,12 +28,44 @@ void dsu_free(DSU* d) {
     d->rnk = NULL;
     d->sz = NULL;
     d->n = 0;
+    d->cap = 0;
 }
 
+/* Cresce os vetores e cria um elemento novo em seu próprio grupo */
+int dsu_add(DSU* d) {
+    if (d->n == d->cap) {
+        int newcap = (d->cap == 0) ? 16 : d->cap * 2;
+        int* p = (int*)realloc(d->parent, sizeof(int) * (size_t)newcap);
+        if (!p) return -1;
+        d->parent = p;
+        p = (int*)realloc(d->rnk, sizeof(int) * (size_t)newcap);
+        if (!p) return -1;
+        d->rnk = p;
+        p = (int*)realloc(d->sz, sizeof(int) * (size_t)newcap);
+        if (!p) return -1;
+        d->sz = p;
+        d->cap = newcap;
+    }
+
+    int x = d->n++;
+    d->parent[x] = x;
+    d->rnk[x] = 0;
+    d->sz[x] = 1;
+    return x;
+}
+
+/* Iterativo: cadeias longas não estouram a pilha */
 int dsu_find(DSU* d, int x) {
-    if (d->parent[x] != x)
-        d->parent[x] = dsu_find(d, d->parent[x]); 
-    return d->parent[x];
+    int root = x;
+    while (d->parent[root] != root) root = d->parent[root];
+
+    /* segunda passada: compressão de caminho */
+    while (d->parent[x] != root) {
+        int next = d->parent[x];
+        d->parent[x] = root;
+        x = next;
+    }
+    return root;
 }
 
 /* Junta os grupos de a e b */
@@ -66,3 +99,103 @@ int dsu_size(DSU* d, int a) {
     int ra = dsu_find(d, a);
     return d->sz[ra];
 }
+
+/* ---------- Partição completa ---------- */
+
+void dsu_flatten(DSU* d) {
+    for (int i = 0; i < d->n; i++) {
+        d->parent[i] = dsu_find(d, i);
+    }
+}
+
+int dsu_groups(DSU* d, DSUGroups* g) {
+    int n = d->n;
+    g->ngroups = 0;
+    g->start = NULL;
+    g->members = NULL;
+    g->root = NULL;
+
+    dsu_flatten(d);
+
+    /* quantos grupos existem de cada tamanho */
+    int ng = 0;
+    int* by_size = (int*)calloc((size_t)n + 2, sizeof(int));
+    if (!by_size) return 0;
+    for (int i = 0; i < n; i++) {
+        if (d->parent[i] == i) {
+            by_size[d->sz[i]]++;
+            ng++;
+        }
+    }
+
+    /* posição inicial de cada tamanho na ordem decrescente */
+    int acc = 0;
+    for (int s = n; s >= 1; s--) {
+        int c = by_size[s];
+        by_size[s] = acc;
+        acc += c;
+    }
+
+    int* rank_of = (int*)malloc(sizeof(int) * (size_t)(n > 0 ? n : 1));  /* raiz -> posição */
+    g->root    = (int*)malloc(sizeof(int) * (size_t)(ng > 0 ? ng : 1));
+    g->start   = (int*)malloc(sizeof(int) * (size_t)ng + sizeof(int));
+    g->members = (int*)malloc(sizeof(int) * (size_t)(n > 0 ? n : 1));
+    if (!rank_of || !g->root || !g->start || !g->members) {
+        free(by_size);
+        free(rank_of);
+        dsu_groups_free(g);
+        return 0;
+    }
+
+    /* raízes em ordem crescente: empates ficam pela menor raiz */
+    for (int i = 0; i < n; i++) {
+        if (d->parent[i] != i) continue;
+        int pos = by_size[d->sz[i]]++;
+        rank_of[i] = pos;
+        g->root[pos] = i;
+    }
+
+    g->start[0] = 0;
+    for (int k = 0; k < ng; k++) {
+        g->start[k + 1] = g->start[k] + d->sz[g->root[k]];
+    }
+
+    /* distribui os membros (counting sort pela raiz); reaproveita by_size como cursor */
+    int* cursor = by_size;
+    for (int k = 0; k < ng; k++) cursor[k] = g->start[k];
+    for (int i = 0; i < n; i++) {
+        int k = rank_of[d->parent[i]];
+        g->members[cursor[k]++] = i;
+    }
+
+    g->ngroups = ng;
+    free(by_size);
+    free(rank_of);
+    return 1;
+}
+
+void dsu_groups_free(DSUGroups* g) {
+    if (!g) return;
+    free(g->start);
+    free(g->members);
+    free(g->root);
+    g->start = NULL;
+    g->members = NULL;
+    g->root = NULL;
+    g->ngroups = 0;
+}
+
+int* dsu_size_histogram(DSU* d, int* out_max) {
+    int max = 0;
+    for (int i = 0; i < d->n; i++) {
+        if (dsu_find(d, i) == i && d->sz[i] > max) max = d->sz[i];
+    }
+
+    int* hist = (int*)calloc((size_t)max + 1, sizeof(int));
+    if (!hist) return NULL;
+    for (int i = 0; i < d->n; i++) {
+        if (d->parent[i] == i) hist[d->sz[i]]++;
+    }
+    *out_max = max;
+    return hist;
+}
@@ -3,6 +3,7 @@
 
 typedef struct {
     int n;
+    int cap;    /* capacidade dos vetores (cresce em dsu_add) */
     int* parent;
     int* rnk;   /* ajuda a manter a árvore baixa */
     int* sz;    /* tamanho do conjunto */
@@ -11,10 +12,34 @@ typedef struct {
 int  dsu_init(DSU* d, int n);
 void dsu_free(DSU* d);
 
+/* adiciona um novo elemento (grupo próprio); retorna o índice ou -1 */
+int  dsu_add(DSU* d);
+
 int  dsu_find(DSU* d, int x);
 void dsu_union(DSU* d, int a, int b);
 
 int  dsu_same(DSU* d, int a, int b);
 int  dsu_size(DSU* d, int a);
 
+/* ---------- Partição completa ---------- */
+
+/* Todos os grupos de uma vez, do maior para o menor.
+   Membros do grupo i: members[start[i] .. start[i+1]-1] (em ordem crescente). */
+typedef struct {
+    int ngroups;
+    int* start;     /* ngroups + 1 posições */
+    int* members;   /* n elementos agrupados */
+    int* root;      /* raiz (representante) de cada grupo */
+} DSUGroups;
+
+/* aponta cada elemento direto para a raiz (uma passada) */
+void dsu_flatten(DSU* d);
+
+/* agrupa por raiz com counting sort e ordena os grupos por tamanho: O(n) */
+int  dsu_groups(DSU* d, DSUGroups* g);
+void dsu_groups_free(DSUGroups* g);
+
+/* hist[s] = quantos grupos têm tamanho s (s de 0 a *out_max); liberar com free */
+int* dsu_size_histogram(DSU* d, int* out_max);
+
 #endif
@@ -0,0 +1,135 @@
+#include "dsu_paralelo.h"
+#include <stdlib.h>
+#include <pthread.h>
+#include <unistd.h>
+
+int cdsu_init(CDSU* d, int n) {
+    d->n = n;
+    d->parent = (atomic_int*)malloc(sizeof(atomic_int) * (size_t)(n > 0 ? n : 1));
+    if (!d->parent) return 0;
+    for (int i = 0; i < n; i++) atomic_init(&d->parent[i], i);
+    return 1;
+}
+
+void cdsu_free(CDSU* d) {
+    if (!d) return;
+    free(d->parent);
+    d->parent = NULL;
+    d->n = 0;
+}
+
+/* path halving: se outra thread mudou o pai, o CAS falha e seguimos igual */
+int cdsu_find(CDSU* d, int x) {
+    while (1) {
+        int p = atomic_load(&d->parent[x]);
+        if (p == x) return x;
+        int gp = atomic_load(&d->parent[p]);
+        if (p != gp) atomic_compare_exchange_weak(&d->parent[x], &p, gp);
+        x = gp;
+    }
+}
+
+void cdsu_union(CDSU* d, int a, int b) {
+    while (1) {
+        int ra = cdsu_find(d, a);
+        int rb = cdsu_find(d, b);
+        if (ra == rb) return;
+
+        /* liga sempre a raiz maior na menor: não forma ciclos */
+        if (ra < rb) {
+            int t = ra;
+            ra = rb;
+            rb = t;
+        }
+        int expected = ra;
+        if (atomic_compare_exchange_strong(&d->parent[ra], &expected, rb)) return;
+        /* ra deixou de ser raiz no meio do caminho: tenta de novo */
+    }
+}
+
+/* ---------- Fatias em paralelo ---------- */
+
+typedef struct {
+    CDSU* d;
+    const int* a;
+    const int* b;
+    long from;
+    long to;
+} UnionSlice;
+
+static void* union_worker(void* arg) {
+    UnionSlice* s = (UnionSlice*)arg;
+    for (long i = s->from; i < s->to; i++) {
+        cdsu_union(s->d, s->a[i], s->b[i]);
+    }
+    return NULL;
+}
+
+int cdsu_union_pairs(CDSU* d, const int* a, const int* b, long n, int nthreads) {
+    if (nthreads < 1) nthreads = 1;
+    if (n < (long)nthreads * 1024) nthreads = 1; /* pouco trabalho: não compensa */
+
+    pthread_t* th = (pthread_t*)malloc(sizeof(pthread_t) * (size_t)nthreads);
+    UnionSlice* sl = (UnionSlice*)malloc(sizeof(UnionSlice) * (size_t)nthreads);
+    char* running = (char*)calloc((size_t)nthreads, 1);
+    if (!th || !sl || !running) {
+        free(th);
+        free(sl);
+        free(running);
+        return 0;
+    }
+
+    long chunk = (n + nthreads - 1) / nthreads;
+    for (int t = 0; t < nthreads; t++) {
+        sl[t].d = d;
+        sl[t].a = a;
+        sl[t].b = b;
+        sl[t].from = (long)t * chunk;
+        sl[t].to = (sl[t].from + chunk < n) ? sl[t].from + chunk : n;
+        if (sl[t].from > sl[t].to) sl[t].from = sl[t].to;
+    }
+
+    /* a fatia 0 roda na thread chamadora; se não conseguir criar uma
+       thread, a fatia dela também roda aqui */
+    for (int t = 1; t < nthreads; t++) {
+        if (sl[t].from == sl[t].to) continue;
+        if (pthread_create(&th[t], NULL, union_worker, &sl[t]) == 0) running[t] = 1;
+        else union_worker(&sl[t]);
+    }
+    union_worker(&sl[0]);
+
+    for (int t = 1; t < nthreads; t++) {
+        if (running[t]) pthread_join(th[t], NULL);
+    }
+
+    free(th);
+    free(sl);
+    free(running);
+    return 1;
+}
+
+int cdsu_to_dsu(CDSU* c, DSU* out) {
+    if (!dsu_init(out, c->n)) return 0;
+
+    /* todos apontam para a raiz (o menor elemento do grupo) */
+    for (int i = 0; i < c->n; i++) {
+        int r = cdsu_find(c, i);
+        out->parent[i] = r;
+        out->sz[i] = 0;
+        out->rnk[i] = 0;
+    }
+    for (int i = 0; i < c->n; i++) {
+        int r = out->parent[i];
+        out->sz[r]++;
+        if (r != i) out->rnk[r] = 1;
+    }
+    return 1;
+}
+
+int cdsu_default_threads(void) {
+#ifdef _SC_NPROCESSORS_ONLN
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    if (n >= 1 && n <= 64) return (int)n;
+#endif
+    return 4;
+}
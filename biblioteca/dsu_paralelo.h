@@ -0,0 +1,33 @@
+#ifndef DSU_PARALELO_H
+#define DSU_PARALELO_H
+
+#include <stdatomic.h>
+#include "dsu.h"
+
+/* Union-Find concorrente (sem locks): várias threads fazem union/find ao
+   mesmo tempo usando compare-and-swap.
+   - find: "path halving", cada passo tenta apontar x para o avô
+   - union: a raiz de maior índice é ligada à de menor índice, então a
+     raiz final de cada grupo é sempre o menor elemento (resultado igual
+     para qualquer ordem ou número de threads) */
+typedef struct {
+    int n;
+    atomic_int* parent;
+} CDSU;
+
+int  cdsu_init(CDSU* d, int n);
+void cdsu_free(CDSU* d);
+
+int  cdsu_find(CDSU* d, int x);
+void cdsu_union(CDSU* d, int a, int b);
+
+/* une os pares (a[i], b[i]) dividindo o vetor em fatias, uma por thread */
+int  cdsu_union_pairs(CDSU* d, const int* a, const int* b, long n, int nthreads);
+
+/* converte para o DSU sequencial (mesma partição, já achatado) */
+int  cdsu_to_dsu(CDSU* c, DSU* out);
+
+/* número de threads padrão (processadores disponíveis) */
+int  cdsu_default_threads(void);
+
+#endif
@@ -1,11 +1,28 @@
 #include "emprestimos.h"
+#include "busca_usuarios.h"
+#include "dsu_paralelo.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
 
 #define LOANS_FILE   "emprestimos.dat"
 #define WAITS_FILE   "filas.dat"
 #define HISTORY_FILE "historico.dat"
 
+/* historico.dat: cabeçalho mágico + registros (tipo, usuário, isbn, ts) do
+   mais antigo para o mais recente, lidos direto para o log.
+   Formatos antigos (HST2 e sem cabeçalho, do mais recente para o mais
+   antigo) continuam sendo lidos. */
+#define HISTORY_MAGIC3 0x33545348 /* "HST3" */
+#define HISTORY_MAGIC  0x32545348 /* "HST2" */
+
+/* a partir de quantos pares a reconstrução das comunidades usa threads */
+#define COMM_PARALLEL_MIN 65536
+
+/* tamanho inicial das hashes de empréstimos e filas (dobram quando enchem) */
+#define LOAN_INITIAL 1024
+
 /* ---------- Função segura de alocação ---------- */
 
 static void* xmalloc(size_t sz) {
@@ -19,41 +36,187 @@ static void* xmalloc(size_t sz) {
 
 /* ---------- HISTÓRICO (PILHA) ---------- */
 
-static void hist_push(LoanSystem* ls, ActionType t, int user_id, long long isbn) {
-    HistNode* h = (HistNode*)xmalloc(sizeof(HistNode));
-    h->type = t;
-    h->user_id = user_id;
-    h->isbn = isbn;
-    h->next = ls->history;
-    ls->history = h;
+static void hist_push_at(LoanSystem* ls, ActionType t, int user_id, long long isbn, long long ts) {
+    long pos = hl_append(&ls->history, (int)t, user_id, isbn, ts);
+    /* com o histórico ainda no banco, os índices são feitos ao carregá-lo */
+    if (!ls->hist_lazy) hi_add(&ls->hidx, &ls->history, pos);
+
+    if (ls->jr) {
+        unsigned char r[JR_REC_HIST];
+        le_put64(r, (unsigned long long)(ls->hist_base + pos));
+        le_put32(r + 8, (unsigned int)t);
+        le_put32(r + 12, (unsigned int)user_id);
+        le_put64(r + 16, (unsigned long long)isbn);
+        le_put64(r + 24, (unsigned long long)ts);
+        jr_append(ls->jr, J_HIST, r, sizeof(r));
+    }
+
+    /* empréstimos alimentam tendências, comunidades e recomendações e,
+       depois da abertura (ls->sk ligado), os esboços: novos ou importados */
+    if (t == ACT_BORROW || t == ACT_AUTO_BORROW) {
+        trend_add(ls->trend, isbn, ts);
+        if (ls->comm.valid) cm_link(&ls->comm, user_id, isbn);
+        ls->rec.pending++;
+        if (ls->sk) {
+            const Book* b = ls->hb ? hb_get(ls->hb, isbn) : NULL;
+            sk_observe(ls->sk, user_id, isbn, b ? b->author : NULL);
+        }
+    }
 }
 
-/* Imprime o histórico (mais recente primeiro) */
-void ls_print_history(LoanSystem* ls) {
-    if (!ls->history) {
-        printf("\n(Histórico vazio)\n");
-        return;
+/* Evento novo (agora) */
+static void hist_push(LoanSystem* ls, ActionType t, int user_id, const Book* b) {
+    hist_push_at(ls, t, user_id, b->isbn, (long long)time(NULL));
+}
+
+/* Nome de um tipo de evento do histórico */
+const char* ls_action_name(int type) {
+    switch (type) {
+        case ACT_BORROW:      return "EMPRÉSTIMO";
+        case ACT_RETURN:      return "DEVOLUÇÃO";
+        case ACT_ENQUEUE:     return "FILA";
+        case ACT_AUTO_BORROW: return "AUTO-EMPRÉSTIMO";
+        default:              return "DESCONHECIDO";
+    }
+}
+
+long ls_history_of_user(LoanSystem* ls, int user_id, long long from, long long to, const HistPos** out) {
+    ls_history_ready(ls);
+    return hi_user_range(&ls->hidx, &ls->history, user_id, from, to, out);
+}
+
+long ls_history_of_book(LoanSystem* ls, long long isbn, long long from, long long to, const HistPos** out) {
+    ls_history_ready(ls);
+    return hi_book_range(&ls->hidx, &ls->history, isbn, from, to, out);
+}
+
+long ls_history_between(LoanSystem* ls, long long from, long long to, const HistPos** out) {
+    ls_history_ready(ls);
+    return hi_time_range(&ls->hidx, &ls->history, from, to, out);
+}
+
+/* ---------- EMPRÉSTIMOS ATIVOS (HASH + LISTAS) ---------- */
+
+static void* xcalloc(size_t n, size_t sz) {
+    void* p = calloc(n, sz);
+    if (!p) {
+        printf("Erro: sem memória.\n");
+        exit(1);
     }
+    return p;
+}
+
+static unsigned int mix(unsigned long long x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return (unsigned int)(x & 0xFFFFFFFFu);
+}
+
+static int loan_bucket(int user_id, long long isbn, int size) {
+    unsigned long long k = (unsigned long long)isbn * 0x9E3779B97F4A7C15ULL ^ (unsigned int)user_id;
+    return (int)(mix(k) % (unsigned int)size);
+}
 
-    printf("\n---- HISTÓRICO (TOPO = MAIS RECENTE) ----\n");
-    for (HistNode* h = ls->history; h; h = h->next) {
-        const char* label = "???";
-        switch (h->type) {
-            case ACT_BORROW:      label = "EMPRÉSTIMO"; break;
-            case ACT_RETURN:      label = "DEVOLUÇÃO"; break;
-            case ACT_ENQUEUE:     label = "FILA"; break;
-            case ACT_AUTO_BORROW: label = "AUTO-EMPRÉSTIMO"; break;
-            default:              label = "DESCONHECIDO"; break;
+static int head_bucket(long long key, int size) {
+    return (int)(mix((unsigned long long)key) % (unsigned int)size);
+}
+
+static void loans_grow(LoanSystem* ls) {
+    int newsize = ls->loan_size * 2;
+    LoanNode** nt = (LoanNode**)xcalloc((size_t)newsize, sizeof(LoanNode*));
+    for (int i = 0; i < ls->loan_size; i++) {
+        LoanNode* n = ls->loan_table[i];
+        while (n) {
+            LoanNode* nx = n->hnext;
+            int b = loan_bucket(n->user_id, n->isbn, newsize);
+            n->hnext = nt[b];
+            nt[b] = n;
+            n = nx;
         }
-        printf("%s | user_id=%d | isbn=%I64d\n", label, h->user_id, (long long)h->isbn);
     }
+    free(ls->loan_table);
+    ls->loan_table = nt;
+    ls->loan_size = newsize;
 }
 
-/* ---------- EMPRÉSTIMOS ATIVOS (LISTA) ---------- */
+static void heads_init(LoanHeadMap* m) {
+    m->size = LOAN_INITIAL;
+    m->n = 0;
+    m->table = (LoanHead**)xcalloc((size_t)m->size, sizeof(LoanHead*));
+}
+
+static void heads_free(LoanHeadMap* m) {
+    for (int i = 0; i < m->size; i++) {
+        LoanHead* h = m->table[i];
+        while (h) {
+            LoanHead* nx = h->next;
+            free(h);
+            h = nx;
+        }
+    }
+    free(m->table);
+    m->table = NULL;
+    m->size = m->n = 0;
+}
+
+static void heads_grow(LoanHeadMap* m) {
+    int newsize = m->size * 2;
+    LoanHead** nt = (LoanHead**)xcalloc((size_t)newsize, sizeof(LoanHead*));
+    for (int i = 0; i < m->size; i++) {
+        LoanHead* h = m->table[i];
+        while (h) {
+            LoanHead* nx = h->next;
+            int b = head_bucket(h->key, newsize);
+            h->next = nt[b];
+            nt[b] = h;
+            h = nx;
+        }
+    }
+    free(m->table);
+    m->table = nt;
+    m->size = newsize;
+}
+
+static LoanHead* head_find(LoanHeadMap* m, long long key) {
+    for (LoanHead* h = m->table[head_bucket(key, m->size)]; h; h = h->next) {
+        if (h->key == key) return h;
+    }
+    return NULL;
+}
+
+static LoanHead* head_get_or_add(LoanHeadMap* m, long long key) {
+    LoanHead* h = head_find(m, key);
+    if (h) return h;
+
+    if (m->n >= m->size) heads_grow(m);
+    int b = head_bucket(key, m->size);
+    h = (LoanHead*)xmalloc(sizeof(LoanHead));
+    h->key = key;
+    h->first = NULL;
+    h->count = 0;
+    h->waits = NULL;
+    h->n_waits = 0;
+    h->next = m->table[b];
+    m->table[b] = h;
+    m->n++;
+    return h;
+}
+
+/* Tira a cabeça da hash (quando a lista dela esvaziou) */
+static void head_remove(LoanHeadMap* m, LoanHead* h) {
+    LoanHead** pp = &m->table[head_bucket(h->key, m->size)];
+    while (*pp && *pp != h) pp = &(*pp)->next;
+    if (*pp) *pp = h->next;
+    free(h);
+    m->n--;
+}
 
 /* Procura um empréstimo específico */
 static LoanNode* loan_find(LoanSystem* ls, int user_id, long long isbn) {
-    for (LoanNode* cur = ls->loans; cur; cur = cur->next) {
+    for (LoanNode* cur = ls->loan_table[loan_bucket(user_id, isbn, ls->loan_size)]; cur; cur = cur->hnext) {
         if (cur->user_id == user_id && cur->isbn == isbn) return cur;
     }
     return NULL;
@@ -63,45 +226,127 @@ static void loan_add(LoanSystem* ls, int user_id, long long isbn) {
     LoanNode* n = (LoanNode*)xmalloc(sizeof(LoanNode));
     n->user_id = user_id;
     n->isbn = isbn;
+
+    /* lista geral (no começo, como antes) */
+    n->prev = NULL;
     n->next = ls->loans;
+    if (ls->loans) ls->loans->prev = n;
     ls->loans = n;
+
+    /* hash */
+    if (ls->n_loans >= ls->loan_size) loans_grow(ls);
+    int b = loan_bucket(user_id, isbn, ls->loan_size);
+    n->hnext = ls->loan_table[b];
+    ls->loan_table[b] = n;
+    ls->n_loans++;
+
+    /* lista do usuário */
+    LoanHead* u = head_get_or_add(&ls->by_user, user_id);
+    n->u_prev = NULL;
+    n->u_next = u->first;
+    if (u->first) u->first->u_prev = n;
+    u->first = n;
+    u->count++;
+
+    /* lista do livro */
+    LoanHead* k = head_get_or_add(&ls->by_book, isbn);
+    n->b_prev = NULL;
+    n->b_next = k->first;
+    if (k->first) k->first->b_prev = n;
+    k->first = n;
+    k->count++;
 }
 
 /* Remove um empréstimo ativo */
 static int loan_remove(LoanSystem* ls, int user_id, long long isbn) {
-    LoanNode* prev = NULL;
-    LoanNode* cur = ls->loans;
+    LoanNode** pp = &ls->loan_table[loan_bucket(user_id, isbn, ls->loan_size)];
+    while (*pp && !((*pp)->user_id == user_id && (*pp)->isbn == isbn)) pp = &(*pp)->hnext;
+    LoanNode* n = *pp;
+    if (!n) return 0;
+    *pp = n->hnext;
+    ls->n_loans--;
 
-    while (cur) {
-        if (cur->user_id == user_id && cur->isbn == isbn) {
-            if (prev) prev->next = cur->next;
-            else ls->loans = cur->next;
-            free(cur);
-            return 1;
+    if (n->prev) n->prev->next = n->next;
+    else ls->loans = n->next;
+    if (n->next) n->next->prev = n->prev;
+
+    LoanHead* u = head_find(&ls->by_user, user_id);
+    if (n->u_prev) n->u_prev->u_next = n->u_next;
+    else u->first = n->u_next;
+    if (n->u_next) n->u_next->u_prev = n->u_prev;
+    if (--u->count == 0 && u->n_waits == 0) head_remove(&ls->by_user, u);
+
+    LoanHead* k = head_find(&ls->by_book, isbn);
+    if (n->b_prev) n->b_prev->b_next = n->b_next;
+    else k->first = n->b_next;
+    if (n->b_next) n->b_next->b_prev = n->b_prev;
+    if (--k->count == 0) head_remove(&ls->by_book, k);
+
+    free(n);
+    return 1;
+}
+
+const LoanNode* ls_loans_of_user(LoanSystem* ls, int user_id, int* count) {
+    LoanHead* h = head_find(&ls->by_user, user_id);
+    if (count) *count = h ? h->count : 0;
+    return h ? h->first : NULL;
+}
+
+const LoanNode* ls_holders_of_book(LoanSystem* ls, long long isbn, int* count) {
+    LoanHead* h = head_find(&ls->by_book, isbn);
+    if (count) *count = h ? h->count : 0;
+    return h ? h->first : NULL;
+}
+
+int ls_has_loan(LoanSystem* ls, int user_id, long long isbn) {
+    return loan_find(ls, user_id, isbn) != NULL;
+}
+
+/* ---------- FILA DE ESPERA (FILA) ---------- */
+
+static int isbn_bucket(long long isbn, int size) {
+    return (int)(mix((unsigned long long)isbn) % (unsigned int)size);
+}
+
+static void waits_grow(LoanSystem* ls) {
+    int newsize = ls->wait_size * 2;
+    WaitList** nt = (WaitList**)xcalloc((size_t)newsize, sizeof(WaitList*));
+    for (int i = 0; i < ls->wait_size; i++) {
+        WaitList* w = ls->wait_table[i];
+        while (w) {
+            WaitList* nx = w->hnext;
+            int b = isbn_bucket(w->isbn, newsize);
+            w->hnext = nt[b];
+            nt[b] = w;
+            w = nx;
         }
-        prev = cur;
-        cur = cur->next;
     }
-    return 0;
+    free(ls->wait_table);
+    ls->wait_table = nt;
+    ls->wait_size = newsize;
 }
-/* Imprime os empréstimos ativos */
-void ls_print_loans(LoanSystem* ls) {
-    if (!ls->loans) {
-        printf("\n(Nenhum empréstimo ativo)\n");
-        return;
-    }
 
-    printf("\n---- EMPRÉSTIMOS ATIVOS ----\n");
-    for (LoanNode* cur = ls->loans; cur; cur = cur->next) {
-        printf("user_id=%d | isbn=%I64d\n", cur->user_id, (long long)cur->isbn);
+static void waiters_grow(LoanSystem* ls) {
+    int newsize = ls->waiter_size * 2;
+    WaitNode** nt = (WaitNode**)xcalloc((size_t)newsize, sizeof(WaitNode*));
+    for (int i = 0; i < ls->waiter_size; i++) {
+        WaitNode* n = ls->waiter_table[i];
+        while (n) {
+            WaitNode* nx = n->hnext;
+            int b = loan_bucket(n->user_id, n->list->isbn, newsize);
+            n->hnext = nt[b];
+            nt[b] = n;
+            n = nx;
+        }
     }
+    free(ls->waiter_table);
+    ls->waiter_table = nt;
+    ls->waiter_size = newsize;
 }
 
-/* ---------- FILA DE ESPERA (FILA) ---------- */
-
 /* Procura a fila de um livro */
 static WaitList* waitlist_find(LoanSystem* ls, long long isbn) {
-    for (WaitList* w = ls->waits; w; w = w->next) {
+    for (WaitList* w = ls->wait_table[isbn_bucket(isbn, ls->wait_size)]; w; w = w->hnext) {
         if (w->isbn == isbn) return w;
     }
     return NULL;
@@ -111,21 +356,129 @@ static WaitList* waitlist_get_or_create(LoanSystem* ls, long long isbn) {
     WaitList* w = waitlist_find(ls, isbn);
     if (w) return w;
 
+    if (ls->n_waits >= ls->wait_size) waits_grow(ls);
+    int b = isbn_bucket(isbn, ls->wait_size);
+
     w = (WaitList*)xmalloc(sizeof(WaitList));
     w->isbn = isbn;
     w->front = NULL;
     w->rear = NULL;
+    w->count = 0;
+    w->next_ticket = 0;
+    w->gaps = NULL;
+    w->gaps_head = w->n_gaps = w->gaps_cap = 0;
+    w->hnext = ls->wait_table[b];
+    ls->wait_table[b] = w;
+    w->prev = NULL;
     w->next = ls->waits;
+    if (ls->waits) ls->waits->prev = w;
     ls->waits = w;
+    ls->n_waits++;
     return w;
 }
-/* Coloca usuário no final da fila */
-static void wait_enqueue(LoanSystem* ls, long long isbn, int user_id) {
+/* Libera a fila que esvaziou */
+static void waitlist_release(LoanSystem* ls, WaitList* w) {
+    WaitList** pp = &ls->wait_table[isbn_bucket(w->isbn, ls->wait_size)];
+    while (*pp && *pp != w) pp = &(*pp)->hnext;
+    if (*pp) *pp = w->hnext;
+
+    if (w->prev) w->prev->next = w->next;
+    else ls->waits = w->next;
+    if (w->next) w->next->prev = w->prev;
+
+    ls->n_waits--;
+    free(w->gaps);
+    free(w);
+}
+/* Lugar do usuário na fila do ISBN (NULL se não está) */
+static WaitNode* waiter_find(LoanSystem* ls, int user_id, long long isbn) {
+    for (WaitNode* n = ls->waiter_table[loan_bucket(user_id, isbn, ls->waiter_size)]; n; n = n->hnext) {
+        if (n->user_id == user_id && n->list->isbn == isbn) return n;
+    }
+    return NULL;
+}
+/* Guarda a senha de quem saiu do meio da fila (vetor ordenado) */
+static void gap_add(WaitList* w, long ticket) {
+    if (w->gaps_head > 0 && w->gaps_head * 2 >= w->n_gaps) {
+        /* descarta o começo já vencido antes de crescer */
+        for (int i = w->gaps_head; i < w->n_gaps; i++) w->gaps[i - w->gaps_head] = w->gaps[i];
+        w->n_gaps -= w->gaps_head;
+        w->gaps_head = 0;
+    }
+    if (w->n_gaps == w->gaps_cap) {
+        int nc = w->gaps_cap ? w->gaps_cap * 2 : 8;
+        long* ng = (long*)realloc(w->gaps, (size_t)nc * sizeof(long));
+        if (!ng) {
+            printf("Erro: sem memória.\n");
+            exit(1);
+        }
+        w->gaps = ng;
+        w->gaps_cap = nc;
+    }
+    int i = w->n_gaps++;
+    while (i > w->gaps_head && w->gaps[i - 1] > ticket) {
+        w->gaps[i] = w->gaps[i - 1];
+        i--;
+    }
+    w->gaps[i] = ticket;
+}
+
+/* Quantas senhas vagas ficam antes de 'ticket' (busca binária) */
+static int gaps_before(const WaitList* w, long ticket) {
+    int lo = w->gaps_head, hi = w->n_gaps;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (w->gaps[mid] < ticket) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo - w->gaps_head;
+}
+
+/* Tira um lugar de qualquer ponto da fila (e de todos os índices).
+   Libera a fila se ela esvaziou. */
+static void wait_unlink(LoanSystem* ls, WaitNode* n) {
+    WaitList* w = n->list;
+
+    if (n == w->front) {
+        w->front = n->next;
+        /* as vagas que ficaram antes da nova frente não contam mais */
+        if (w->front) {
+            while (w->gaps_head < w->n_gaps && w->gaps[w->gaps_head] < w->front->ticket) w->gaps_head++;
+        }
+    } else {
+        n->prev->next = n->next;
+        gap_add(w, n->ticket);
+    }
+    if (n->next) n->next->prev = n->prev;
+    else w->rear = n->prev;
+    w->count--;
+
+    WaitNode** pp = &ls->waiter_table[loan_bucket(n->user_id, w->isbn, ls->waiter_size)];
+    while (*pp && *pp != n) pp = &(*pp)->hnext;
+    if (*pp) *pp = n->hnext;
+    ls->n_waiters--;
+
+    LoanHead* u = head_find(&ls->by_user, n->user_id);
+    if (n->u_prev) n->u_prev->u_next = n->u_next;
+    else u->waits = n->u_next;
+    if (n->u_next) n->u_next->u_prev = n->u_prev;
+    if (--u->n_waits == 0 && u->count == 0) head_remove(&ls->by_user, u);
+
+    free(n);
+    if (w->count == 0) waitlist_release(ls, w);
+}
+/* Coloca usuário no final da fila (0 se ele já estava nela) */
+static int wait_enqueue(LoanSystem* ls, long long isbn, int user_id) {
+    if (waiter_find(ls, user_id, isbn)) return 0;
+
     WaitList* w = waitlist_get_or_create(ls, isbn);
 
     WaitNode* n = (WaitNode*)xmalloc(sizeof(WaitNode));
     n->user_id = user_id;
+    n->ticket = w->next_ticket++;
+    n->list = w;
     n->next = NULL;
+    n->prev = w->rear;
 
     if (!w->rear) {
         w->front = w->rear = n;
@@ -133,49 +486,292 @@ static void wait_enqueue(LoanSystem* ls, long long isbn, int user_id) {
         w->rear->next = n;
         w->rear = n;
     }
+    w->count++;
+
+    if (ls->n_waiters >= ls->waiter_size) waiters_grow(ls);
+    int b = loan_bucket(user_id, isbn, ls->waiter_size);
+    n->hnext = ls->waiter_table[b];
+    ls->waiter_table[b] = n;
+    ls->n_waiters++;
+
+    LoanHead* u = head_get_or_add(&ls->by_user, user_id);
+    n->u_prev = NULL;
+    n->u_next = u->waits;
+    if (u->waits) u->waits->u_prev = n;
+    u->waits = n;
+    u->n_waits++;
+    return 1;
 }
 /* Remove o primeiro da fila */
 static int wait_dequeue(LoanSystem* ls, long long isbn, int* out_user_id) {
     WaitList* w = waitlist_find(ls, isbn);
     if (!w || !w->front) return 0;
 
-    WaitNode* n = w->front;
-    *out_user_id = n->user_id;
+    *out_user_id = w->front->user_id;
+    wait_unlink(ls, w->front);
+    return 1;
+}
 
-    w->front = n->next;
-    if (!w->front) w->rear = NULL;
+int ls_wait_position(LoanSystem* ls, int user_id, long long isbn, int* total) {
+    WaitList* w = waitlist_find(ls, isbn);
+    if (total) *total = w ? w->count : 0;
 
-    free(n);
-    return 1;
+    WaitNode* n = waiter_find(ls, user_id, isbn);
+    if (!n) return 0;
+    /* senhas entre a frente e n, menos as de quem saiu do meio */
+    return (int)(n->ticket - w->front->ticket) - gaps_before(w, n->ticket) + 1;
 }
 
-/* Imprime todas as filas */
-void ls_print_waits(LoanSystem* ls) {
-    if (!ls->waits) {
-        printf("\n(Nenhuma fila de espera)\n");
-        return;
+/* ---------- DIÁRIO (WRITE-AHEAD LOG) ---------- */
+
+static void log_loan(LoanSystem* ls, int op, int user_id, long long isbn) {
+    if (!ls->jr) return;
+    unsigned char r[JR_REC_LOAN];
+    memset(r, 0, sizeof(r));
+    le_put32(r, (unsigned int)user_id);
+    le_put64(r + 8, (unsigned long long)isbn);
+    jr_append(ls->jr, op, r, sizeof(r));
+}
+
+/* Imagem inteira da fila do ISBN (vazia se ela não existe mais) */
+static void log_queue(LoanSystem* ls, long long isbn) {
+    if (!ls->jr) return;
+    WaitList* w = waitlist_find(ls, isbn);
+    int count = w ? w->count : 0;
+
+    unsigned char hdr[JR_QUEUE_HDR];
+    le_put64(hdr, (unsigned long long)isbn);
+    le_put32(hdr + 8, (unsigned int)count);
+
+    unsigned char* ids = (unsigned char*)xmalloc((size_t)(count ? count : 1) * 4);
+    int i = 0;
+    if (w) {
+        for (WaitNode* n = w->front; n; n = n->next) le_put32(ids + 4 * i++, (unsigned int)n->user_id);
     }
+    jr_append2(ls->jr, J_QUEUE, hdr, sizeof(hdr), ids, (size_t)count * 4);
+    free(ids);
+}
 
-    printf("\n---- FILAS DE ESPERA ----\n");
-    for (WaitList* w = ls->waits; w; w = w->next) {
-        printf("ISBN %I64d: ", (long long)w->isbn);
-        if (!w->front) {
-            printf("(vazia)\n");
-            continue;
+void ls_log_book_put(LoanSystem* ls, const Book* b) {
+    if (!ls->jr) return;
+    unsigned char r[DB_REC_BOOK];
+    book_encode(b, r);
+    jr_append(ls->jr, J_BOOK_PUT, r, sizeof(r));
+}
+
+void ls_log_book_del(LoanSystem* ls, long long isbn) {
+    if (!ls->jr) return;
+    unsigned char r[8];
+    le_put64(r, (unsigned long long)isbn);
+    jr_append(ls->jr, J_BOOK_DEL, r, sizeof(r));
+}
+
+void ls_log_user_put(LoanSystem* ls, const User* u) {
+    if (!ls->jr) return;
+    unsigned char r[DB_REC_USER];
+    user_encode(u, r);
+    jr_append(ls->jr, J_USER_PUT, r, sizeof(r));
+}
+
+void ls_log_user_del(LoanSystem* ls, int user_id) {
+    if (!ls->jr) return;
+    unsigned char r[4];
+    le_put32(r, (unsigned int)user_id);
+    jr_append(ls->jr, J_USER_DEL, r, sizeof(r));
+}
+
+/* Contexto do replay. Livros e usuários são achados pelas hashes do motor
+   (ls->hb, ls->hu), montadas no primeiro registro que precisa delas; até
+   lá (e num diário só de empréstimos) o motor as monta depois. */
+typedef struct {
+    LoanSystem* ls;
+    BookNode** books;
+    UserNode** users;
+    SlotMap* book_slots;
+    SlotMap* user_slots;
+} ReplayCtx;
+
+/* Aplica um registro. Todos são idempotentes: reaplicar não muda nada. */
+static void replay_one(void* ctx, int op, const unsigned char* p, size_t len) {
+    ReplayCtx* c = (ReplayCtx*)ctx;
+    LoanSystem* ls = c->ls;
+
+    switch (op) {
+        case J_BOOK_PUT: {
+            if (len != DB_REC_BOOK) return;
+            Book b;
+            book_decode(p, &b);
+            if (ls->hb->n == 0) hb_build_from_list(ls->hb, *c->books);
+            BookNode* bn = hb_get_node(ls->hb, b.isbn);
+            if (bn) {
+                bn->data = b;
+                books_touch(bn);
+            } else {
+                books_push_front(c->books, &b);
+                hb_insert(ls->hb, *c->books);
+            }
+            break;
         }
-        for (WaitNode* n = w->front; n; n = n->next) {
-            printf("%d ", n->user_id);
+        case J_BOOK_DEL: {
+            if (len != 8) return;
+            long long isbn = (long long)le_get64(p);
+            if (ls->hb->n == 0) hb_build_from_list(ls->hb, *c->books);
+            /* a hash aponta para o nó e tem de largá-lo antes */
+            if (hb_remove(ls->hb, isbn)) books_remove(c->books, c->book_slots, isbn);
+            break;
+        }
+        case J_USER_PUT: {
+            if (len != DB_REC_USER) return;
+            User u;
+            user_decode(p, &u);
+            if (ls->hu->n == 0) hu_build_from_list(ls->hu, *c->users);
+            UserNode* un = hu_get(ls->hu, u.id);
+            if (un) {
+                un->data = u;
+                users_touch(un);
+            } else {
+                users_push_front(c->users, &u);
+                hu_insert(ls->hu, *c->users);
+            }
+            break;
+        }
+        case J_USER_DEL: {
+            if (len != 4) return;
+            int id = (int)le_get32(p);
+            if (ls->hu->n == 0) hu_build_from_list(ls->hu, *c->users);
+            if (hu_remove(ls->hu, id)) users_remove(c->users, c->user_slots, id);
+            break;
+        }
+        case J_LOAN_ADD:
+        case J_LOAN_DEL: {
+            if (len != JR_REC_LOAN) return;
+            int user_id = (int)le_get32(p);
+            long long isbn = (long long)le_get64(p + 8);
+            int has = loan_find(ls, user_id, isbn) != NULL;
+            if (op == J_LOAN_ADD && !has) loan_add(ls, user_id, isbn);
+            if (op == J_LOAN_DEL && has) loan_remove(ls, user_id, isbn);
+            break;
         }
-        printf("\n");
+        case J_QUEUE: {
+            size_t hl = JR_QUEUE_HDR;
+            if (len < hl) return;
+            long long isbn = (long long)le_get64(p);
+            int count = (int)le_get32(p + 8);
+            if (count < 0 || len != hl + (size_t)count * 4) return;
+
+            WaitList* w = waitlist_find(ls, isbn);
+            while (w) {
+                int last = (w->count == 1);
+                wait_unlink(ls, w->front);
+                if (last) w = NULL;
+            }
+            for (int i = 0; i < count; i++) {
+                wait_enqueue(ls, isbn, (int)le_get32(p + hl + (size_t)i * 4));
+            }
+            break;
+        }
+        case J_HIST: {
+            if (len != JR_REC_HIST) return;
+            long long seq = (long long)le_get64(p);
+            /* já está no histórico carregado */
+            if (seq < ls->hist_base + hl_size(&ls->history)) return;
+            hist_push_at(ls, (ActionType)le_get32(p + 8), (int)le_get32(p + 12),
+                         (long long)le_get64(p + 16), (long long)le_get64(p + 24));
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+long ls_replay_journal(LoanSystem* ls, BookNode** books, UserNode** users,
+                       SlotMap* book_slots, SlotMap* user_slots, const char* path, long long* torn) {
+    ReplayCtx c;
+    c.ls = ls;
+    c.books = books;
+    c.users = users;
+    c.book_slots = book_slots;
+    c.user_slots = user_slots;
+
+    Journal* saved = ls->jr;
+    ls->jr = NULL;
+    long n = jr_replay(path, replay_one, &c, torn);
+    ls->jr = saved;
+    return n;
+}
+
+/* ---------- REMOÇÃO EM CASCATA ---------- */
+
+int ls_drop_user(LoanSystem* ls, int user_id) {
+    LoanHead* u = head_find(&ls->by_user, user_id);
+    if (!u) return 0;
+    if (u->count > 0) return -1;
+
+    /* o último wait_unlink também libera a cabeça 'u' */
+    int left = u->n_waits, dropped = 0;
+    long long* isbns = (long long*)xmalloc((size_t)left * sizeof(long long));
+    while (left-- > 0) {
+        isbns[dropped++] = u->waits->list->isbn;
+        wait_unlink(ls, u->waits);
+    }
+    for (int i = 0; i < dropped; i++) log_queue(ls, isbns[i]);
+    free(isbns);
+    return dropped;
+}
+
+int ls_drop_book(LoanSystem* ls, long long isbn) {
+    if (head_find(&ls->by_book, isbn)) return -1;
+
+    WaitList* w = waitlist_find(ls, isbn);
+    if (!w) return 0;
+
+    /* o último wait_unlink também libera a fila 'w' */
+    int left = w->count, dropped = 0;
+    while (left-- > 0) {
+        wait_unlink(ls, w->front);
+        dropped++;
     }
+    log_queue(ls, isbn);
+    return dropped;
 }
 
 /* ---------- API PRINCIPAL ---------- */
 
 void ls_init(LoanSystem* ls) {
     ls->loans = NULL;
+    ls->loan_size = LOAN_INITIAL;
+    ls->n_loans = 0;
+    ls->loan_table = (LoanNode**)xcalloc((size_t)ls->loan_size, sizeof(LoanNode*));
+    heads_init(&ls->by_user);
+    heads_init(&ls->by_book);
+    ls->wait_size = LOAN_INITIAL;
+    ls->n_waits = 0;
+    ls->wait_table = (WaitList**)xcalloc((size_t)ls->wait_size, sizeof(WaitList*));
+    ls->waiter_size = LOAN_INITIAL;
+    ls->n_waiters = 0;
+    ls->waiter_table = (WaitNode**)xcalloc((size_t)ls->waiter_size, sizeof(WaitNode*));
     ls->waits = NULL;
-    ls->history = NULL;
+    hl_init(&ls->history);
+    hi_init(&ls->hidx);
+    ls->rank = NULL;
+    ls->trend = NULL;
+    ls->sk = NULL;
+    ls->hb = NULL;
+    ls->hu = NULL;
+    ls->jr = NULL;
+    ls->hist_saved = 0;
+    ls->hist_tail = 0;
+    ls->hist_pending = 0;
+    ls->hist_pending_tail = 0;
+    ls->hist_legacy = 0;
+    ls->hist_lazy = NULL;
+    ls->hist_base = 0;
+    memset(&ls->hist_stats, 0, sizeof(ls->hist_stats));
+    cb_init(&ls->rec);
+    if (!cm_init(&ls->comm)) {
+        printf("Erro: sem memória.\n");
+        exit(1);
+    }
 }
 
 void ls_free(LoanSystem* ls) {
@@ -185,6 +781,11 @@ void ls_free(LoanSystem* ls) {
         free(ls->loans);
         ls->loans = next;
     }
+    free(ls->loan_table);
+    ls->loan_table = NULL;
+    ls->n_loans = 0;
+    heads_free(&ls->by_user);
+    heads_free(&ls->by_book);
 
     while (ls->waits) {
         WaitList* wn = ls->waits->next;
@@ -194,135 +795,362 @@ void ls_free(LoanSystem* ls) {
             free(ls->waits->front);
             ls->waits->front = nx;
         }
+        free(ls->waits->gaps);
         free(ls->waits);
         ls->waits = wn;
     }
+    free(ls->wait_table);
+    ls->wait_table = NULL;
+    ls->n_waits = 0;
+    free(ls->waiter_table);
+    ls->waiter_table = NULL;
+    ls->n_waiters = 0;
 
-    while (ls->history) {
-        HistNode* next = ls->history->next;
-        free(ls->history);
-        ls->history = next;
-    }
+    hl_free(&ls->history);
+    hi_free(&ls->hidx);
+
+    cm_free(&ls->comm);
+    cb_free(&ls->rec);
 }
-/* Realiza um empréstimo */
-void ls_borrow(LoanSystem* ls, UserNode* users, BookNode* books, int user_id, long long isbn) {
-    if (!users_find_by_id(users, user_id)) {
-        printf("Usuário não encontrado.\n");
-        return;
-    }
+/* Realiza um empréstimo (ou põe o usuário na fila, se não há exemplar) */
+BibStatus ls_borrow(LoanSystem* ls, int user_id, long long isbn, BibResult* res) {
+    BibResult tmp;
+    if (!res) res = &tmp;
+    memset(res, 0, sizeof(*res));
 
-    BookNode* bn = books_find_by_isbn(books, isbn);
-    if (!bn) {
-        printf("Livro não encontrado.\n");
-        return;
-    }
+    if (!hu_get(ls->hu, user_id)) return BIB_NO_USER;
 
-    if (loan_find(ls, user_id, isbn)) {
-        printf("Esse usuário já tem esse livro emprestado.\n");
-        return;
-    }
+    BookNode* bn = hb_get_node(ls->hb, isbn);
+    if (!bn) return BIB_NO_BOOK;
+
+    if (loan_find(ls, user_id, isbn)) return BIB_ALREADY_BORROWED;
 /*se tiver cópia, empresta*/
     if (bn->data.copies_available > 0) {
         bn->data.copies_available--;
         bn->data.times_borrowed++;
+        rank_update(ls->rank, isbn, bn->data.times_borrowed);
         loan_add(ls, user_id, isbn);
-        hist_push(ls, ACT_BORROW, user_id, isbn);
-
-        printf("Empréstimo realizado! user_id=%d | isbn=%I64d\n", user_id, (long long)isbn);
-        return;
+        books_touch(bn);
+        ls_log_book_put(ls, &bn->data);
+        log_loan(ls, J_LOAN_ADD, user_id, isbn);
+        hist_push(ls, ACT_BORROW, user_id, &bn->data);
+        return BIB_OK;
     }
 
-    wait_enqueue(ls, isbn, user_id);
-    hist_push(ls, ACT_ENQUEUE, user_id, isbn);
-    printf("Sem exemplares disponíveis. Usuário entrou na fila. (isbn=%I64d)\n", (long long)isbn);
-}
-/* Realiza uma devolução */
-void ls_return(LoanSystem* ls, UserNode* users, BookNode* books, int user_id, long long isbn) {
-    BookNode* bn = books_find_by_isbn(books, isbn);
-    if (!bn) {
-        printf("Livro não encontrado.\n");
-        return;
+    if (!wait_enqueue(ls, isbn, user_id)) {
+        res->position = ls_wait_position(ls, user_id, isbn, &res->total);
+        return BIB_ALREADY_QUEUED;
     }
+    log_queue(ls, isbn);
+    hist_push(ls, ACT_ENQUEUE, user_id, &bn->data);
+    res->position = ls_wait_position(ls, user_id, isbn, &res->total);
+    return BIB_QUEUED;
+}
+/* Realiza uma devolução; o livro vai direto para o primeiro da fila */
+BibStatus ls_return(LoanSystem* ls, int user_id, long long isbn, BibResult* res) {
+    BibResult tmp;
+    if (!res) res = &tmp;
+    memset(res, 0, sizeof(*res));
 
-    if (!loan_remove(ls, user_id, isbn)) {
-        printf("Empréstimo ativo não encontrado para esse usuário e ISBN.\n");
-        return;
-    }
+    BookNode* bn = hb_get_node(ls->hb, isbn);
+    if (!bn) return BIB_NO_BOOK;
 
-    bn->data.copies_available++;
-    hist_push(ls, ACT_RETURN, user_id, isbn);
+    if (!loan_remove(ls, user_id, isbn)) return BIB_NO_LOAN;
 
-    printf("Devolução realizada! user_id=%d | isbn=%I64d\n", user_id, (long long)isbn);
+    bn->data.copies_available++;
+    books_touch(bn);
+    ls_log_book_put(ls, &bn->data);
+    log_loan(ls, J_LOAN_DEL, user_id, isbn);
+    hist_push(ls, ACT_RETURN, user_id, &bn->data);
 
     /* se tiver fila, empresta automaticamente */
     int next_user = 0;
     if (bn->data.copies_available > 0 && wait_dequeue(ls, isbn, &next_user)) {
-        if (users_find_by_id(users, next_user)) {
+        log_queue(ls, isbn);
+        res->next_user = next_user;
+        if (hu_get(ls->hu, next_user)) {
             bn->data.copies_available--;
             bn->data.times_borrowed++;
+            rank_update(ls->rank, isbn, bn->data.times_borrowed);
             loan_add(ls, next_user, isbn);
-            hist_push(ls, ACT_AUTO_BORROW, next_user, isbn);
-
-            printf("Auto-empréstimo para o próximo da fila: user_id=%d | isbn=%I64d\n",
-                   next_user, (long long)isbn);
+            books_touch(bn);
+            ls_log_book_put(ls, &bn->data);
+            log_loan(ls, J_LOAN_ADD, next_user, isbn);
+            hist_push(ls, ACT_AUTO_BORROW, next_user, &bn->data);
+            res->next_state = 1;
         } else {
-            printf("Aviso: próximo da fila (user_id=%d) não existe mais. Ignorado.\n", next_user);
+            res->next_state = -1;
         }
     }
+    return BIB_OK;
 }
 
-/* ---------- PERSISTÊNCIA ---------- */
+/* ---------- COMUNIDADES (DSU) ---------- */
+
+/* Vetor de pares a unir (carga em lote) */
+typedef struct {
+    int* a;
+    int* b;
+    long n;
+    long cap;
+} PairVec;
+
+static void pairs_push(PairVec* v, int a, int b) {
+    if (v->n == v->cap) {
+        long newcap = (v->cap == 0) ? 1024 : v->cap * 2;
+        int* na = (int*)realloc(v->a, sizeof(int) * (size_t)newcap);
+        if (!na) { printf("Erro: sem memória.\n"); exit(1); }
+        v->a = na;
+        int* nb = (int*)realloc(v->b, sizeof(int) * (size_t)newcap);
+        if (!nb) { printf("Erro: sem memória.\n"); exit(1); }
+        v->b = nb;
+        v->cap = newcap;
+    }
+    v->a[v->n] = a;
+    v->b[v->n] = b;
+    v->n++;
+}
+
+/* Refaz as comunidades a partir do histórico: os índices e os pares são
+   gerados numa passada; com muitos pares a união roda em paralelo
+   (Union-Find com CAS) e o resultado vira o DSU sequencial. */
+static void comm_rebuild(LoanSystem* ls, UserNode* users, int nthreads) {
+    ls_history_ready(ls);
+    cm_clear(&ls->comm);
+
+    int n = 0;
+    User** arr = users_build_sorted_array(users, &n);
 
-void ls_save(LoanSystem* ls) {
-  /* salvar empréstimos */
-    FILE* f = fopen(LOANS_FILE, "wb");
-    if (!f) {
-        printf("Erro ao abrir %s para escrita.\n", LOANS_FILE);
+    PairVec pv = {0};
+    HistIter it;
+    HistEvent e;
+    hl_iter_backward(&it, &ls->history);
+    while (hl_next(&it, &e)) {
+        if (e.type != ACT_BORROW && e.type != ACT_AUTO_BORROW) continue;
+        /* usuários removidos não participam */
+        if (!arr || !users_binary_search(arr, n, e.user_id)) continue;
+        int a, b;
+        if (cm_pair(&ls->comm, e.user_id, e.isbn, &a, &b)) pairs_push(&pv, a, b);
+    }
+    free(arr);
+
+    CDSU c;
+    DSU d;
+    if (pv.n >= COMM_PARALLEL_MIN && nthreads > 1 &&
+        cdsu_init(&c, ls->comm.dsu.n)) {
+        cdsu_union_pairs(&c, pv.a, pv.b, pv.n, nthreads);
+        if (cdsu_to_dsu(&c, &d)) cm_set_dsu(&ls->comm, &d);
+        else for (long i = 0; i < pv.n; i++) dsu_union(&ls->comm.dsu, pv.a[i], pv.b[i]);
+        cdsu_free(&c);
     } else {
-        for (LoanNode* cur = ls->loans; cur; cur = cur->next) {
-            fwrite(&cur->user_id, sizeof(int), 1, f);
-            fwrite(&cur->isbn, sizeof(long long), 1, f);
+        for (long i = 0; i < pv.n; i++) dsu_union(&ls->comm.dsu, pv.a[i], pv.b[i]);
+    }
+
+    free(pv.a);
+    free(pv.b);
+    ls->comm.valid = 1;
+}
+
+/* Reconstrói as comunidades a partir do histórico, só na primeira consulta
+   (ou depois de remover usuário). Daí em diante cada empréstimo atualiza. */
+static void comm_ensure(LoanSystem* ls, UserNode* users) {
+    if (ls->comm.valid) return;
+    comm_rebuild(ls, users, cdsu_default_threads());
+}
+
+/* usuário existe? (quem já emprestou está no mapa; os demais, na hash,
+   ou na lista sem o motor) */
+static int comm_user_exists(LoanSystem* ls, UserNode* users, int user_id) {
+    if (cm_index(&ls->comm, user_id) >= 0) return 1;
+    if (ls->hu) return hu_get(ls->hu, user_id) != NULL;
+    return users_find_by_id(users, user_id) != NULL;
+}
+
+int ls_comm_same(LoanSystem* ls, UserNode* users, int a, int b) {
+    comm_ensure(ls, users);
+    if (!comm_user_exists(ls, users, a) || !comm_user_exists(ls, users, b)) return -1;
+    return cm_same(&ls->comm, a, b);
+}
+
+int ls_comm_size(LoanSystem* ls, UserNode* users, int user_id) {
+    comm_ensure(ls, users);
+    if (!comm_user_exists(ls, users, user_id)) return -1;
+    return cm_size(&ls->comm, user_id);
+}
+
+void ls_comm_invalidate(LoanSystem* ls) {
+    ls->comm.valid = 0;
+}
+
+/* ---------- "QUEM PEGOU ESTE TAMBÉM PEGOU" ---------- */
+
+/* Pares (usuário, ISBN) de todos os empréstimos do histórico */
+static void rec_rebuild(LoanSystem* ls) {
+    ls_history_ready(ls);
+    HistIter it;
+    HistEvent e;
+
+    long n = 0;
+    hl_iter_forward(&it, &ls->history);
+    while (hl_next(&it, &e)) {
+        if (e.type == ACT_BORROW || e.type == ACT_AUTO_BORROW) n++;
+    }
+
+    BorrowPair* p = (BorrowPair*)xmalloc((size_t)(n ? n : 1) * sizeof(BorrowPair));
+    long i = 0;
+    hl_iter_forward(&it, &ls->history);
+    while (hl_next(&it, &e)) {
+        if (e.type != ACT_BORROW && e.type != ACT_AUTO_BORROW) continue;
+        p[i].user_id = e.user_id;
+        p[i].isbn = e.isbn;
+        i++;
+    }
+
+    cb_build(&ls->rec, p, n);
+    free(p);
+}
+
+int ls_related(LoanSystem* ls, long long isbn, RelatedBook* out, int k) {
+    if (cb_stale(&ls->rec)) rec_rebuild(ls);
+    return cb_related(&ls->rec, isbn, out, k);
+}
+
+int ls_comm_groups(LoanSystem* ls, UserNode* users, DSUGroups* out) {
+    comm_ensure(ls, users);
+    return dsu_groups(&ls->comm.dsu, out);
+}
+
+int* ls_comm_histogram(LoanSystem* ls, UserNode* users, int* out_max) {
+    comm_ensure(ls, users);
+
+    int max = 0;
+    int* hist = dsu_size_histogram(&ls->comm.dsu, &max);
+    if (!hist) return NULL;
+
+    /* usuários sem empréstimos não estão no DSU: cada um é uma comunidade */
+    int total = 0;
+    for (UserNode* u = users; u; u = u->next) total++;
+    int alone = total - ls->comm.dsu.n;
+    if (alone > 0) {
+        if (max < 1) {
+            int* tmp = (int*)realloc(hist, sizeof(int) * 2);
+            if (!tmp) {
+                free(hist);
+                return NULL;
+            }
+            hist = tmp;
+            hist[0] = 0;
+            hist[1] = 0;
+            max = 1;
         }
-        fclose(f);
+        hist[1] += alone;
     }
 
-   /* salvar filas */
-    f = fopen(WAITS_FILE, "wb");
-    if (!f) {
-        printf("Erro ao abrir %s para escrita.\n", WAITS_FILE);
-    } else {
-        for (WaitList* w = ls->waits; w; w = w->next) {
-            fwrite(&w->isbn, sizeof(long long), 1, f);
+    *out_max = max;
+    return hist;
+}
+
+/* ---------- PERSISTÊNCIA ---------- */
+
+/* Registro do historico.dat */
+typedef struct {
+    int type;
+    int user_id;
+    long long isbn;
+    long long ts;
+} HistRec;
+
+#define HIST_IO_BATCH 4096   /* registros por fread/fwrite */
 
-            int count = 0;
-            for (WaitNode* n = w->front; n; n = n->next) count++;
-            fwrite(&count, sizeof(int), 1, f);
+/* Formatos antigos (do topo da pilha para a base): lê tudo num vetor para
+   poder inverter. 'first' é o primeiro int do arquivo, já lido. */
+static HistRec* hist_read_old(FILE* f, int first, size_t* out_n) {
+    HistRec* arr = NULL;
+    size_t used = 0, cap = 0;
 
-            for (WaitNode* n = w->front; n; n = n->next) {
-                fwrite(&n->user_id, sizeof(int), 1, f);
+    int has_ts = (first == HISTORY_MAGIC);
+    int pending = !has_ts;
+
+    while (1) {
+        HistRec r;
+        if (pending) {
+            r.type = first;
+            pending = 0;
+        } else if (fread(&r.type, sizeof(int), 1, f) != 1) {
+            break;
+        }
+        if (fread(&r.user_id, sizeof(int), 1, f) != 1) break;
+        if (fread(&r.isbn, sizeof(long long), 1, f) != 1) break;
+        r.ts = 0;
+        if (has_ts && fread(&r.ts, sizeof(long long), 1, f) != 1) break;
+
+        if (used == cap) {
+            size_t newcap = (cap == 0) ? 16 : cap * 2;
+            HistRec* tmp = (HistRec*)realloc(arr, newcap * sizeof(HistRec));
+            if (!tmp) {
+                free(arr);
+                arr = NULL;
+                used = cap = 0;
+                printf("Aviso: sem memória ao carregar histórico.\n");
+                break;
             }
+            arr = tmp;
+            cap = newcap;
         }
+        arr[used++] = r;
+    }
+
+    *out_n = used;
+    return arr;
+}
+
+/* Acrescenta ao histórico os eventos de um historico.dat (qualquer formato),
+   no máximo 'limit' (-1 = todos). Retorna quantos entraram, ou -1 se o
+   arquivo não abriu. */
+static long hist_load_file(LoanSystem* ls, const char* path, long limit) {
+    FILE* f = fopen(path, "rb");
+    if (!f) return -1;
+
+    int first = 0;
+    if (fread(&first, sizeof(int), 1, f) != 1) {
         fclose(f);
+        return 0;
     }
 
-    /* salvar histórico */
-    f = fopen(HISTORY_FILE, "wb");
-    if (!f) {
-        printf("Erro ao abrir %s para escrita.\n", HISTORY_FILE);
+    long total = 0;
+    if (first == HISTORY_MAGIC3) {
+        /* já está em ordem: vai direto para o log, em lotes */
+        HistRec* buf = (HistRec*)xmalloc(HIST_IO_BATCH * sizeof(HistRec));
+        size_t got;
+        while ((limit < 0 || total < limit) &&
+               (got = fread(buf, sizeof(HistRec), HIST_IO_BATCH, f)) > 0) {
+            if (limit >= 0 && (long)got > limit - total) got = (size_t)(limit - total);
+            for (size_t i = 0; i < got; i++) {
+                hist_push_at(ls, (ActionType)buf[i].type, buf[i].user_id, buf[i].isbn, buf[i].ts);
+            }
+            total += (long)got;
+        }
+        free(buf);
     } else {
-        for (HistNode* h = ls->history; h; h = h->next) {
-            int type = (int)h->type;
-            fwrite(&type, sizeof(int), 1, f);
-            fwrite(&h->user_id, sizeof(int), 1, f);
-            fwrite(&h->isbn, sizeof(long long), 1, f);
+        size_t used = 0;
+        HistRec* arr = hist_read_old(f, first, &used);
+        /* vetor do mais recente para o mais antigo: os 'limit' primeiros
+           eventos são os do fim */
+        size_t take = used;
+        if (limit >= 0 && take > (size_t)limit) take = (size_t)limit;
+        for (size_t i = used; i > used - take; i--) {
+            HistRec r = arr[i - 1];
+            hist_push_at(ls, (ActionType)r.type, r.user_id, r.isbn, r.ts);
         }
-        fclose(f);
+        free(arr);
+        total = (long)take;
     }
 
-    printf("Empréstimos (empréstimos/filas/histórico) salvos.\n");
+    fclose(f);
+    return total;
 }
 
-void ls_load(LoanSystem* ls) {
+void ls_load(LoanSystem* ls, long hist_limit) {
     /* carregar empréstimos */
     FILE* f = fopen(LOANS_FILE, "rb");
     if (f) {
@@ -354,47 +1182,338 @@ void ls_load(LoanSystem* ls) {
     }
 
        /* carregar histórico mantendo ordem */
-    f = fopen(HISTORY_FILE, "rb");
-    if (f) {
-        typedef struct {
-            int type;
-            int user_id;
-            long long isbn;
-        } HistRec;
-
-        HistRec* arr = NULL;
-        size_t used = 0, cap = 0;
-
-        while (1) {
-            HistRec r;
-            if (fread(&r.type, sizeof(int), 1, f) != 1) break;
-            if (fread(&r.user_id, sizeof(int), 1, f) != 1) break;
-            if (fread(&r.isbn, sizeof(long long), 1, f) != 1) break;
-
-            if (used == cap) {
-                size_t newcap = (cap == 0) ? 16 : cap * 2;
-                HistRec* tmp = (HistRec*)realloc(arr, newcap * sizeof(HistRec));
-                if (!tmp) {
-                    free(arr);
-                    arr = NULL;
-                    used = cap = 0;
-                    printf("Aviso: sem memória ao carregar histórico.\n");
-                    break;
-                }
-                arr = tmp;
-                cap = newcap;
+    hist_load_file(ls, HISTORY_FILE, hist_limit);
+    /* nada disso está no banco ainda: o primeiro checkpoint grava tudo */
+    ls->hist_saved = 0;
+    ls->hist_tail = 0;
+}
+
+/* ---------- CHECKPOINT ---------- */
+
+/* Buffer que cresce conforme a foto é serializada */
+typedef struct {
+    unsigned char* data;
+    size_t len, cap;
+} SnapBuf;
+
+static void snap_put(SnapBuf* b, const void* p, size_t n) {
+    if (b->len + n > b->cap) {
+        size_t cap = b->cap ? b->cap : 4096;
+        while (cap < b->len + n) cap *= 2;
+        unsigned char* tmp = (unsigned char*)realloc(b->data, cap);
+        if (!tmp) {
+            printf("Erro: sem memória.\n");
+            exit(1);
+        }
+        b->data = tmp;
+        b->cap = cap;
+    }
+    memcpy(b->data + b->len, p, n);
+    b->len += n;
+}
+
+static void snap_put32(SnapBuf* b, unsigned int v) {
+    unsigned char p[4];
+    le_put32(p, v);
+    snap_put(b, p, sizeof(p));
+}
+
+static void snap_put64(SnapBuf* b, unsigned long long v) {
+    unsigned char p[8];
+    le_put64(p, v);
+    snap_put(b, p, sizeof(p));
+}
+
+/* Tabelas do banco em memória: a thread do checkpoint grava depois, sem
+   tocar nas estruturas */
+void ls_snapshot(LoanSystem* ls, Checkpoint* ck) {
+    SnapBuf b = {NULL, 0, 0};
+    for (LoanNode* cur = ls->loans; cur; cur = cur->next) {
+        snap_put32(&b, (unsigned int)cur->user_id);
+        snap_put64(&b, (unsigned long long)cur->isbn);
+    }
+    ck_add_table(ck, DB_LOANS, b.data, b.len);
+
+    /* filas: isbn, quantidade e os ids, em sequência */
+    SnapBuf q = {NULL, 0, 0};
+    for (WaitList* w = ls->waits; w; w = w->next) {
+        snap_put64(&q, (unsigned long long)w->isbn);
+        snap_put32(&q, (unsigned int)w->count);
+        for (WaitNode* n = w->front; n; n = n->next) {
+            snap_put32(&q, (unsigned int)n->user_id);
+        }
+    }
+    ck_add_table(ck, DB_QUEUES, q.data, q.len);
+
+    /* histórico: do bloco incompleto em diante (os completos não mudam) */
+    long to = ls->hist_base + hl_size(&ls->history);
+    ls->hist_pending = ls->hist_saved;
+    ls->hist_pending_tail = ls->hist_tail;
+    if (to > ls->hist_saved) {
+        long start = ls->hist_saved - ls->hist_saved % HIST_BLOCK_EVENTS;
+        unsigned long long off = ls->hist_tail;
+        SnapBuf blocks = {NULL, 0, 0}, index = {NULL, 0, 0};
+        unsigned char* tmp = (unsigned char*)xmalloc(HIST_BLOCK_MAX);
+        for (long i = start; i < to; i += HIST_BLOCK_EVENTS) {
+            int n = to - i < HIST_BLOCK_EVENTS ? (int)(to - i) : HIST_BLOCK_EVENTS;
+            /* o log começa em hist_base; o bloco incompleto está nele */
+            size_t len = hl_encode_block(&ls->history, i - ls->hist_base, n, tmp);
+            HistEvent first;
+            hl_get(&ls->history, i - ls->hist_base, &first);
+            snap_put64(&index, off);
+            snap_put32(&index, (unsigned int)len);
+            snap_put32(&index, (unsigned int)first.ts);
+            snap_put(&blocks, tmp, len);
+            /* o próximo checkpoint recomeça no bloco que ainda tem vaga */
+            ls->hist_pending_tail = n == HIST_BLOCK_EVENTS ? off + len : off;
+            off += len;
+        }
+        free(tmp);
+        ls->hist_pending = to;
+        ck_add_tail(ck, DB_HIST_BLOCKS, (long long)ls->hist_tail, blocks.data, blocks.len);
+        ck_add_tail(ck, DB_HIST_INDEX, (long long)(start / HIST_BLOCK_EVENTS) * DB_REC_HIST_IDX,
+                    index.data, index.len);
+    }
+    if (ls->hist_legacy) ck_add_tail(ck, DB_HISTORY, 0, NULL, 0);
+}
+
+void ls_checkpoint_done(LoanSystem* ls, const Checkpoint* ck) {
+    if (!ck->ok) return;
+    ls->hist_saved = ls->hist_pending;
+    ls->hist_tail = ls->hist_pending_tail;
+    ls->hist_legacy = 0;
+}
+
+/* Índice do histórico (DB_REC_HIST_IDX bytes por bloco), conferindo que
+   os blocos estão em sequência. Retorna o buffer (quem chama libera) e em
+   *end o fim do último bloco; NULL se estiver estragado. */
+static unsigned char* hist_read_index(Db* db, long* n_blocks, unsigned long long* end) {
+    long n = db_table_records(db, DB_HIST_INDEX);
+    size_t len = (size_t)n * DB_REC_HIST_IDX;
+    unsigned char* idx = (unsigned char*)xmalloc(len ? len : 1);
+    DbReader r;
+    db_reader_open(db, DB_HIST_INDEX, &r);
+    if (db_read(&r, idx, len) != len) {
+        free(idx);
+        return NULL;
+    }
+
+    unsigned long long off = 0;
+    for (long b = 0; b < n; b++) {
+        const unsigned char* e = idx + b * DB_REC_HIST_IDX;
+        if (le_get64(e) != off || le_get32(e + 8) > HIST_BLOCK_MAX) {
+            free(idx);
+            return NULL;
+        }
+        off += le_get32(e + 8);
+    }
+    *n_blocks = n;
+    *end = off;
+    return idx;
+}
+
+/* Lê e decodifica o bloco b (o leitor já está na posição dele). Retorna
+   quantos eventos ou -1; soma o tempo de decodificação em *secs. */
+static int hist_read_block(DbReader* r, const unsigned char* idx, long b,
+                           unsigned char* blk, HistEvent* ev, double* secs) {
+    size_t len = le_get32(idx + b * DB_REC_HIST_IDX + 8);
+    if (db_read(r, blk, len) != len) return -1;
+
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    int k = hl_decode_block(blk, len, ev);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    *secs += (double)(t1.tv_sec - t0.tv_sec) + (double)(t1.tv_nsec - t0.tv_nsec) / 1e9;
+    return k;
+}
+
+/* Carga preguiçosa: só o índice e o último bloco (que ainda tem vaga e é
+   regravado no próximo checkpoint). Os blocos completos ficam no banco
+   até alguém consultar o histórico (ls_history_ready). */
+static void hist_open_blocks(LoanSystem* ls, Db* db) {
+    long n_blocks;
+    unsigned long long end;
+    unsigned char* idx = hist_read_index(db, &n_blocks, &end);
+    if (!idx) {
+        ls->hist_stats.bad_index = 1;
+        return;
+    }
+    if (n_blocks == 0) {
+        free(idx);
+        return;
+    }
+
+    unsigned char* blk = (unsigned char*)xmalloc(HIST_BLOCK_MAX);
+    HistEvent* ev = (HistEvent*)xmalloc(HIST_BLOCK_EVENTS * sizeof(HistEvent));
+    const unsigned char* last = idx + (n_blocks - 1) * DB_REC_HIST_IDX;
+    DbReader r;
+    double secs = 0;
+    db_reader_open(db, DB_HIST_BLOCKS, &r);
+    db_reader_seek(&r, le_get64(last));
+    int k = hist_read_block(&r, idx, n_blocks - 1, blk, ev, &secs);
+
+    /* só o último bloco pode ter vaga; os anteriores têm HIST_BLOCK_EVENTS */
+    if (k == HIST_BLOCK_EVENTS) {
+        ls->hist_base = n_blocks * HIST_BLOCK_EVENTS;
+        ls->hist_tail = end;
+        k = 0;
+    } else {
+        ls->hist_base = (n_blocks - 1) * HIST_BLOCK_EVENTS;
+        ls->hist_tail = le_get64(last);
+        if (k < 0) {
+            ls->hist_stats.bad_tail = 1;
+            k = 0;
+        }
+    }
+    ls->hist_lazy = ls->hist_base > 0 ? db->path : NULL;
+    for (int i = 0; i < k; i++) {
+        hist_push_at(ls, (ActionType)ev[i].type, ev[i].user_id, ev[i].isbn, ev[i].ts);
+    }
+    ls->hist_saved = ls->hist_base + hl_size(&ls->history);
+
+    ls->hist_stats.events = ls->hist_saved;
+    ls->hist_stats.bytes = end;
+    ls->hist_stats.lazy = ls->hist_lazy != NULL;
+
+    free(idx);
+    free(blk);
+    free(ev);
+}
+
+void ls_history_ready(LoanSystem* ls) {
+    if (!ls->hist_lazy) return;
+    const char* path = ls->hist_lazy;
+    ls->hist_lazy = NULL;
+
+    /* Um identificador só para esta leitura: o checkpoint pode estar
+       gravando no banco principal. Ele só escreve em páginas livres e os
+       blocos completos nunca mudam, então qualquer geração serve. */
+    long want = ls->hist_base;
+    long n_blocks = 0;
+    unsigned long long end = 0;
+    unsigned char* idx = NULL;
+    Db db;
+    int ok = db_open(&db, path) == 1;
+    if (ok) {
+        idx = hist_read_index(&db, &n_blocks, &end);
+        ok = idx && n_blocks * HIST_BLOCK_EVENTS >= want;
+    }
+
+    HistLog old;
+    hl_init(&old);
+    double secs = 0;
+    unsigned long long bytes = 0;
+    if (ok) {
+        unsigned char* blk = (unsigned char*)xmalloc(HIST_BLOCK_MAX);
+        HistEvent* ev = (HistEvent*)xmalloc(HIST_BLOCK_EVENTS * sizeof(HistEvent));
+        DbReader r;
+        db_reader_open(&db, DB_HIST_BLOCKS, &r);
+        for (long b = 0; ok && b < want / HIST_BLOCK_EVENTS; b++) {
+            ok = hist_read_block(&r, idx, b, blk, ev, &secs) == HIST_BLOCK_EVENTS;
+            for (int i = 0; ok && i < HIST_BLOCK_EVENTS; i++) {
+                hl_append(&old, ev[i].type, ev[i].user_id, ev[i].isbn, ev[i].ts);
             }
-            arr[used++] = r;
+            bytes += le_get32(idx + b * DB_REC_HIST_IDX + 8);
         }
-        fclose(f);
+        free(blk);
+        free(ev);
+    }
+    free(idx);
+    if (db.f) db_close(&db);
 
-        
-        for (size_t i = used; i > 0; i--) {
-            HistRec r = arr[i - 1];
-            hist_push(ls, (ActionType)r.type, r.user_id, r.isbn);
+    if (ok) {
+        /* os eventos antigos entram no motor de tendências (ele aceita fora
+           de ordem) e os desta sessão vão para o fim do log */
+        HistIter it;
+        HistEvent e;
+        hl_iter_forward(&it, &old);
+        while (hl_next(&it, &e)) {
+            if (e.type == ACT_BORROW || e.type == ACT_AUTO_BORROW) trend_add(ls->trend, e.isbn, e.ts);
         }
-        free(arr);
+        hl_iter_forward(&it, &ls->history);
+        while (hl_next(&it, &e)) hl_append(&old, e.type, e.user_id, e.isbn, e.ts);
+        hl_free(&ls->history);
+        ls->history = old;
+        ls->hist_base = 0;
+
+        ls->hist_stats.events = want;
+        ls->hist_stats.bytes = bytes;
+        ls->hist_stats.decode_secs = secs;
+    } else {
+        /* as posições continuam contando a partir de hist_base */
+        hl_free(&old);
+        ls->hist_stats.read_failed = 1;
+    }
+    ls->hist_stats.lazy = 0;
+    ls->hist_stats.news = 1;
+
+    /* índices por usuário, livro e instante, agora com tudo */
+    hi_free(&ls->hidx);
+    hi_init(&ls->hidx);
+    for (long i = 0; i < hl_size(&ls->history); i++) hi_add(&ls->hidx, &ls->history, i);
+}
+
+void ls_load_db(LoanSystem* ls, Db* db) {
+    unsigned char buf[DB_REC_HIST * 256];
+    DbReader r;
+    size_t got;
+
+    /* empréstimos */
+    db_reader_open(db, DB_LOANS, &r);
+    while ((got = db_read(&r, buf, DB_REC_LOAN * 256)) >= DB_REC_LOAN) {
+        for (size_t off = 0; off + DB_REC_LOAN <= got; off += DB_REC_LOAN) {
+            loan_add(ls, (int)le_get32(buf + off), (long long)le_get64(buf + off + 4));
+        }
+    }
+
+    /* filas */
+    db_reader_open(db, DB_QUEUES, &r);
+    unsigned char hdr[12];
+    while (db_read(&r, hdr, sizeof(hdr)) == sizeof(hdr)) {
+        long long isbn = (long long)le_get64(hdr);
+        int count = (int)le_get32(hdr + 8);
+        for (int i = 0; i < count; i++) {
+            unsigned char id[4];
+            if (db_read(&r, id, sizeof(id)) != sizeof(id)) break;
+            wait_enqueue(ls, isbn, (int)le_get32(id));
+        }
+    }
+
+    /* histórico: blocos compactos (preguiçoso) ou, num banco antigo,
+       registros fixos */
+    if (db_table_size(db, DB_HIST_INDEX) > 0) {
+        hist_open_blocks(ls, db);
+    } else if (db_table_size(db, DB_HISTORY) > 0) {
+        db_reader_open(db, DB_HISTORY, &r);
+        while ((got = db_read(&r, buf, sizeof(buf))) >= DB_REC_HIST) {
+            for (size_t off = 0; off + DB_REC_HIST <= got; off += DB_REC_HIST) {
+                const unsigned char* p = buf + off;
+                hist_push_at(ls, (ActionType)(int)le_get32(p), (int)le_get32(p + 4),
+                             (long long)le_get64(p + 8), (long long)le_get64(p + 16));
+            }
+        }
+        /* o próximo checkpoint grava tudo em blocos e apaga a tabela antiga */
+        ls->hist_saved = 0;
+        ls->hist_tail = 0;
+        ls->hist_legacy = 1;
+    }
+}
+
+/* Junta o historico.dat de outra filial ao histórico e refaz as comunidades
+   com a união em paralelo. Retorna quantos eventos entraram (-1 = erro). */
+long ls_import_history(LoanSystem* ls, UserNode* users, const char* path, int nthreads) {
+    /* comunidades inválidas: os eventos não são ligados um a um */
+    /* os eventos importados vão depois dos que estão no banco */
+    ls_history_ready(ls);
+    int was_valid = ls->comm.valid;
+    ls->comm.valid = 0;
+
+    long n = hist_load_file(ls, path, -1);
+    if (n < 0) {
+        ls->comm.valid = was_valid;
+        return -1;
     }
 
-    printf("Empréstimos (empréstimos/filas/histórico) carregados.\n");
+    comm_rebuild(ls, users, nthreads);
+    return n;
 }
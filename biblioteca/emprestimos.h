@@ -3,6 +3,17 @@
 
 #include "livros.h"
 #include "usuarios.h"
+#include "hash_livros.h"
+#include "hash_usuarios.h"
+#include "top_livros.h"
+#include "tendencias.h"
+#include "sketch.h"
+#include "comunidades.h"
+#include "recomendacao.h"
+#include "historico.h"
+#include "diario.h"
+#include "checkpoint.h"
+#include "resultado.h"
 
 /* Ação para histórico (PILHA) */
 typedef enum {
@@ -12,57 +23,213 @@ typedef enum {
     ACT_AUTO_BORROW = 4  // empréstimo automático (quando alguém devolve e chama o próximo da fila)
 } ActionType;
 
-/* Nó de empréstimo ativo (LISTA) */
+/* Nó de empréstimo ativo: fica ao mesmo tempo na lista geral, na hash
+   (user_id, isbn) e nas listas do usuário e do livro (todas duplamente
+   encadeadas, para remover em O(1)) */
 typedef struct LoanNode {
     int user_id;
     long long isbn;
-    struct LoanNode* next;
+    struct LoanNode* next;     // lista geral de empréstimos ativos
+    struct LoanNode* prev;
+    struct LoanNode* hnext;    // colisões na hash (user_id, isbn)
+    struct LoanNode* u_next;   // outros empréstimos do mesmo usuário
+    struct LoanNode* u_prev;
+    struct LoanNode* b_next;   // outros leitores com o mesmo ISBN
+    struct LoanNode* b_prev;
 } LoanNode;
 
-/* Nó da fila de espera (FILA) */
+/* Cabeça das listas por usuário (key = user_id) ou por livro (key = isbn).
+   Por usuário guarda também os lugares dele nas filas de espera, assim a
+   remoção em cascata só mexe no que é do próprio usuário.
+   Só existe enquanto houver empréstimo ativo (ou lugar em fila). */
+typedef struct LoanHead {
+    long long key;
+    LoanNode* first;
+    int count;
+    struct WaitNode* waits;    // só por usuário: filas em que ele está
+    int n_waits;
+    struct LoanHead* next;
+} LoanHead;
+
+/* Hash de cabeças (cresce dobrando) */
+typedef struct {
+    LoanHead** table;
+    int size;
+    int n;
+} LoanHeadMap;
+
+/* Nó da fila de espera (FILA).
+   Cada um recebe uma senha crescente dentro da sua fila: a posição sai da
+   diferença para a senha de quem está na frente, descontadas as senhas de
+   quem saiu do meio da fila, sem percorrer a fila. */
 typedef struct WaitNode {
     int user_id;
+    long ticket;
+    struct WaitList* list;     // fila a que pertence
     struct WaitNode* next;
+    struct WaitNode* prev;
+    struct WaitNode* hnext;    // colisões na hash (user_id, isbn)
+    struct WaitNode* u_next;   // outras filas do mesmo usuário
+    struct WaitNode* u_prev;
 } WaitNode;
 
-/* Uma fila por ISBN (mapeamento via lista) */
+/* Uma fila por ISBN (hash por ISBN; a fila é liberada quando esvazia) */
 typedef struct WaitList {
     long long isbn;
     WaitNode* front;
     WaitNode* rear;
-    struct WaitList* next;
+    int count;
+    long next_ticket;          // senha do próximo que entrar
+    long* gaps;                // senhas (ordenadas) de quem saiu do meio da fila
+    int gaps_head;             // gaps[0..gaps_head-1] já ficaram para trás da frente
+    int n_gaps;
+    int gaps_cap;
+    struct WaitList* next;     // lista de todas as filas (para listar/salvar)
+    struct WaitList* prev;
+    struct WaitList* hnext;    // colisões na hash por ISBN
 } WaitList;
 
-/* Histórico (PILHA) */
-typedef struct HistNode {
-    ActionType type;
-    int user_id;
-    long long isbn;
-    struct HistNode* next;
-} HistNode;
+/* Leitura do histórico do banco, para quem chama mostrar */
+typedef struct {
+    long events;                /* eventos nos blocos do banco */
+    unsigned long long bytes;   /* tamanho deles, comprimidos */
+    double decode_secs;         /* tempo decodificando (ls_history_ready) */
+    int lazy;                   /* ficaram no banco até a primeira consulta */
+    int bad_index;              /* índice estragado: histórico do banco ignorado */
+    int bad_tail;               /* último bloco estragado (ignorado) */
+    int read_failed;            /* ls_history_ready não conseguiu ler os blocos */
+    int news;                   /* ls_history_ready terminou e ninguém mostrou */
+} HistStats;
 
 /* Sistema de empréstimos */
 typedef struct {
     LoanNode* loans;     // lista de empréstimos ativos
+    LoanNode** loan_table; // hash (user_id, isbn) -> empréstimo
+    int loan_size;
+    long n_loans;
+    LoanHeadMap by_user; // empréstimos de cada usuário
+    LoanHeadMap by_book; // quem está com cada ISBN
     WaitList* waits;     // várias filas, uma por ISBN
-    HistNode* history;   // pilha de histórico
+    WaitList** wait_table; // hash ISBN -> fila
+    int wait_size;
+    int n_waits;
+    WaitNode** waiter_table; // hash (user_id, isbn) -> lugar na fila
+    int waiter_size;
+    long n_waiters;
+    HistLog history;     // histórico: log só de acréscimo, em colunas (mais antigo primeiro)
+    HistIndex hidx;      // índices do histórico por usuário, por ISBN e por instante
+    TopRank* rank;       // ranking de popularidade atualizado a cada empréstimo (opcional)
+    Trending* trend;     // livros em alta (janelas de 7/30 dias), alimentado pelo histórico (opcional)
+    SketchSet* sk;       // esboços de popularidade/leitores distintos, alimentados pelos eventos que entram no histórico (opcional)
+    HashBooks* hb;       // livros por ISBN (ligado pelo motor; ls_borrow/ls_return precisam dele)
+    HashUsers* hu;       // usuários por ID (idem)
+    Communities comm;    // comunidades de leitores (DSU), reconstruídas sob demanda e mantidas a cada empréstimo
+    CoBorrow rec;        // "quem pegou este também pegou", recalculado em lote quando bastante empréstimo novo entrou
+    Journal* jr;         // diário das alterações (opcional; NULL durante a carga e o replay)
+    long hist_saved;     // eventos do histórico já gravados no banco (o checkpoint só regrava o último bloco em diante)
+    unsigned long long hist_tail;  // posição no banco do bloco onde cai o evento hist_saved
+    long hist_pending;   // hist_saved e hist_tail depois do checkpoint em andamento
+    unsigned long long hist_pending_tail;
+    int hist_legacy;     // histórico lido da tabela antiga (registros fixos): apagá-la no próximo checkpoint
+    const char* hist_lazy; // banco com blocos do histórico ainda não lidos (NULL = tudo em memória)
+    long hist_base;      // eventos do banco que não estão no log (o evento i do log é o hist_base + i)
+    HistStats hist_stats; // como o histórico do banco foi lido (o motor não escreve na tela)
 } LoanSystem;
 
 /* Lifecycle */
 void ls_init(LoanSystem* ls);
 void ls_free(LoanSystem* ls);
 
-/* Operações */
-void ls_borrow(LoanSystem* ls, UserNode* users, BookNode* books, int user_id, long long isbn);
-void ls_return(LoanSystem* ls, UserNode* users, BookNode* books, int user_id, long long isbn);
+/* Operações (res é opcional: posição na fila, próximo da fila na devolução).
+   Usuário e livro vêm de ls->hu e ls->hb, em O(1).
+   BIB_OK, BIB_QUEUED, BIB_ALREADY_QUEUED, BIB_ALREADY_BORROWED, BIB_NO_USER,
+   BIB_NO_BOOK ou BIB_NO_LOAN. */
+BibStatus ls_borrow(LoanSystem* ls, int user_id, long long isbn, BibResult* res);
+BibStatus ls_return(LoanSystem* ls, int user_id, long long isbn, BibResult* res);
+
+/* Relatórios: percorrer ls->loans (next) e ls->waits (next; front/next em
+   cada fila); o histórico com hl_iter_backward/hl_next depois de
+   ls_history_ready */
+const char* ls_action_name(int type);   /* "EMPRÉSTIMO", "DEVOLUÇÃO", ... */
+
+/* Consultas sem varrer todos os empréstimos: percorrer com u_next / b_next.
+   count (opcional) recebe quantos são. */
+const LoanNode* ls_loans_of_user(LoanSystem* ls, int user_id, int* count);
+const LoanNode* ls_holders_of_book(LoanSystem* ls, long long isbn, int* count);
+int  ls_has_loan(LoanSystem* ls, int user_id, long long isbn);
+
+/* Posição (1 = próximo) do usuário na fila do ISBN; 0 se não está na fila.
+   total (opcional) recebe o tamanho da fila. */
+int  ls_wait_position(LoanSystem* ls, int user_id, long long isbn, int* total);
+
+/* Remoção em cascata, em tempo proporcional ao que é do próprio registro.
+   Recusa (-1) se ainda houver empréstimo ativo; senão tira o usuário de
+   todas as filas (ou apaga a fila do livro) e retorna quantos lugares saíram.
+   O histórico é registro do passado e não é alterado. */
+int  ls_drop_user(LoanSystem* ls, int user_id);
+int  ls_drop_book(LoanSystem* ls, long long isbn);
+
+/* Comunidades (DSU): -1 se algum usuário não existe */
+int  ls_comm_same(LoanSystem* ls, UserNode* users, int a, int b);
+int  ls_comm_size(LoanSystem* ls, UserNode* users, int user_id);
+void ls_comm_invalidate(LoanSystem* ls); /* chamar ao remover usuário */
+
+/* Partição inteira: grupos do maior para o menor; membros são índices,
+   convertidos em user_id por ls->comm.user_of. Só inclui quem já emprestou. */
+int  ls_comm_groups(LoanSystem* ls, UserNode* users, DSUGroups* out);
+
+/* hist[s] = quantas comunidades têm s usuários (quem nunca emprestou conta
+   como comunidade de 1); liberar com free */
+int* ls_comm_histogram(LoanSystem* ls, UserNode* users, int* out_max);
+
+/* Livros que os leitores deste ISBN também pegaram (até k <= REC_TOPN).
+   Recalcula tudo em lote quando entraram empréstimos bastantes desde o
+   último (cb_stale); devoluções e filas não contam. */
+int  ls_related(LoanSystem* ls, long long isbn, RelatedBook* out, int k);
+
+/* Consultas ao histórico pelos índices, com instante em [from, to]
+   (from = 0 e to = LLONG_MAX para tudo). Retorna quantos eventos e aponta
+   *out para as posições no log (ler com hl_get), em ordem de tempo. */
+long ls_history_of_user(LoanSystem* ls, int user_id, long long from, long long to, const HistPos** out);
+long ls_history_of_book(LoanSystem* ls, long long isbn, long long from, long long to, const HistPos** out);
+long ls_history_between(LoanSystem* ls, long long from, long long to, const HistPos** out);
+
+/* Diário: alterações de livros/usuários feitas fora deste módulo */
+void ls_log_book_put(LoanSystem* ls, const Book* b);
+void ls_log_book_del(LoanSystem* ls, long long isbn);
+void ls_log_user_put(LoanSystem* ls, const User* u);
+void ls_log_user_del(LoanSystem* ls, int user_id);
+
+/* Reaplica o diário sobre o que foi carregado (ls->jr deve estar NULL);
+   livros e usuários apagados liberam o slot nos mapas. Retorna quantos
+   registros aplicou (-1 = arquivo não existe); soma em *torn os bytes
+   incompletos descartados no fim (pode ser NULL). */
+long ls_replay_journal(LoanSystem* ls, BookNode** books, UserNode** users,
+                       SlotMap* book_slots, SlotMap* user_slots, const char* path, long long* torn);
+
+/* Carga dos .dat soltos (formato anterior ao biblioteca.db, para migrar).
+   Lê no máximo 'hist_limit' eventos do histórico (-1 = todos): o que
+   passou disso não foi confirmado por um checkpoint e volta pelo diário. */
+void ls_load(LoanSystem* ls, long hist_limit);
+
+/* Lê empréstimos e filas do biblioteca.db. Do histórico só o índice e o
+   último bloco: o resto é lido na primeira consulta (ls_history_ready). */
+void ls_load_db(LoanSystem* ls, Db* db);
+
+/* Traz para o log os blocos do histórico que ficaram no banco, decodificados
+   um a um, e refaz os índices. As consultas de histórico, comunidades e
+   recomendações já chamam; quem percorre ls->history direto também deve.
+   O resultado fica em ls->hist_stats (news = 1). */
+void ls_history_ready(LoanSystem* ls);
 
-/* Relatórios */
-void ls_print_loans(LoanSystem* ls);
-void ls_print_history(LoanSystem* ls);
-void ls_print_waits(LoanSystem* ls);
+/* Foto do estado para um checkpoint: empréstimos, filas e os blocos do
+   histórico a partir do último incompleto. Depois do checkpoint, chamar
+   ls_checkpoint_done. */
+void ls_snapshot(LoanSystem* ls, Checkpoint* ck);
+void ls_checkpoint_done(LoanSystem* ls, const Checkpoint* ck);
 
-/* Persistência */
-void ls_save(LoanSystem* ls);
-void ls_load(LoanSystem* ls);
+/* Junta o historico.dat de outra filial; as comunidades são refeitas com
+   'nthreads' threads. Retorna quantos eventos entraram (-1 = erro) */
+long ls_import_history(LoanSystem* ls, UserNode* users, const char* path, int nthreads);
 
 #endif
@@ -21,6 +21,7 @@ static int bucket_index(HashBooks* hb, long long isbn) {
 
 int hb_init(HashBooks* hb, int size) {
     hb->size = size;
+    hb->n = 0;
     hb->buckets = (HashBookNode**)calloc((size_t)size, sizeof(HashBookNode*));
     if (!hb->buckets) return 0;
     return 1;
@@ -40,32 +41,63 @@ void hb_free(HashBooks* hb) {
     free(hb->buckets);
     hb->buckets = NULL;
     hb->size = 0;
+    hb->n = 0;
 }
 
-Book* hb_get(HashBooks* hb, long long isbn) {
+/* Dobra a tabela quando fica cheia (um livro por bucket em média) */
+static void hb_grow(HashBooks* hb) {
+    int newsize = hb->size * 2;
+    HashBookNode** nb = (HashBookNode**)calloc((size_t)newsize, sizeof(HashBookNode*));
+    if (!nb) {
+        printf("Erro: sem memória.\n");
+        exit(1);
+    }
+    for (int i = 0; i < hb->size; i++) {
+        HashBookNode* cur = hb->buckets[i];
+        while (cur) {
+            HashBookNode* next = cur->next;
+            int idx = (int)(hash_isbn(cur->node->data.isbn) % (unsigned int)newsize);
+            cur->next = nb[idx];
+            nb[idx] = cur;
+            cur = next;
+        }
+    }
+    free(hb->buckets);
+    hb->buckets = nb;
+    hb->size = newsize;
+}
+
+BookNode* hb_get_node(HashBooks* hb, long long isbn) {
     if (!hb || !hb->buckets) return NULL;
 
     int idx = bucket_index(hb, isbn);
     for (HashBookNode* cur = hb->buckets[idx]; cur; cur = cur->next) {
-        if (cur->book->isbn == isbn) return cur->book;
+        if (cur->node->data.isbn == isbn) return cur->node;
     }
     return NULL;
 }
 
-int hb_insert(HashBooks* hb, Book* book) {
-    if (!hb || !hb->buckets || !book) return 0;
+Book* hb_get(HashBooks* hb, long long isbn) {
+    BookNode* n = hb_get_node(hb, isbn);
+    return n ? &n->data : NULL;
+}
+
+int hb_insert(HashBooks* hb, BookNode* node) {
+    if (!hb || !hb->buckets || !node) return 0;
 
-    if (hb_get(hb, book->isbn)) return 0; /* já existe */
+    if (hb_get_node(hb, node->data.isbn)) return 0; /* já existe */
 
-    int idx = bucket_index(hb, book->isbn);
+    if (hb->n >= hb->size) hb_grow(hb);
+    int idx = bucket_index(hb, node->data.isbn);
     HashBookNode* n = (HashBookNode*)malloc(sizeof(HashBookNode));
     if (!n) {
         printf("Erro: sem memória.\n");
         exit(1);
     }
-    n->book = book;
+    n->node = node;
     n->next = hb->buckets[idx];
     hb->buckets[idx] = n;
+    hb->n++;
     return 1;
 }
 
@@ -77,10 +109,11 @@ int hb_remove(HashBooks* hb, long long isbn) {
     HashBookNode* cur = hb->buckets[idx];
 
     while (cur) {
-        if (cur->book->isbn == isbn) {
+        if (cur->node->data.isbn == isbn) {
             if (prev) prev->next = cur->next;
             else hb->buckets[idx] = cur->next;
             free(cur);
+            hb->n--;
             return 1;
         }
         prev = cur;
@@ -92,6 +125,6 @@ int hb_remove(HashBooks* hb, long long isbn) {
 void hb_build_from_list(HashBooks* hb, BookNode* head) {
     /* assume hash vazia; em uso real, chamar hb_free/hb_init ou limpar antes */
     for (BookNode* cur = head; cur; cur = cur->next) {
-        hb_insert(hb, &cur->data);
+        hb_insert(hb, cur);
     }
 }
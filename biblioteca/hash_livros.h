@@ -4,13 +4,14 @@
 #include "livros.h"
 
 typedef struct HashBookNode {
-    Book* book;
+    BookNode* node;  /* nó da lista (o empréstimo marca o livro como alterado) */
     struct HashBookNode* next;
 } HashBookNode;
 
 typedef struct {
     HashBookNode** buckets;
-    int size; /* número de buckets */
+    int size; /* número de buckets (dobra quando enche) */
+    int n;    /* livros na tabela */
 } HashBooks;
 
 /* lifecycle */
@@ -20,7 +21,8 @@ void hb_free(HashBooks* hb);
 /* operações */
 void hb_build_from_list(HashBooks* hb, BookNode* head);
 Book* hb_get(HashBooks* hb, long long isbn);
-int  hb_insert(HashBooks* hb, Book* book);      /* 1 se inseriu, 0 se já existia */
+BookNode* hb_get_node(HashBooks* hb, long long isbn);
+int  hb_insert(HashBooks* hb, BookNode* node);  /* 1 se inseriu, 0 se já existia */
 int  hb_remove(HashBooks* hb, long long isbn);  /* 1 se removeu, 0 se não achou */
 
 #endif
@@ -0,0 +1,121 @@
+#include "hash_usuarios.h"
+#include <stdlib.h>
+#include <stdio.h>
+
+/* mesmo misturador de bits usado na hash de livros */
+static unsigned int hash_id(int id) {
+    unsigned long long x = (unsigned long long)(unsigned int)id;
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return (unsigned int)(x & 0xFFFFFFFFu);
+}
+
+static int bucket_index(HashUsers* hu, int id) {
+    return (int)(hash_id(id) % (unsigned int)hu->size);
+}
+
+int hu_init(HashUsers* hu, int size) {
+    hu->size = size;
+    hu->n = 0;
+    hu->buckets = (HashUserNode**)calloc((size_t)size, sizeof(HashUserNode*));
+    if (!hu->buckets) return 0;
+    return 1;
+}
+
+void hu_free(HashUsers* hu) {
+    if (!hu || !hu->buckets) return;
+
+    for (int i = 0; i < hu->size; i++) {
+        HashUserNode* cur = hu->buckets[i];
+        while (cur) {
+            HashUserNode* next = cur->next;
+            free(cur);
+            cur = next;
+        }
+    }
+    free(hu->buckets);
+    hu->buckets = NULL;
+    hu->size = 0;
+    hu->n = 0;
+}
+
+/* Dobra a tabela quando fica cheia (um usuário por bucket em média) */
+static void hu_grow(HashUsers* hu) {
+    int newsize = hu->size * 2;
+    HashUserNode** nb = (HashUserNode**)calloc((size_t)newsize, sizeof(HashUserNode*));
+    if (!nb) {
+        printf("Erro: sem memória.\n");
+        exit(1);
+    }
+    for (int i = 0; i < hu->size; i++) {
+        HashUserNode* cur = hu->buckets[i];
+        while (cur) {
+            HashUserNode* next = cur->next;
+            int idx = (int)(hash_id(cur->node->data.id) % (unsigned int)newsize);
+            cur->next = nb[idx];
+            nb[idx] = cur;
+            cur = next;
+        }
+    }
+    free(hu->buckets);
+    hu->buckets = nb;
+    hu->size = newsize;
+}
+
+UserNode* hu_get(HashUsers* hu, int id) {
+    if (!hu || !hu->buckets) return NULL;
+
+    for (HashUserNode* cur = hu->buckets[bucket_index(hu, id)]; cur; cur = cur->next) {
+        if (cur->node->data.id == id) return cur->node;
+    }
+    return NULL;
+}
+
+int hu_insert(HashUsers* hu, UserNode* node) {
+    if (!hu || !hu->buckets || !node) return 0;
+
+    if (hu_get(hu, node->data.id)) return 0; /* já existe */
+
+    if (hu->n >= hu->size) hu_grow(hu);
+    int idx = bucket_index(hu, node->data.id);
+    HashUserNode* n = (HashUserNode*)malloc(sizeof(HashUserNode));
+    if (!n) {
+        printf("Erro: sem memória.\n");
+        exit(1);
+    }
+    n->node = node;
+    n->next = hu->buckets[idx];
+    hu->buckets[idx] = n;
+    hu->n++;
+    return 1;
+}
+
+int hu_remove(HashUsers* hu, int id) {
+    if (!hu || !hu->buckets) return 0;
+
+    int idx = bucket_index(hu, id);
+    HashUserNode* prev = NULL;
+    HashUserNode* cur = hu->buckets[idx];
+
+    while (cur) {
+        if (cur->node->data.id == id) {
+            if (prev) prev->next = cur->next;
+            else hu->buckets[idx] = cur->next;
+            free(cur);
+            hu->n--;
+            return 1;
+        }
+        prev = cur;
+        cur = cur->next;
+    }
+    return 0;
+}
+
+void hu_build_from_list(HashUsers* hu, UserNode* head) {
+    for (UserNode* cur = head; cur; cur = cur->next) {
+        hu_insert(hu, cur);
+    }
+}
@@ -0,0 +1,30 @@
+#ifndef HASH_USUARIOS_H
+#define HASH_USUARIOS_H
+
+#include "usuarios.h"
+
+/* Usuários por ID, para empréstimos e devoluções não varrerem a lista
+   (a busca binária do menu continua no vetor ordenado de indices.h) */
+
+typedef struct HashUserNode {
+    UserNode* node;
+    struct HashUserNode* next;
+} HashUserNode;
+
+typedef struct {
+    HashUserNode** buckets;
+    int size; /* número de buckets (dobra quando enche) */
+    int n;    /* usuários na tabela */
+} HashUsers;
+
+/* lifecycle */
+int  hu_init(HashUsers* hu, int size);
+void hu_free(HashUsers* hu);
+
+/* operações */
+void hu_build_from_list(HashUsers* hu, UserNode* head);
+UserNode* hu_get(HashUsers* hu, int id);
+int  hu_insert(HashUsers* hu, UserNode* node);  /* 1 se inseriu, 0 se já existia */
+int  hu_remove(HashUsers* hu, int id);          /* 1 se removeu, 0 se não achou */
+
+#endif
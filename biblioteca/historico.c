@@ -0,0 +1,408 @@
+#include "historico.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+/* ---------- Funções auxiliares ---------- */
+
+static void* xmalloc(size_t sz) {
+    void* p = malloc(sz);
+    if (!p) {
+        printf("Erro: sem memória.\n");
+        exit(1);
+    }
+    return p;
+}
+
+/* ---------- API ---------- */
+
+void hl_init(HistLog* h) {
+    h->chunks = NULL;
+    h->n_chunks = 0;
+    h->cap_chunks = 0;
+    h->n = 0;
+}
+
+void hl_free(HistLog* h) {
+    for (int i = 0; i < h->n_chunks; i++) free(h->chunks[i]);
+    free(h->chunks);
+    hl_init(h);
+}
+
+long hl_append(HistLog* h, int type, int user_id, long long isbn, long long ts) {
+    int off = (int)(h->n & HIST_CHUNK_MASK);
+
+    if (off == 0) {
+        /* bloco cheio (ou log vazio): abre outro */
+        if (h->n_chunks == h->cap_chunks) {
+            int nc = h->cap_chunks ? h->cap_chunks * 2 : 16;
+            HistChunk** tmp = (HistChunk**)realloc(h->chunks, (size_t)nc * sizeof(HistChunk*));
+            if (!tmp) {
+                printf("Erro: sem memória.\n");
+                exit(1);
+            }
+            h->chunks = tmp;
+            h->cap_chunks = nc;
+        }
+        h->chunks[h->n_chunks++] = (HistChunk*)xmalloc(sizeof(HistChunk));
+    }
+
+    HistChunk* c = h->chunks[h->n_chunks - 1];
+    c->type[off] = (unsigned char)type;
+    c->user_id[off] = user_id;
+    c->isbn[off] = isbn;
+    /* 32 bits sem sinal cobrem até 2106 */
+    if (ts < 0) ts = 0;
+    if (ts > 0xFFFFFFFFLL) ts = 0xFFFFFFFFLL;
+    c->ts[off] = (unsigned int)ts;
+
+    return h->n++;
+}
+
+long hl_size(const HistLog* h) {
+    return h->n;
+}
+
+void hl_get(const HistLog* h, long i, HistEvent* out) {
+    const HistChunk* c = h->chunks[i >> HIST_CHUNK_BITS];
+    int off = (int)(i & HIST_CHUNK_MASK);
+    out->type = c->type[off];
+    out->user_id = c->user_id[off];
+    out->isbn = c->isbn[off];
+    out->ts = (long long)c->ts[off];
+}
+
+void hl_iter_forward(HistIter* it, const HistLog* h) {
+    it->log = h;
+    it->i = 0;
+    it->step = 1;
+}
+
+void hl_iter_backward(HistIter* it, const HistLog* h) {
+    it->log = h;
+    it->i = h->n - 1;
+    it->step = -1;
+}
+
+int hl_next(HistIter* it, HistEvent* out) {
+    if (it->i < 0 || it->i >= it->log->n) return 0;
+    hl_get(it->log, it->i, out);
+    it->i += it->step;
+    return 1;
+}
+
+unsigned long long hl_memory(const HistLog* h) {
+    return (unsigned long long)h->n_chunks * sizeof(HistChunk) +
+           (unsigned long long)h->cap_chunks * sizeof(HistChunk*);
+}
+
+/* ---------- Formato compacto ---------- */
+
+static unsigned char* put_varint(unsigned char* p, unsigned long long v) {
+    while (v >= 0x80) {
+        *p++ = (unsigned char)(v | 0x80);
+        v >>= 7;
+    }
+    *p++ = (unsigned char)v;
+    return p;
+}
+
+/* 0 se o varint passa do fim do bloco */
+static const unsigned char* get_varint(const unsigned char* p, const unsigned char* end,
+                                       unsigned long long* v) {
+    unsigned long long x = 0;
+    for (int shift = 0; p < end && shift < 64; shift += 7) {
+        unsigned char b = *p++;
+        x |= (unsigned long long)(b & 0x7F) << shift;
+        if (!(b & 0x80)) {
+            *v = x;
+            return p;
+        }
+    }
+    return NULL;
+}
+
+/* diferença com sinal -> sem sinal pequeno (0, -1, 1, -2, ...) */
+static unsigned long long zigzag(unsigned long long d) {
+    return (d << 1) ^ (unsigned long long)((long long)d >> 63);
+}
+
+static unsigned long long unzigzag(unsigned long long z) {
+    return (z >> 1) ^ (0ULL - (z & 1));
+}
+
+size_t hl_encode_block(const HistLog* h, long from, int n, unsigned char* out) {
+    int bits = 2;
+    for (int i = 0; i < n; i++) {
+        int t = h->chunks[(from + i) >> HIST_CHUNK_BITS]->type[(from + i) & HIST_CHUNK_MASK];
+        if (t < 1 || t > 4) {
+            bits = 8;
+            break;
+        }
+    }
+
+    out[0] = (unsigned char)n;
+    out[1] = (unsigned char)(n >> 8);
+    out[2] = (unsigned char)(n >> 16);
+    out[3] = (unsigned char)(n >> 24);
+    out[4] = (unsigned char)bits;
+    unsigned char* p = out + 5;
+
+    /* tipos: 4 por byte (tipo - 1 em 2 bits) */
+    if (bits == 2) {
+        size_t nb = (size_t)(n + 3) / 4;
+        for (size_t i = 0; i < nb; i++) p[i] = 0;
+        for (int i = 0; i < n; i++) {
+            int t = h->chunks[(from + i) >> HIST_CHUNK_BITS]->type[(from + i) & HIST_CHUNK_MASK];
+            p[i >> 2] |= (unsigned char)((t - 1) << ((i & 3) * 2));
+        }
+        p += nb;
+    } else {
+        for (int i = 0; i < n; i++) {
+            *p++ = h->chunks[(from + i) >> HIST_CHUNK_BITS]->type[(from + i) & HIST_CHUNK_MASK];
+        }
+    }
+
+    unsigned long long prev_isbn = 0, prev_ts = 0;
+    for (int i = 0; i < n; i++) {
+        const HistChunk* c = h->chunks[(from + i) >> HIST_CHUNK_BITS];
+        int off = (int)((from + i) & HIST_CHUNK_MASK);
+        unsigned long long isbn = (unsigned long long)c->isbn[off];
+        unsigned long long ts = c->ts[off];
+
+        p = put_varint(p, zigzag((unsigned long long)(long long)c->user_id[off]));
+        p = put_varint(p, zigzag(isbn - prev_isbn));
+        p = put_varint(p, zigzag(ts - prev_ts));
+        prev_isbn = isbn;
+        prev_ts = ts;
+    }
+    return (size_t)(p - out);
+}
+
+int hl_decode_block(const unsigned char* p, size_t len, HistEvent* out) {
+    if (len < 5) return -1;
+    const unsigned char* end = p + len;
+    unsigned int n = (unsigned int)p[0] | ((unsigned int)p[1] << 8) |
+                     ((unsigned int)p[2] << 16) | ((unsigned int)p[3] << 24);
+    int bits = p[4];
+    if (n > HIST_BLOCK_EVENTS || (bits != 2 && bits != 8)) return -1;
+    p += 5;
+
+    size_t nb = bits == 2 ? (n + 3) / 4 : n;
+    if ((size_t)(end - p) < nb) return -1;
+    for (unsigned int i = 0; i < n; i++) {
+        out[i].type = bits == 2 ? ((p[i >> 2] >> ((i & 3) * 2)) & 3) + 1 : p[i];
+    }
+    p += nb;
+
+    unsigned long long prev_isbn = 0, prev_ts = 0, v;
+    for (unsigned int i = 0; i < n; i++) {
+        if (!(p = get_varint(p, end, &v))) return -1;
+        out[i].user_id = (int)(long long)unzigzag(v);
+        if (!(p = get_varint(p, end, &v))) return -1;
+        prev_isbn += unzigzag(v);
+        out[i].isbn = (long long)prev_isbn;
+        if (!(p = get_varint(p, end, &v))) return -1;
+        prev_ts += unzigzag(v);
+        out[i].ts = (long long)prev_ts;
+    }
+    return p == end ? (int)n : -1;
+}
+
+/* ---------- Índices secundários ---------- */
+
+#define HI_INITIAL 1024
+
+static void* xcalloc(size_t n, size_t sz) {
+    void* p = calloc(n, sz);
+    if (!p) {
+        printf("Erro: sem memória.\n");
+        exit(1);
+    }
+    return p;
+}
+
+static unsigned int mix(unsigned long long x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return (unsigned int)(x & 0xFFFFFFFFu);
+}
+
+static unsigned int ts_at(const HistLog* h, HistPos pos) {
+    return h->chunks[pos >> HIST_CHUNK_BITS]->ts[pos & HIST_CHUNK_MASK];
+}
+
+static void post_init(HistPosting* p, long long key) {
+    p->key = key;
+    p->ev = NULL;
+    p->n = 0;
+    p->cap = 0;
+    p->sorted = 1;
+    p->next = NULL;
+}
+
+static void post_push(HistPosting* p, const HistLog* h, HistPos pos) {
+    if (p->n == p->cap) {
+        long nc = p->cap ? p->cap * 2 : 4;
+        HistPos* tmp = (HistPos*)realloc(p->ev, (size_t)nc * sizeof(HistPos));
+        if (!tmp) {
+            printf("Erro: sem memória.\n");
+            exit(1);
+        }
+        p->ev = tmp;
+        p->cap = nc;
+    }
+    if (p->n > 0 && ts_at(h, p->ev[p->n - 1]) > ts_at(h, pos)) p->sorted = 0;
+    p->ev[p->n++] = pos;
+}
+
+/* Par (instante, posição) para reordenar uma lista fora de ordem */
+typedef struct {
+    unsigned int ts;
+    HistPos pos;
+} TsPos;
+
+static int cmp_tspos(const void* a, const void* b) {
+    const TsPos* x = (const TsPos*)a;
+    const TsPos* y = (const TsPos*)b;
+    if (x->ts != y->ts) return (x->ts < y->ts) ? -1 : 1;
+    return (x->pos > y->pos) - (x->pos < y->pos);
+}
+
+static void post_sort(HistPosting* p, const HistLog* h) {
+    if (p->sorted) return;
+    TsPos* tmp = (TsPos*)malloc((size_t)p->n * sizeof(TsPos));
+    if (!tmp) {
+        printf("Erro: sem memória.\n");
+        exit(1);
+    }
+    for (long i = 0; i < p->n; i++) {
+        tmp[i].ts = ts_at(h, p->ev[i]);
+        tmp[i].pos = p->ev[i];
+    }
+    qsort(tmp, (size_t)p->n, sizeof(TsPos), cmp_tspos);
+    for (long i = 0; i < p->n; i++) p->ev[i] = tmp[i].pos;
+    free(tmp);
+    p->sorted = 1;
+}
+
+/* Primeiro índice da lista com instante >= t (lista ordenada) */
+static long post_lower(const HistPosting* p, const HistLog* h, unsigned long long t) {
+    long lo = 0, hi = p->n;
+    while (lo < hi) {
+        long mid = lo + (hi - lo) / 2;
+        if (ts_at(h, p->ev[mid]) < t) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+static long post_range(HistPosting* p, const HistLog* h, long long from, long long to, const HistPos** out) {
+    *out = NULL;
+    if (!p || p->n == 0 || to < from || to < 0) return 0;
+    post_sort(p, h);
+
+    unsigned long long lo_t = (from < 0) ? 0 : (unsigned long long)from;
+    unsigned long long hi_t = (unsigned long long)to + 1;
+    long a = post_lower(p, h, lo_t);
+    long b = post_lower(p, h, hi_t);
+    *out = p->ev + a;
+    return b - a;
+}
+
+static void map_init(HistPostMap* m) {
+    m->size = HI_INITIAL;
+    m->n = 0;
+    m->table = (HistPosting**)xcalloc((size_t)m->size, sizeof(HistPosting*));
+}
+
+static void map_free(HistPostMap* m) {
+    for (int i = 0; i < m->size; i++) {
+        HistPosting* p = m->table[i];
+        while (p) {
+            HistPosting* nx = p->next;
+            free(p->ev);
+            free(p);
+            p = nx;
+        }
+    }
+    free(m->table);
+    m->table = NULL;
+    m->size = m->n = 0;
+}
+
+static void map_grow(HistPostMap* m) {
+    int newsize = m->size * 2;
+    HistPosting** nt = (HistPosting**)xcalloc((size_t)newsize, sizeof(HistPosting*));
+    for (int i = 0; i < m->size; i++) {
+        HistPosting* p = m->table[i];
+        while (p) {
+            HistPosting* nx = p->next;
+            int b = (int)(mix((unsigned long long)p->key) % (unsigned int)newsize);
+            p->next = nt[b];
+            nt[b] = p;
+            p = nx;
+        }
+    }
+    free(m->table);
+    m->table = nt;
+    m->size = newsize;
+}
+
+static HistPosting* map_find(const HistPostMap* m, long long key) {
+    int b = (int)(mix((unsigned long long)key) % (unsigned int)m->size);
+    for (HistPosting* p = m->table[b]; p; p = p->next) {
+        if (p->key == key) return p;
+    }
+    return NULL;
+}
+
+static HistPosting* map_get_or_add(HistPostMap* m, long long key) {
+    HistPosting* p = map_find(m, key);
+    if (p) return p;
+
+    if (m->n >= m->size) map_grow(m);
+    int b = (int)(mix((unsigned long long)key) % (unsigned int)m->size);
+    p = (HistPosting*)xmalloc(sizeof(HistPosting));
+    post_init(p, key);
+    p->next = m->table[b];
+    m->table[b] = p;
+    m->n++;
+    return p;
+}
+
+void hi_init(HistIndex* x) {
+    map_init(&x->by_user);
+    map_init(&x->by_book);
+    post_init(&x->all, 0);
+}
+
+void hi_free(HistIndex* x) {
+    map_free(&x->by_user);
+    map_free(&x->by_book);
+    free(x->all.ev);
+    post_init(&x->all, 0);
+}
+
+void hi_add(HistIndex* x, const HistLog* h, long pos) {
+    const HistChunk* c = h->chunks[pos >> HIST_CHUNK_BITS];
+    int off = (int)(pos & HIST_CHUNK_MASK);
+
+    post_push(map_get_or_add(&x->by_user, c->user_id[off]), h, (HistPos)pos);
+    post_push(map_get_or_add(&x->by_book, c->isbn[off]), h, (HistPos)pos);
+    post_push(&x->all, h, (HistPos)pos);
+}
+
+long hi_user_range(HistIndex* x, const HistLog* h, int user_id, long long from, long long to, const HistPos** out) {
+    return post_range(map_find(&x->by_user, user_id), h, from, to, out);
+}
+
+long hi_book_range(HistIndex* x, const HistLog* h, long long isbn, long long from, long long to, const HistPos** out) {
+    return post_range(map_find(&x->by_book, isbn), h, from, to, out);
+}
+
+long hi_time_range(HistIndex* x, const HistLog* h, long long from, long long to, const HistPos** out) {
+    return post_range(&x->all, h, from, to, out);
+}
@@ -0,0 +1,123 @@
+#ifndef HISTORICO_H
+#define HISTORICO_H
+
+#include <stddef.h>
+
+/* Histórico de empréstimos como log só de acréscimo, em colunas.
+   Os eventos ficam em blocos de tamanho fixo (um vetor por campo), então
+   cada evento ocupa 17 bytes (tipo 1 + usuário 4 + isbn 8 + instante 4),
+   sem malloc por evento, e dá para percorrer nos dois sentidos. */
+
+#define HIST_CHUNK_BITS 12
+#define HIST_CHUNK      (1 << HIST_CHUNK_BITS)   /* eventos por bloco */
+#define HIST_CHUNK_MASK (HIST_CHUNK - 1)
+
+/* Um bloco: colunas separadas */
+typedef struct {
+    unsigned char type[HIST_CHUNK];
+    int user_id[HIST_CHUNK];
+    long long isbn[HIST_CHUNK];
+    unsigned int ts[HIST_CHUNK];      /* segundos desde 1970 (0 = desconhecido) */
+} HistChunk;
+
+typedef struct {
+    HistChunk** chunks;
+    int n_chunks;
+    int cap_chunks;
+    long n;                           /* total de eventos */
+} HistLog;
+
+/* Um evento lido do log */
+typedef struct {
+    int type;
+    int user_id;
+    long long isbn;
+    long long ts;
+} HistEvent;
+
+/* Iterador (para frente = do mais antigo; para trás = do mais recente) */
+typedef struct {
+    const HistLog* log;
+    long i;
+    int step;
+} HistIter;
+
+void hl_init(HistLog* h);
+void hl_free(HistLog* h);
+
+/* acrescenta no fim; retorna a posição do evento */
+long hl_append(HistLog* h, int type, int user_id, long long isbn, long long ts);
+
+long hl_size(const HistLog* h);
+void hl_get(const HistLog* h, long i, HistEvent* out);
+
+void hl_iter_forward(HistIter* it, const HistLog* h);
+void hl_iter_backward(HistIter* it, const HistLog* h);
+int  hl_next(HistIter* it, HistEvent* out);   /* 0 quando acabou */
+
+/* memória ocupada (bytes) */
+unsigned long long hl_memory(const HistLog* h);
+
+/* ---------- Formato compacto (gravação) ---------- */
+
+/* Blocos de até HIST_BLOCK_EVENTS eventos, cada um decodificável sozinho:
+   quantidade (4 bytes LE), bits por tipo (2, ou 8 se algum tipo não
+   couber), os tipos empacotados e depois, por evento, usuário em varint e
+   ISBN e instante como diferença para o evento anterior do bloco (varint
+   zigzag). Em ISBNs repetidos e eventos próximos no tempo, cada campo
+   costuma caber em 1 ou 2 bytes. */
+#define HIST_BLOCK_EVENTS 1024
+#define HIST_BLOCK_MAX    (5 + HIST_BLOCK_EVENTS * 21)   /* pior caso */
+#define HIST_RAW_EVENT    16    /* tipo 4 + usuário 4 + isbn 8 no formato antigo */
+
+/* Codifica os eventos [from, from + n) (n <= HIST_BLOCK_EVENTS) em out,
+   que tem HIST_BLOCK_MAX bytes. Retorna o tamanho do bloco. */
+size_t hl_encode_block(const HistLog* h, long from, int n, unsigned char* out);
+
+/* Decodifica um bloco em out (HIST_BLOCK_EVENTS posições). Retorna
+   quantos eventos, ou -1 se o bloco estiver mal formado. */
+int hl_decode_block(const unsigned char* p, size_t len, HistEvent* out);
+
+/* ---------- Índices secundários ---------- */
+
+/* Posições no log (até 4 bilhões de eventos) */
+typedef unsigned int HistPos;
+
+/* Lista de eventos de uma chave (usuário ou ISBN), na ordem do instante.
+   Eventos chegam quase sempre em ordem; quando não (importação), a lista
+   é marcada e reordenada uma vez só, na próxima consulta. */
+typedef struct HistPosting {
+    long long key;
+    HistPos* ev;
+    long n;
+    long cap;
+    int sorted;
+    struct HistPosting* next;
+} HistPosting;
+
+typedef struct {
+    HistPosting** table;
+    int size;
+    int n;
+} HistPostMap;
+
+typedef struct {
+    HistPostMap by_user;
+    HistPostMap by_book;
+    HistPosting all;        /* todos os eventos: consultas só por período */
+} HistIndex;
+
+void hi_init(HistIndex* x);
+void hi_free(HistIndex* x);
+
+/* indexa o evento 'pos' (chamar logo depois de hl_append) */
+void hi_add(HistIndex* x, const HistLog* h, long pos);
+
+/* Eventos com instante em [from, to], em ordem de tempo. Retorna quantos
+   e aponta *out para eles (válido até o próximo hi_add).
+   Custo: O(log n + resultados). */
+long hi_user_range(HistIndex* x, const HistLog* h, int user_id, long long from, long long to, const HistPos** out);
+long hi_book_range(HistIndex* x, const HistLog* h, long long isbn, long long from, long long to, const HistPos** out);
+long hi_time_range(HistIndex* x, const HistLog* h, long long from, long long to, const HistPos** out);
+
+#endif
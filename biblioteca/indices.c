@@ -0,0 +1,253 @@
+#include "indices.h"
+#include "busca_usuarios.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* Ordem da fila: os mais demorados primeiro */
+static const int task_order[CI_N] = { CI_TEXT, CI_TITLES, CI_RANK, CI_ISBNS, CI_USERS };
+
+static const char* index_names[CI_N] = {
+    "de texto", "por título (AVL)", "de popularidade", "por ISBN (B+)", "de usuários por ID"
+};
+
+/* ---------- Funções auxiliares ---------- */
+
+/* Hash de um livro (FNV-1a) só com o que os índices usam */
+static unsigned long long book_hash(const Book* b) {
+    unsigned long long h = 1469598103934665603ULL;
+    unsigned long long isbn = (unsigned long long)b->isbn;
+    for (int i = 0; i < 8; i++) {
+        h ^= (unsigned char)(isbn >> (8 * i));
+        h *= 1099511628211ULL;
+    }
+    for (const char* s = b->title; *s; s++) {
+        h ^= (unsigned char)*s;
+        h *= 1099511628211ULL;
+    }
+    h ^= 0xFF;   /* separa título e autor */
+    h *= 1099511628211ULL;
+    for (const char* s = b->author; *s; s++) {
+        h ^= (unsigned char)*s;
+        h *= 1099511628211ULL;
+    }
+    /* mistura final: a soma de vários hashes não se cancela fácil */
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return h;
+}
+
+/* Texto: do arquivo, se a marca bater; senão refeito da lista */
+static void build_text(CatalogIndex* ci) {
+    ci->stamp = 0;
+    for (BookNode* cur = ci->books; cur; cur = cur->next) ci->stamp += book_hash(&cur->data);
+
+    ci->text_loaded = ti_load(&ci->text, TEXT_INDEX_FILE, ci->stamp);
+    if (ci->text_loaded) {
+        ci->saved_stamp = ci->stamp;
+    } else {
+        ti_build(&ci->text, ci->books);
+    }
+    ci->text_stamp = ci->stamp;
+}
+
+/* Monta um índice; cada um escreve só nos próprios campos */
+static void build_index(CatalogIndex* ci, int which) {
+    switch (which) {
+        case CI_TEXT: build_text(ci); break;
+        case CI_TITLES: ci->titles = avl_build_from_list(ci->books); break;
+        case CI_ISBNS: ci->isbns = bpt_build_from_list(ci->books); break;
+        case CI_RANK:
+            if (!rank_build_from_list(&ci->rank, ci->books)) {
+                printf("Erro: sem memória.\n");
+                exit(1);
+            }
+            break;
+        case CI_USERS: ci->by_id = users_build_sorted_array(ci->users, &ci->n_by_id); break;
+    }
+}
+
+static void run_task(CatalogIndex* ci, int which) {
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    build_index(ci, which);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+
+    pthread_mutex_lock(&ci->mu);
+    ci->secs[which] = (double)(t1.tv_sec - t0.tv_sec) + (double)(t1.tv_nsec - t0.tv_nsec) / 1e9;
+    ci->done |= 1 << which;
+    pthread_cond_broadcast(&ci->cv);
+    pthread_mutex_unlock(&ci->mu);
+}
+
+/* Cada thread pega o próximo índice da fila até ela acabar */
+static void* worker_main(void* arg) {
+    CatalogIndex* ci = (CatalogIndex*)arg;
+    for (;;) {
+        pthread_mutex_lock(&ci->mu);
+        int which = ci->next_task < CI_N ? task_order[ci->next_task++] : -1;
+        pthread_mutex_unlock(&ci->mu);
+        if (which < 0) return NULL;
+        run_task(ci, which);
+    }
+}
+
+/* Publica o que as threads terminaram (só a thread principal chama) */
+static void publish(CatalogIndex* ci) {
+    if (!ci->pending) return;
+    pthread_mutex_lock(&ci->mu);
+    int fresh = ci->done & ci->pending;
+    pthread_mutex_unlock(&ci->mu);
+
+    ci->pending &= ~fresh;
+    ci->ready |= fresh;
+    ci->news |= fresh;
+    if (!ci->pending) {
+        for (int t = 0; t < ci->n_workers; t++) pthread_join(ci->workers[t], NULL);
+        ci->n_workers = 0;
+    }
+}
+
+/* Espera um índice que ainda está na fila */
+static void wait_for(CatalogIndex* ci, int which) {
+    if (!(ci->pending & (1 << which))) return;
+    pthread_mutex_lock(&ci->mu);
+    while (!(ci->done & (1 << which))) pthread_cond_wait(&ci->cv, &ci->mu);
+    pthread_mutex_unlock(&ci->mu);
+    publish(ci);
+}
+
+/* ---------- API ---------- */
+
+void ci_init(CatalogIndex* ci) {
+    memset(ci, 0, sizeof(*ci));
+    pthread_mutex_init(&ci->mu, NULL);
+    pthread_cond_init(&ci->cv, NULL);
+}
+
+void ci_free(CatalogIndex* ci) {
+    ci_settle(ci);
+    ti_free(&ci->text);
+    avl_free(ci->titles);
+    bpt_free(ci->isbns);
+    rank_free(&ci->rank);
+    free(ci->by_id);
+    ci->titles = NULL;
+    ci->isbns = NULL;
+    ci->by_id = NULL;
+    ci->ready = 0;
+    pthread_cond_destroy(&ci->cv);
+    pthread_mutex_destroy(&ci->mu);
+}
+
+void ci_open(CatalogIndex* ci, BookNode* books, UserNode* users, int nthreads) {
+    ci->books = books;
+    ci->users = users;
+    if (!ti_init(&ci->text, TEXT_INDEX_SIZE) || !rank_init(&ci->rank, 997)) {
+        printf("Erro: sem memória.\n");
+        exit(1);
+    }
+
+    ci->pending = (1 << CI_N) - 1;
+    ci->next_task = 0;
+    if (nthreads > CI_MAX_WORKERS) nthreads = CI_MAX_WORKERS;
+    if (nthreads > CI_N) nthreads = CI_N;
+    for (int t = 0; t < nthreads; t++) {
+        if (pthread_create(&ci->workers[ci->n_workers], NULL, worker_main, ci) == 0) ci->n_workers++;
+    }
+    /* sem threads: monta tudo aqui mesmo */
+    if (ci->n_workers == 0) worker_main(ci);
+}
+
+int ci_poll(CatalogIndex* ci) {
+    publish(ci);
+    int fresh = ci->news;
+    ci->news = 0;
+    return fresh;
+}
+
+int ci_ready(CatalogIndex* ci, int which) {
+    publish(ci);
+    return (ci->ready & (1 << which)) != 0;
+}
+
+const char* ci_name(int which) {
+    return which >= 0 && which < CI_N ? index_names[which] : "?";
+}
+
+void ci_settle(CatalogIndex* ci) {
+    for (int k = 0; k < CI_N; k++) wait_for(ci, k);
+}
+
+AVLNode* ci_titles(CatalogIndex* ci, BookNode* books) {
+    wait_for(ci, CI_TITLES);
+    if (!(ci->ready & (1 << CI_TITLES))) {
+        ci->titles = avl_build_from_list(books);
+        ci->ready |= 1 << CI_TITLES;
+    }
+    return ci->titles;
+}
+
+BPTree* ci_isbns(CatalogIndex* ci, BookNode* books) {
+    wait_for(ci, CI_ISBNS);
+    if (!(ci->ready & (1 << CI_ISBNS))) {
+        ci->isbns = bpt_build_from_list(books);
+        ci->ready |= 1 << CI_ISBNS;
+    }
+    return ci->isbns;
+}
+
+TopRank* ci_rank(CatalogIndex* ci) {
+    wait_for(ci, CI_RANK);
+    return &ci->rank;
+}
+
+User** ci_users(CatalogIndex* ci, UserNode* users, int* out_n) {
+    wait_for(ci, CI_USERS);
+    if (!(ci->ready & (1 << CI_USERS))) {
+        ci->by_id = users_build_sorted_array(users, &ci->n_by_id);
+        ci->ready |= 1 << CI_USERS;
+    }
+    *out_n = ci->n_by_id;
+    return ci->by_id;
+}
+
+void ci_book_added(CatalogIndex* ci, Book* b) {
+    ci->stamp += book_hash(b);
+    ti_add_book(&ci->text, b);
+    ci->text_stamp = ci->stamp;
+    if (ci->ready & (1 << CI_TITLES)) ci->titles = avl_insert(ci->titles, b);
+    if (ci->ready & (1 << CI_ISBNS)) bpt_insert(ci->isbns, b->isbn, b);
+    rank_add(&ci->rank, b->isbn, b, 0);
+}
+
+void ci_book_removed(CatalogIndex* ci, const Book* b) {
+    ci->stamp -= book_hash(b);
+    ti_remove_book(&ci->text, b);
+    ci->text_stamp = ci->stamp;
+    rank_remove(&ci->rank, b->isbn);
+
+    /* AVL e B+ não têm remoção: são refeitos no próximo uso */
+    avl_free(ci->titles);
+    bpt_free(ci->isbns);
+    ci->titles = NULL;
+    ci->isbns = NULL;
+    ci->ready &= ~((1 << CI_TITLES) | (1 << CI_ISBNS));
+}
+
+void ci_users_changed(CatalogIndex* ci) {
+    free(ci->by_id);
+    ci->by_id = NULL;
+    ci->n_by_id = 0;
+    ci->ready &= ~(1 << CI_USERS);
+}
+
+int ci_save(CatalogIndex* ci, int wait) {
+    if (wait) ci_settle(ci);
+    if (!ci_ready(ci, CI_TEXT) || ci->text_stamp == ci->saved_stamp) return 0;
+    if (!ti_save(&ci->text, TEXT_INDEX_FILE, ci->text_stamp)) return 0;
+    ci->saved_stamp = ci->text_stamp;
+    return 1;
+}
@@ -0,0 +1,102 @@
+#ifndef INDICES_H
+#define INDICES_H
+
+#include <pthread.h>
+#include "livros.h"
+#include "usuarios.h"
+#include "texto_busca.h"
+#include "avl.h"
+#include "bptree.h"
+#include "top_livros.h"
+
+/* Índices derivados do catálogo, montados em paralelo na abertura.
+
+   Texto, AVL por título, B+ por ISBN, ranking de popularidade e o vetor
+   de usuários por ID não dependem uns dos outros: ci_open põe todos numa
+   fila e algumas threads vão pegando o próximo. Enquanto isso o catálogo
+   é só leitura (quem vai alterar livros, usuários ou empréstimos chama
+   ci_settle antes), e a hash por ISBN é montada pela thread principal, que
+   já mostra o menu. Cada índice é publicado quando fica pronto (ci_poll);
+   quem precisa de um que ainda não ficou espera só por ele.
+
+   O índice de texto fica num arquivo com a marca do catálogo: a soma de um
+   hash por livro (ISBN, título e autor), que muda quando um livro entra ou
+   sai e não depende da ordem da lista. Com a marca certa o arquivo é lido
+   em vez de refeito; até o índice sair, as buscas varrem a lista. */
+
+#define TEXT_INDEX_FILE "indice_texto.dat"
+#define TEXT_INDEX_SIZE 4093
+#define CI_MAX_WORKERS  4
+
+typedef enum {
+    CI_TEXT = 0,     /* palavras de título/autor -> ISBNs */
+    CI_TITLES,       /* AVL por título (listagem em ordem alfabética) */
+    CI_RANK,         /* ranking de popularidade */
+    CI_ISBNS,        /* B+ por ISBN (intervalos) */
+    CI_USERS,        /* usuários ordenados por ID (busca binária) */
+    CI_N
+} CiIndex;
+
+typedef struct {
+    /* catálogo usado pela montagem (só leitura até ci_settle) */
+    BookNode* books;
+    UserNode* users;
+
+    unsigned long long stamp;        /* marca do catálogo atual */
+
+    TextIndex text;
+    int text_loaded;                 /* veio do arquivo (não foi refeito) */
+    unsigned long long text_stamp;   /* catálogo que o índice reflete */
+    unsigned long long saved_stamp;  /* marca do arquivo gravado (0 = nenhum) */
+    AVLNode* titles;
+    BPTree* isbns;
+    TopRank rank;
+    User** by_id;
+    int n_by_id;
+
+    int ready;                       /* publicados (bit 1 << CiIndex) */
+    int pending;                     /* na fila da montagem, ainda não publicados */
+    int news;                        /* publicados desde o último ci_poll */
+    double secs[CI_N];               /* tempo de montagem de cada um */
+
+    /* montagem em paralelo */
+    pthread_t workers[CI_MAX_WORKERS];
+    int n_workers;
+    pthread_mutex_t mu;
+    pthread_cond_t cv;
+    int next_task;                   /* próximo índice da fila */
+    int done;                        /* montados pelas threads */
+} CatalogIndex;
+
+void ci_init(CatalogIndex* ci);
+void ci_free(CatalogIndex* ci);   /* espera a montagem, se houver */
+
+/* Começa a montar os índices com até 'nthreads' threads */
+void ci_open(CatalogIndex* ci, BookNode* books, UserNode* users, int nthreads);
+
+/* Bits dos índices publicados desde a última chamada (não espera) */
+int  ci_poll(CatalogIndex* ci);
+int  ci_ready(CatalogIndex* ci, int which);
+const char* ci_name(int which);
+
+/* Espera a montagem inteira; depois disso o catálogo pode mudar */
+void ci_settle(CatalogIndex* ci);
+
+/* Índices prontos para uso: esperam a montagem deste (se ainda estiver na
+   fila) ou refazem a partir da lista se uma alteração o descartou */
+AVLNode* ci_titles(CatalogIndex* ci, BookNode* books);
+BPTree*  ci_isbns(CatalogIndex* ci, BookNode* books);
+TopRank* ci_rank(CatalogIndex* ci);
+User**   ci_users(CatalogIndex* ci, UserNode* users, int* out_n);
+
+/* Mantém marca e índices junto com o catálogo (depois de ci_settle).
+   b é o livro já na lista; na remoção, uma cópia do que saiu. */
+void ci_book_added(CatalogIndex* ci, Book* b);
+void ci_book_removed(CatalogIndex* ci, const Book* b);
+void ci_users_changed(CatalogIndex* ci);
+
+/* Grava o índice de texto se mudou desde o último arquivo (1 = gravou).
+   Com wait, espera a montagem para gravá-lo também. */
+int  ci_save(CatalogIndex* ci, int wait);
+
+#endif
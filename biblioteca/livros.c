@@ -10,6 +10,8 @@ static BookNode* booknode_new(const Book* b) {
         exit(1);
     }
     n->data = *b; /* copia os dados do livro */
+    n->slot = -1;
+    n->dirty = 1;
     n->next = NULL;
     return n;
 }
@@ -32,7 +34,7 @@ void books_push_front(BookNode** head, const Book* b) {
 }
 
 /* Remove um livro da lista usando o ISBN */
-int books_remove(BookNode** head, long long isbn) {
+int books_remove(BookNode** head, SlotMap* slots, long long isbn) {
     BookNode* prev = NULL;
     BookNode* cur = *head;
 
@@ -40,6 +42,7 @@ int books_remove(BookNode** head, long long isbn) {
         if (cur->data.isbn == isbn) {
             if (prev) prev->next = cur->next;
             else *head = cur->next;
+            sm_release(slots, cur->slot); /* vira lápide no próximo save */
             free(cur);
             return 1;
         }
@@ -48,22 +51,6 @@ int books_remove(BookNode** head, long long isbn) {
     }
     return 0;
 }
-/* Mostra todos os livros cadastrados */
-void books_print(BookNode* head) {
-    if (!head) {
-        printf("\n(Nenhum livro cadastrado)\n");
-        return;
-    }
-
-    printf("\n---- LISTA DE LIVROS ----\n");
-    for (BookNode* cur = head; cur; cur = cur->next) {
-        Book* b = &cur->data;
-
-        printf("ISBN: %I64d | \"%s\" | Autor: %s | Ano: %d | Disp: %d/%d | Emprest.: %d\n",
-               b->isbn, b->title, b->author, b->year,
-               b->copies_available, b->copies_total, b->times_borrowed);
-    }
-}
 
 void books_free(BookNode* head) {
     while (head) {
@@ -73,32 +60,110 @@ void books_free(BookNode* head) {
     }
 }
 
-/* ---------- Arquivo ---------- */
-/* Salva todos os livros em um arquivo binário */
-void books_save(BookNode* head) {
-    FILE* f = fopen(BOOKS_FILE, "wb");
-    if (!f) {
-        printf("Erro ao abrir %s para escrita.\n", BOOKS_FILE);
-        return;
+void books_touch(BookNode* n) {
+    n->dirty = 1;
+}
+
+/* ---------- Banco ---------- */
+
+/* Registro no banco: little-endian, campos em posição fixa */
+void book_encode(const Book* b, unsigned char* p) {
+    memset(p, 0, DB_REC_BOOK);
+    le_put64(p, (unsigned long long)b->isbn);
+    memcpy(p + 8, b->title, sizeof(b->title));
+    memcpy(p + 128, b->author, sizeof(b->author));
+    le_put32(p + 208, (unsigned int)b->year);
+    le_put32(p + 212, (unsigned int)b->copies_total);
+    le_put32(p + 216, (unsigned int)b->copies_available);
+    le_put32(p + 220, (unsigned int)b->times_borrowed);
+}
+
+void book_decode(const unsigned char* p, Book* b) {
+    b->isbn = (long long)le_get64(p);
+    memcpy(b->title, p + 8, sizeof(b->title));
+    memcpy(b->author, p + 128, sizeof(b->author));
+    b->title[sizeof(b->title) - 1] = '\0';
+    b->author[sizeof(b->author) - 1] = '\0';
+    b->year = (int)le_get32(p + 208);
+    b->copies_total = (int)le_get32(p + 212);
+    b->copies_available = (int)le_get32(p + 216);
+    b->times_borrowed = (int)le_get32(p + 220);
+}
+
+/* Registro lido no slot: lápide, duplicado ou livro */
+static void load_slot(BookNode** head, SlotMap* slots, const Book* b) {
+    long slot = slots->n_slots++;
+    if (b->isbn == BOOK_TOMBSTONE) {
+        sm_loaded_free(slots, slot);
+    } else if (books_find_by_isbn(*head, b->isbn)) {
+        sm_release(slots, slot);   /* duplicado: vira lápide */
+    } else {
+        books_push_front(head, b);
+        (*head)->slot = slot;
+        (*head)->dirty = 0;
     }
+}
+
+BookNode* books_load_db(Db* db, SlotMap* slots) {
+    BookNode* head = NULL;
+    unsigned char buf[64 * DB_REC_BOOK];
+    DbReader r;
+    size_t got;
+
+    sm_free(slots);
+    db_reader_open(db, DB_BOOKS, &r);
+    while ((got = db_read(&r, buf, sizeof(buf))) >= DB_REC_BOOK) {
+        for (size_t off = 0; off + DB_REC_BOOK <= got; off += DB_REC_BOOK) {
+            Book b;
+            book_decode(buf + off, &b);
+            load_slot(&head, slots, &b);
+        }
+    }
+    return head;
+}
+
+unsigned char* books_changes(BookNode* head, SlotMap* slots, size_t* out_len) {
+    SlotPatch p;
+    sp_init(&p, DB_REC_BOOK);
+    unsigned char rec[DB_REC_BOOK];
+
+    long mark = sm_begin(slots);
     for (BookNode* cur = head; cur; cur = cur->next) {
-        fwrite(&cur->data, sizeof(Book), 1, f);
+        if (cur->slot < 0) cur->slot = sm_take(slots);
+        else if (!cur->dirty && !slots->full) continue;
+        book_encode(&cur->data, rec);
+        sp_put(&p, cur->slot, rec);
+        cur->dirty = 0;
     }
-    fclose(f);
-    printf("Livros salvos em %s.\n", BOOKS_FILE);
+
+    Book tomb;
+    memset(&tomb, 0, sizeof(tomb));
+    tomb.isbn = BOOK_TOMBSTONE;
+    book_encode(&tomb, rec);
+    sm_tombstones(slots, mark, &p, rec);
+
+    *out_len = p.len;
+    return p.data;
+}
+
+void books_changes_done(SlotMap* slots, int ok) {
+    if (!ok) slots->full = 1;
+}
+
+void books_changes_all(SlotMap* slots) {
+    slots->full = 1;
 }
 /* Lê os livros do arquivo e recria a lista */
-BookNode* books_load(void) {
+BookNode* books_load(SlotMap* slots) {
     FILE* f = fopen(BOOKS_FILE, "rb");
     if (!f) return NULL;
 
     BookNode* head = NULL;
     Book tmp;
 
+    sm_free(slots);
     while (fread(&tmp, sizeof(Book), 1, f) == 1) {
-        if (!books_find_by_isbn(head, tmp.isbn)) {
-            books_push_front(&head, &tmp);
-        }
+        load_slot(&head, slots, &tmp);
     }
     fclose(f);
     return head;
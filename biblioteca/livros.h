@@ -2,8 +2,12 @@
 #define LIVROS_H
 
 #include <stdio.h>
+#include <limits.h>
+#include "banco.h"
+#include "registros.h"
 
 #define BOOKS_FILE "livros.dat"
+#define BOOK_TOMBSTONE LLONG_MIN   /* isbn de um slot vago no livros.dat */
 
 typedef struct {
     long long isbn;
@@ -17,19 +21,36 @@ typedef struct {
 /* Nó da lista ligada de livros */
 typedef struct BookNode {
     Book data;
+    long slot;    /* slot na tabela de livros (-1 = ainda não gravado) */
+    int dirty;    /* alterado desde o último save */
     struct BookNode* next;
 } BookNode;
 
 /* Lista */
 BookNode* books_find_by_isbn(BookNode* head, long long isbn);
 void books_push_front(BookNode** head, const Book* b); /* Insere um livro no início da lista */
-int  books_remove(BookNode** head, long long isbn); /* Remove um livro da lista usando o ISBN */
-void books_print(BookNode* head);/* Mostra todos os livros na tela */
+int  books_remove(BookNode** head, SlotMap* slots, long long isbn); /* Remove pelo ISBN (o slot vira lápide) */
 void books_free(BookNode* head);/* Libera toda a memória da lista */
+void books_touch(BookNode* n); /* Marca o livro como alterado (entra no próximo save) */
 
-/* Arquivo */
-/* Salva os livros no arquivo binário */
-void books_save(BookNode* head);
-BookNode* books_load(void);
+/* Os slots dos livros no banco ficam no SlotMap de quem abriu (motor.h);
+   as cargas começam o mapa do zero. */
+
+/* Arquivo (livros.dat do formato anterior; só a carga, para migrar) */
+BookNode* books_load(SlotMap* slots);
+/* Banco (biblioteca.db): lê a tabela de livros */
+BookNode* books_load_db(Db* db, SlotMap* slots);
+
+/* Registro de DB_REC_BOOK bytes (little-endian; também usado no diário) */
+void book_encode(const Book* b, unsigned char* p);
+void book_decode(const unsigned char* p, Book* b);
+
+/* Save incremental: remendos (slot, registro de DB_REC_BOOK bytes) só dos
+   livros alterados, novos e removidos desde o último save, num buffer
+   alocado (quem chama libera). Depois de gravar, avisar com
+   books_changes_done (ok = 0 faz o próximo save escrever tudo). */
+unsigned char* books_changes(BookNode* head, SlotMap* slots, size_t* out_len);
+void books_changes_done(SlotMap* slots, int ok);
+void books_changes_all(SlotMap* slots);   /* o próximo save escreve todos os slots */
 
 #endif
@@ -1,17 +1,15 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+#include <limits.h>
 
-#include "livros.h"
-#include "usuarios.h"
-#include "emprestimos.h"
-#include "avl.h"
-#include "hash_livros.h"
-#include "busca_usuarios.h"
-#include "top_livros.h"
+#include "motor.h"
+#include "saida.h"
+#include "servidor.h"
+#include "plataforma.h"
 #include "dsu.h"
-#include "texto_busca.h"
-#include "bptree.h"
+#include "dsu_paralelo.h"
 
 
 
@@ -60,86 +58,138 @@ static int read_int(const char* prompt) {
     }
 }
 
+/* Data dd/mm/aaaa (hora local); fim_do_dia = 1 pega 23:59:59.
+   Vazio = sem limite (retorna -1). */
+static long long read_date(const char* prompt, int end_of_day) {
+    char buf[64];
+    while (1) {
+        read_line(prompt, buf, sizeof(buf));
+        if (buf[0] == '\0') return -1;
+
+        int d, m, y;
+        char extra;
+        if (sscanf(buf, "%d/%d/%d%c", &d, &m, &y, &extra) == 3 &&
+            d >= 1 && d <= 31 && m >= 1 && m <= 12 && y >= 1970) {
+            struct tm tmv;
+            memset(&tmv, 0, sizeof(tmv));
+            tmv.tm_mday = d;
+            tmv.tm_mon = m - 1;
+            tmv.tm_year = y - 1900;
+            tmv.tm_isdst = -1;
+            if (end_of_day) {
+                tmv.tm_hour = 23;
+                tmv.tm_min = 59;
+                tmv.tm_sec = 59;
+            }
+            time_t t = mktime(&tmv);
+            if (t != (time_t)-1) return (long long)t;
+        }
 
-/* Converte user_id em índice do vetor ordenado */
-static int index_of_user(User** arr, int n, int user_id) {
-    User* u = users_binary_search(arr, n, user_id);
-    if (!u) return -1;
-    for (int i = 0; i < n; i++) {
-        if (arr[i] == u) return i;
+        printf("Data inválida (use dd/mm/aaaa). Tente novamente.\n");
     }
-    return -1;
 }
-/* Estrutura auxiliar para mapear primeiro usuário por ISBN */
-typedef struct IsbnFirst {
-    long long isbn;
-    int first_idx;
-    struct IsbnFirst* next;
-} IsbnFirst;
-/* Busca ISBN no mapa */
-static IsbnFirst* map_find(IsbnFirst* m, long long isbn) {
-    for (IsbnFirst* cur = m; cur; cur = cur->next) {
-        if (cur->isbn == isbn) return cur;
-    }
-    return NULL;
+
+
+/* ---------- LISTAGENS ---------- */
+
+/* As linhas das listagens vão pelo buffer de saída (saida.h); cabeçalhos
+   e avisos continuam no printf, que é esvaziado antes das linhas */
+static OutBuf out;
+
+static OutBuf* list_begin(void) {
+    fflush(stdout);
+    return &out;
 }
 
-static void map_free(IsbnFirst* m) {
-    while (m) {
-        IsbnFirst* nx = m->next;
-        free(m);
-        m = nx;
-    }
+static void list_end(void) {
+    ob_flush(&out);
 }
 
-/* Constrói o DSU a partir do histórico de empréstimos */
-static int build_dsu_from_history(DSU* d, UserNode* users, LoanSystem* ls) {
-    int n = 0;
-    User** arr = users_build_sorted_array(users, &n);
-    if (!arr || n == 0) {
-        free(arr);
+/* "texto" entre aspas */
+static void out_quoted(OutBuf* o, const char* s) {
+    ob_char(o, '"');
+    ob_str(o, s);
+    ob_char(o, '"');
+}
+
+/* ---------- MENSAGENS (menu e lote) ---------- */
+
+/* 1 = removido */
+static int report_book_removed(BibStatus st, const BibResult* r) {
+    if (st == BIB_HAS_LOANS) {
+        printf("O livro tem %d exemplar(es) emprestado(s); aguarde as devoluções para remover.\n", r->loans);
         return 0;
     }
-
-    if (!dsu_init(d, n)) {
-        free(arr);
+    if (st != BIB_OK) {
+        printf("Não encontrado.\n");
         return 0;
     }
+    printf("Removido.\n");
+    if (r->dropped > 0) printf("Fila de espera do livro apagada (%d usuário(s)).\n", r->dropped);
+    return 1;
+}
 
-    IsbnFirst* map = NULL;
-
-    /* Percorre histórico e conecta usuários que pegaram o mesmo livro */
-    for (HistNode* h = ls->history; h; h = h->next) {
-        if (h->type != ACT_BORROW && h->type != ACT_AUTO_BORROW) continue;
-
-        int idx = index_of_user(arr, n, h->user_id);
-        if (idx < 0) continue;
+static int report_user_removed(BibStatus st, const BibResult* r) {
+    if (st == BIB_HAS_LOANS) {
+        printf("O usuário tem %d empréstimo(s) ativo(s); devolva antes de remover.\n", r->loans);
+        return 0;
+    }
+    if (st != BIB_OK) {
+        printf("Não encontrado.\n");
+        return 0;
+    }
+    printf("Removido.\n");
+    if (r->dropped > 0) printf("Saiu de %d fila(s) de espera.\n", r->dropped);
+    return 1;
+}
 
-        IsbnFirst* e = map_find(map, h->isbn);
-        if (!e) {
-            e = (IsbnFirst*)malloc(sizeof(IsbnFirst));
-            if (!e) break;
-            e->isbn = h->isbn;
-            e->first_idx = idx;
-            e->next = map;
-            map = e;
-        } else {
-            dsu_union(d, e->first_idx, idx);
-        }
+/* 1 = emprestado ou na fila */
+static int report_borrow(BibStatus st, const BibResult* r, int user_id, long long isbn) {
+    switch (st) {
+        case BIB_OK:
+            printf("Empréstimo realizado! user_id=%d | isbn=%I64d\n", user_id, (long long)isbn);
+            return 1;
+        case BIB_QUEUED:
+            printf("Sem exemplares disponíveis. Usuário entrou na fila. (isbn=%I64d | posição %d)\n",
+                   (long long)isbn, r->total);
+            return 1;
+        case BIB_ALREADY_QUEUED:
+            printf("Usuário já está na fila desse livro (posição %d de %d).\n", r->position, r->total);
+            return 0;
+        case BIB_ALREADY_BORROWED: printf("Esse usuário já tem esse livro emprestado.\n"); return 0;
+        case BIB_NO_USER:          printf("Usuário não encontrado.\n"); return 0;
+        default:                   printf("Livro não encontrado.\n"); return 0;
     }
+}
 
-    map_free(map);
-    free(arr);
+/* 1 = devolvido */
+static int report_return(BibStatus st, const BibResult* r, int user_id, long long isbn) {
+    if (st == BIB_NO_BOOK) {
+        printf("Livro não encontrado.\n");
+        return 0;
+    }
+    if (st != BIB_OK) {
+        printf("Empréstimo ativo não encontrado para esse usuário e ISBN.\n");
+        return 0;
+    }
+    printf("Devolução realizada! user_id=%d | isbn=%I64d\n", user_id, (long long)isbn);
+    if (r->next_state > 0) {
+        printf("Auto-empréstimo para o próximo da fila: user_id=%d | isbn=%I64d\n",
+               r->next_user, (long long)isbn);
+    } else if (r->next_state < 0) {
+        printf("Aviso: próximo da fila (user_id=%d) não existe mais. Ignorado.\n", r->next_user);
+    }
     return 1;
 }
 
+/* ---------- UI LIVROS ---------- */
 
-static void ui_add_book(BookNode** books, HashBooks* hb) {
+static void ui_add_book(Biblioteca* bib) {
     Book b;
     memset(&b, 0, sizeof(b));
 
     b.isbn = read_ll("ISBN (somente números): ");
-    if (hb_get(hb, b.isbn)) {
+    if (bib_find_book(bib, b.isbn)) {
         printf("Já existe livro com esse ISBN.\n");
         return;
     }
@@ -153,27 +203,49 @@ static void ui_add_book(BookNode** books, HashBooks* hb) {
     b.copies_available = b.copies_total;
     b.times_borrowed = 0;
 
-    books_push_front(books, &b);
-    hb_insert(hb, &(*books)->data);
-
+    bib_add_book(bib, &b);
     printf("Livro cadastrado!\n");
 }
 
-static void ui_remove_book(BookNode** books, HashBooks* hb) {
+static void ui_remove_book(Biblioteca* bib) {
     long long isbn = read_ll("ISBN para remover: ");
+    BibResult r;
+    report_book_removed(bib_remove_book(bib, isbn, &r), &r);
+}
 
-    if (books_remove(books, isbn)) {
-        hb_remove(hb, isbn);
-        printf("Removido.\n");
-    } else {
-        printf("Não encontrado.\n");
+static void print_books(BookNode* head) {
+    if (!head) {
+        printf("\n(Nenhum livro cadastrado)\n");
+        return;
+    }
+
+    printf("\n---- LISTA DE LIVROS ----\n");
+    OutBuf* o = list_begin();
+    for (BookNode* cur = head; cur; cur = cur->next) {
+        const Book* b = &cur->data;
+        ob_str(o, "ISBN: ");
+        ob_ll(o, b->isbn);
+        ob_str(o, " | ");
+        out_quoted(o, b->title);
+        ob_str(o, " | Autor: ");
+        ob_str(o, b->author);
+        ob_str(o, " | Ano: ");
+        ob_ll(o, b->year);
+        ob_str(o, " | Disp: ");
+        ob_ll(o, b->copies_available);
+        ob_char(o, '/');
+        ob_ll(o, b->copies_total);
+        ob_str(o, " | Emprest.: ");
+        ob_ll(o, b->times_borrowed);
+        ob_char(o, '\n');
     }
+    list_end();
 }
 
-static void ui_find_book_by_isbn_fast(HashBooks* hb) {
+static void ui_find_book_by_isbn_fast(Biblioteca* bib) {
     long long isbn = read_ll("ISBN para buscar (HASH): ");
 
-    Book* b = hb_get(hb, isbn);
+    const Book* b = bib_find_book(bib, isbn);
     if (!b) {
         printf("Não encontrado.\n");
     } else {
@@ -183,87 +255,281 @@ static void ui_find_book_by_isbn_fast(HashBooks* hb) {
     }
 }
 
-/* Busca em Texto (título/autor) */
-static void ui_text_search(BookNode* books, HashBooks* hb) {
-    char q[64];
-    read_line("Palavra para buscar (título/autor): ", q, sizeof(q));
-    if (q[0] == '\0') return;
-
-    TextIndex ti;
-    if (!ti_init(&ti, 1009)) {
-        printf("Erro ao criar índice de texto.\n");
+/* Avisa os índices que ficaram prontos desde a última volta do menu */
+/* Histórico do banco lido na primeira consulta: tamanho e velocidade */
+static void print_history_news(LoanSystem* ls) {
+    HistStats* hs = &ls->hist_stats;
+    if (!hs->news) return;
+    hs->news = 0;
+    if (hs->read_failed) {
+        printf("Aviso: histórico do banco ilegível; as consultas usam só os eventos desta sessão.\n");
         return;
     }
-    ti_build(&ti, books);
+    if (hs->events == 0 || hs->bytes == 0) return;
 
-    IsbnNode* hits = ti_find(&ti, q);
-    if (!hits) {
-        printf("Nenhum livro encontrado para \"%s\".\n", q);
-        ti_free(&ti);
-        return;
+    double raw = (double)hs->events * HIST_RAW_EVENT;
+    printf("Histórico: %ld eventos lidos do banco (%.1f KB, %.1fx menor que o formato antigo",
+           hs->events, (double)hs->bytes / 1024.0, raw / (double)hs->bytes);
+    if (hs->decode_secs > 0) printf(", decodificado a %.0f MB/s", raw / hs->decode_secs / 1e6);
+    printf(").\n");
+}
+
+/* O diário parou de gravar: avisa uma vez */
+static void check_journal(BibStatus st) {
+    static int warned;
+    if (st == BIB_IO_ERROR && !warned) {
+        warned = 1;
+        printf("Erro: falha ao gravar o diário; alterações novas não estão protegidas.\n");
     }
+}
+
+static void print_index_news(CatalogIndex* ci) {
+    int fresh = ci_poll(ci);
+    for (int k = 0; k < CI_N; k++) {
+        if (!(fresh & (1 << k))) continue;
+        if (k == CI_TEXT && ci->text_loaded) {
+            printf("Índice de texto lido de %s (%.3f s).\n", TEXT_INDEX_FILE, ci->secs[k]);
+        } else {
+            printf("Índice %s pronto (%.3f s).\n", ci_name(k), ci->secs[k]);
+        }
+    }
+}
+
+/* Busca em Texto (título/autor) */
+static void print_text_hit(OutBuf* o, const Book* b) {
+    ob_str(o, "- ");
+    ob_ll(o, b->isbn);
+    ob_str(o, " | ");
+    out_quoted(o, b->title);
+    ob_str(o, " | ");
+    ob_str(o, b->author);
+    ob_str(o, " | ");
+    ob_ll(o, b->year);
+    ob_str(o, " | emprest.: ");
+    ob_ll(o, b->times_borrowed);
+    ob_char(o, '\n');
+}
+
+static void ui_text_search(Biblioteca* bib) {
+    char q[64];
+    read_line("Palavra para buscar (título/autor): ", q, sizeof(q));
+    if (q[0] == '\0') return;
 
-    printf("\n---- RESULTADOS PARA \"%s\" ----\n", q);
+    TextIter it;
+    const Book* b;
     int count = 0;
-    for (IsbnNode* cur = hits; cur; cur = cur->next) {
-        Book* b = hb_get(hb, cur->isbn);
-        if (!b) continue;
-        printf("- %I64d | \"%s\" | %s | %d | emprest.: %d\n",
-               (long long)b->isbn, b->title, b->author, b->year, b->times_borrowed);
+    if (bib_text_search(bib, q, &it)) {
+        if (!it.hit) {
+            printf("Nenhum livro encontrado para \"%s\".\n", q);
+            return;
+        }
+        printf("\n---- RESULTADOS PARA \"%s\" ----\n", q);
+    } else {
+        /* índice ainda sendo refeito: varre a lista */
+        printf("\n---- RESULTADOS PARA \"%s\" (busca sequencial) ----\n", q);
+    }
+    OutBuf* o = list_begin();
+    while ((b = bib_text_next(&it)) != NULL) {
+        print_text_hit(o, b);
         count++;
     }
+    list_end();
     if (count == 0) printf("(Nenhum livro válido encontrado.)\n");
-
-    ti_free(&ti);
 }
 
 /* AVL apenas para ordenação (AVL é ABB balanceada) */
-static void ui_list_books_avl(BookNode* books) {
-    AVLNode* root = avl_build_from_list(books);
+static void ui_list_books_avl(Biblioteca* bib) {
+    AVLNode* root = bib_titles(bib);
     if (!root) {
         printf("Não há livros cadastrados.\n");
         return;
     }
 
     printf("\n---- LIVROS EM ORDEM ALFABÉTICA (AVL) ----\n");
-    avl_print_inorder(root);
-    avl_free(root);
+    OutBuf* o = list_begin();
+    AvlIter it;
+    Book* b;
+    avl_iter_init(&it, root);
+    while ((b = avl_iter_next(&it)) != NULL) {
+        ob_str(o, "ISBN ");
+        ob_ll(o, b->isbn);
+        ob_str(o, " | ");
+        out_quoted(o, b->title);
+        ob_str(o, " | ");
+        ob_str(o, b->author);
+        ob_str(o, " | ");
+        ob_ll(o, b->year);
+        ob_char(o, '\n');
+    }
+    list_end();
 }
 
 /* B+ para range por ISBN */
-static void ui_bptree_range(BookNode* books) {
+static void ui_bptree_range(Biblioteca* bib) {
     long long a = read_ll("ISBN início: ");
     long long b = read_ll("ISBN fim: ");
 
-    BPTree* bp = bpt_build_from_list(books);
-    bpt_print_range(bp, a, b);
-    bpt_free(bp);
+    BptIter it;
+    Book* bk;
+    int count = 0;
+    bpt_range(bib_isbns(bib), a, b, &it);
+    printf("\n---- ISBN no intervalo [%I64d, %I64d] ----\n", it.lo, it.hi);
+    OutBuf* o = list_begin();
+    while ((bk = bpt_range_next(&it)) != NULL) {
+        ob_ll(o, bk->isbn);
+        ob_str(o, " | ");
+        out_quoted(o, bk->title);
+        ob_str(o, " | ");
+        ob_str(o, bk->author);
+        ob_str(o, " | ");
+        ob_ll(o, bk->year);
+        ob_char(o, '\n');
+        count++;
+    }
+    list_end();
+    if (count == 0) printf("(nenhum)\n");
 }
 
-/* TOP livros (Fila de prioridade) */
-static void ui_top_books(BookNode* books) {
+/* TOP livros (ranking mantido a cada empréstimo, sem reconstruir) */
+static void ui_top_books(TopRank* rank) {
     int k = read_int("Mostrar TOP quantos? ");
     if (k <= 0) return;
 
-    BookHeap h;
-    if (!heap_init(&h, 32)) {
-        printf("Erro ao criar heap.\n");
+    if (rank->n == 0) {
+        printf("\n(Nenhum livro no ranking)\n");
+        return;
+    }
+    if (k > rank->n) k = rank->n;
+
+    RankItem** top = (RankItem**)malloc(sizeof(RankItem*) * (size_t)k);
+    if (!top) {
+        printf("Erro: sem memória.\n");
+        return;
+    }
+    int n = rank_top(rank, k, top);
+    printf("\n---- TOP %d LIVROS (MAIS EMPRESTADOS) ----\n", n);
+    OutBuf* o = list_begin();
+    for (int i = 0; i < n; i++) {
+        Book* bk = top[i]->book;
+        ob_ll_pad(o, i + 1, 2);
+        ob_str(o, ") ");
+        ob_ll(o, top[i]->isbn);
+        if (!bk) {
+            ob_str(o, " | emprest.: ");
+            ob_ll(o, top[i]->bucket->count);
+            ob_char(o, '\n');
+            continue;
+        }
+        ob_str(o, " | ");
+        out_quoted(o, bk->title);
+        ob_str(o, " | emprest.: ");
+        ob_ll(o, bk->times_borrowed);
+        ob_str(o, " | disp: ");
+        ob_ll(o, bk->copies_available);
+        ob_char(o, '/');
+        ob_ll(o, bk->copies_total);
+        ob_char(o, '\n');
+    }
+    list_end();
+    free(top);
+}
+
+/* Livros em alta: janelas de 7 e 30 dias e pontuação com decaimento */
+static void print_trend(Trending* tr, HashBooks* hb, TrendWindow w, int k, long long now, const char* title) {
+    TrendEntry* out = (TrendEntry*)malloc(sizeof(TrendEntry) * (size_t)k);
+    if (!out) {
+        printf("Erro: sem memória.\n");
         return;
     }
 
-    heap_build_from_list(&h, books);
-    heap_print_top(&h, k);
-    heap_free(&h);
+    int n = trend_top(tr, w, k, now, out);
+    printf("\n---- %s ----\n", title);
+    if (n == 0) printf("(nenhum empréstimo no período)\n");
+    for (int i = 0; i < n; i++) {
+        Book* b = hb_get(hb, out[i].isbn);
+        printf("%2d) %I64d | \"%s\" | emprest.: %d | pontuação: %.2f\n",
+               i + 1, (long long)out[i].isbn, b ? b->title : "(removido)",
+               out[i].count, out[i].score);
+    }
+    free(out);
+}
+
+static void ui_trending(LoanSystem* ls, Trending* tr, HashBooks* hb) {
+    int k = read_int("Mostrar TOP quantos? ");
+    if (k <= 0) return;
+
+    /* o motor só conhece os eventos antigos depois que o histórico é lido */
+    ls_history_ready(ls);
+
+    long long now = (long long)time(NULL);
+    trend_advance(tr, now);
+
+    print_trend(tr, hb, TREND_WEEK, k, now, "EM ALTA NA SEMANA (7 DIAS)");
+    print_trend(tr, hb, TREND_MONTH, k, now, "EM ALTA NO MÊS (30 DIAS)");
+    print_trend(tr, hb, TREND_DECAY, k, now, "EM ALTA COM DECAIMENTO (MEIA-VIDA 7 DIAS)");
+}
+
+/* Esboços: mais populares e distintos estimados com memória fixa */
+static void ui_sketches(Analytics* an, HashBooks* hb) {
+    HeavyHitter top[HH_CAP];
+
+    printf("\n---- ESTIMATIVAS (COUNT-MIN / HYPERLOGLOG) ----\n");
+    printf("Eventos: %llu | Memória: %zu KB\n",
+           (unsigned long long)an->events, an_memory() / 1024);
+    printf("Usuários distintos ~%.0f | Livros distintos ~%.0f\n",
+           an_total_users(an), an_total_books(an));
+
+    int n = an_heavy(&an->top_books, 10, top);
+    printf("\nLivros mais emprestados (estimativa):\n");
+    if (n == 0) printf("(nenhum)\n");
+    for (int i = 0; i < n; i++) {
+        Book* b = hb_get(hb, top[i].id);
+        printf("%2d) %I64d | \"%s\" | ~%u emprest. | ~%.0f leitores\n",
+               i + 1, (long long)top[i].id, b ? b->title : "(fora do catálogo)",
+               top[i].est, an_book_readers(an, top[i].id));
+    }
+
+    n = an_heavy(&an->top_authors, 10, top);
+    printf("\nAutores mais emprestados (estimativa):\n");
+    if (n == 0) printf("(nenhum)\n");
+    for (int i = 0; i < n; i++) {
+        printf("%2d) %s | ~%u emprest.\n", i + 1, top[i].label, top[i].est);
+    }
+
+    long long isbn = read_ll("\nISBN para consultar (0 = pular): ");
+    if (isbn != 0) {
+        printf("ISBN %I64d: ~%u empréstimos | ~%.0f leitores distintos\n",
+               (long long)isbn, an_book_borrows(an, isbn), an_book_readers(an, isbn));
+    }
+    int id = read_int("ID de usuário para consultar (0 = pular): ");
+    if (id != 0) {
+        printf("Usuário %d: ~%.0f livros distintos\n", id, an_user_books(an, id));
+    }
+}
+
+/* Mescla esboços exportados por outra filial (mesmos parâmetros) */
+static void ui_sketch_merge(Biblioteca* bib) {
+    char path[256];
+    read_line("Arquivo de esboços da outra filial: ", path, sizeof(path));
+    if (path[0] == '\0') return;
+
+    BibStatus st = bib_sketch_import(bib, path);
+    if (st == BIB_CORRUPT) {
+        printf("Arquivo inválido ou com parâmetros diferentes.\n");
+        return;
+    }
+    printf("Esboços mesclados (%llu eventos no total).\n", (unsigned long long)bib->sk.view.events);
+    if (st != BIB_OK) printf("Aviso: não foi possível gravar %s agora; vai no próximo checkpoint.\n", SKETCH_FILE);
 }
 
 /* ---------- UI USUÁRIOS ---------- */
 
-static void ui_add_user(UserNode** users) {
+static void ui_add_user(Biblioteca* bib) {
     User u;
     memset(&u, 0, sizeof(u));
 
     u.id = read_int("ID do usuário: ");
-    if (users_find_by_id(*users, u.id)) {
+    if (users_find_by_id(bib->users, u.id)) {
         printf("Já existe usuário com esse ID.\n");
         return;
     }
@@ -271,112 +537,556 @@ static void ui_add_user(UserNode** users) {
     read_line("Nome: ", u.name, sizeof(u.name));
     read_line("Email: ", u.email, sizeof(u.email));
 
-    users_push_front(users, &u);
+    bib_add_user(bib, &u);
     printf("Usuário cadastrado!\n");
 }
 
-static void ui_remove_user(UserNode** users) {
+static void ui_remove_user(Biblioteca* bib) {
     int id = read_int("ID para remover: ");
-    if (users_remove(users, id)) printf("Removido.\n");
-    else printf("Não encontrado.\n");
+    BibResult r;
+    report_user_removed(bib_remove_user(bib, id, &r), &r);
 }
 
-static void ui_find_user(UserNode* users) {
+static void print_users(UserNode* head) {
+    if (!head) {
+        printf("\n(Nenhum usuário cadastrado)\n");
+        return;
+    }
+
+    printf("\n---- LISTA DE USUÁRIOS ----\n");
+    OutBuf* o = list_begin();
+    for (UserNode* cur = head; cur; cur = cur->next) {
+        ob_str(o, "ID: ");
+        ob_ll(o, cur->data.id);
+        ob_str(o, " | Nome: ");
+        ob_str(o, cur->data.name);
+        ob_str(o, " | Email: ");
+        ob_str(o, cur->data.email);
+        ob_char(o, '\n');
+    }
+    list_end();
+}
+
+static void ui_find_user(Biblioteca* bib) {
     int id = read_int("ID para buscar (binária): ");
 
-    int n = 0;
-    User** arr = users_build_sorted_array(users, &n);
-    if (!arr || n == 0) {
+    if (!bib->users) {
         printf("Não há usuários cadastrados.\n");
-        free(arr);
         return;
     }
 
-    User* u = users_binary_search(arr, n, id);
+    const User* u = bib_find_user(bib, id);
     if (!u) {
         printf("Não encontrado.\n");
     } else {
         printf("Encontrado: ID %d | Nome: %s | Email: %s\n", u->id, u->name, u->email);
     }
-
-    free(arr);
 }
 
 /* ---------- UI EMPRÉSTIMOS ---------- */
 
-static void ui_borrow(LoanSystem* ls, UserNode* users, BookNode* books) {
+static void ui_borrow(Biblioteca* bib) {
     int user_id = read_int("ID do usuário: ");
     long long isbn = read_ll("ISBN do livro: ");
-    ls_borrow(ls, users, books, user_id, isbn);
+    BibResult r;
+    report_borrow(bib_borrow(bib, user_id, isbn, &r), &r, user_id, isbn);
 }
 
-static void ui_return(LoanSystem* ls, UserNode* users, BookNode* books) {
+static void ui_return(Biblioteca* bib) {
     int user_id = read_int("ID do usuário: ");
     long long isbn = read_ll("ISBN do livro: ");
-    ls_return(ls, users, books, user_id, isbn);
+    BibResult r;
+    report_return(bib_return(bib, user_id, isbn, &r), &r, user_id, isbn);
 }
 
-/* ---------- UI DSU (Comunidades) ---------- */
+static void print_loans(LoanSystem* ls) {
+    if (!ls->loans) {
+        printf("\n(Nenhum empréstimo ativo)\n");
+        return;
+    }
 
-static void ui_dsu_same(UserNode* users, LoanSystem* ls) {
-    int a = read_int("User A (ID): ");
-    int b = read_int("User B (ID): ");
+    printf("\n---- EMPRÉSTIMOS ATIVOS ----\n");
+    OutBuf* o = list_begin();
+    for (LoanNode* cur = ls->loans; cur; cur = cur->next) {
+        ob_str(o, "user_id=");
+        ob_ll(o, cur->user_id);
+        ob_str(o, " | isbn=");
+        ob_ll(o, cur->isbn);
+        ob_char(o, '\n');
+    }
+    list_end();
+}
 
-    DSU d;
-    if (!build_dsu_from_history(&d, users, ls)) {
-        printf("Não foi possível construir DSU (sem usuários/histórico).\n");
+static void print_waits(LoanSystem* ls) {
+    if (!ls->waits) {
+        printf("\n(Nenhuma fila de espera)\n");
         return;
     }
 
-    int n = 0;
-    User** arr = users_build_sorted_array(users, &n);
-    if (!arr || n == 0) {
-        free(arr);
-        dsu_free(&d);
-        printf("Sem usuários.\n");
+    printf("\n---- FILAS DE ESPERA ----\n");
+    OutBuf* o = list_begin();
+    for (WaitList* w = ls->waits; w; w = w->next) {
+        ob_str(o, "ISBN ");
+        ob_ll(o, w->isbn);
+        ob_str(o, ": ");
+        for (WaitNode* n = w->front; n; n = n->next) {
+            ob_ll(o, n->user_id);
+            ob_char(o, ' ');
+        }
+        ob_char(o, '\n');
+    }
+    list_end();
+}
+
+static void print_event(OutBuf* o, const HistEvent* e) {
+    /* localtime só quando o minuto muda: eventos vizinhos costumam cair
+       no mesmo minuto */
+    static long long last_min = -1;
+    static char when[32];
+    if (e->ts <= 0) {
+        last_min = -1;
+        strcpy(when, "sem data");
+    } else if (e->ts / 60 != last_min) {
+        time_t tt = (time_t)e->ts;
+        struct tm* tmv = localtime(&tt);
+        if (tmv) strftime(when, sizeof(when), "%d/%m/%Y %H:%M", tmv);
+        else strcpy(when, "sem data");
+        last_min = e->ts / 60;
+    }
+    ob_str(o, ls_action_name(e->type));
+    ob_str(o, " | user_id=");
+    ob_ll(o, e->user_id);
+    ob_str(o, " | isbn=");
+    ob_ll(o, e->isbn);
+    ob_str(o, " | ");
+    ob_str(o, when);
+    ob_char(o, '\n');
+}
+
+/* Histórico inteiro (mais recente primeiro) */
+static void print_history(LoanSystem* ls) {
+    ls_history_ready(ls);
+    if (hl_size(&ls->history) == 0) {
+        printf("\n(Histórico vazio)\n");
         return;
     }
 
-    int ia = index_of_user(arr, n, a);
-    int ib = index_of_user(arr, n, b);
+    printf("\n---- HISTÓRICO (TOPO = MAIS RECENTE) ----\n");
+    HistIter it;
+    HistEvent e;
+    OutBuf* o = list_begin();
+    hl_iter_backward(&it, &ls->history);
+    while (hl_next(&it, &e)) print_event(o, &e);
+    list_end();
+}
 
-    if (ia < 0 || ib < 0) {
-        printf("Um dos usuários não existe.\n");
+/* Empréstimos ativos de um usuário (lista do próprio usuário, sem varrer todos) */
+static void ui_user_loans(LoanSystem* ls, HashBooks* hb) {
+    int user_id = read_int("ID do usuário: ");
+    int count = 0;
+    const LoanNode* n = ls_loans_of_user(ls, user_id, &count);
+
+    printf("\n---- EMPRÉSTIMOS DO USUÁRIO %d (%d) ----\n", user_id, count);
+    if (!n) printf("(nenhum empréstimo ativo)\n");
+    OutBuf* o = list_begin();
+    for (; n; n = n->u_next) {
+        Book* b = hb_get(hb, n->isbn);
+        ob_str(o, "isbn=");
+        ob_ll(o, n->isbn);
+        ob_str(o, " | ");
+        out_quoted(o, b ? b->title : "(removido)");
+        ob_char(o, '\n');
+    }
+    list_end();
+}
+
+/* Quem está com um ISBN agora */
+static void ui_book_holders(LoanSystem* ls) {
+    long long isbn = read_ll("ISBN do livro: ");
+    int count = 0;
+    const LoanNode* n = ls_holders_of_book(ls, isbn, &count);
+
+    printf("\n---- COM O ISBN %I64d (%d) ----\n", (long long)isbn, count);
+    if (!n) printf("(ninguém)\n");
+    OutBuf* o = list_begin();
+    for (; n; n = n->b_next) {
+        ob_str(o, "user_id=");
+        ob_ll(o, n->user_id);
+        ob_char(o, '\n');
+    }
+    list_end();
+}
+
+/* Posição de um usuário na fila de espera de um livro */
+static void ui_wait_position(LoanSystem* ls) {
+    int user_id = read_int("ID do usuário: ");
+    long long isbn = read_ll("ISBN do livro: ");
+
+    int total = 0;
+    int pos = ls_wait_position(ls, user_id, isbn, &total);
+    if (pos == 0) {
+        printf("Usuário %d não está na fila do ISBN %I64d.\n", user_id, (long long)isbn);
     } else {
-        printf("Conectados (mesma comunidade)? %s\n", dsu_same(&d, ia, ib) ? "SIM" : "NÃO");
+        printf("Posição na fila: %d de %d\n", pos, total);
+    }
+}
+
+/* Consultas ao histórico pelos índices (usuário, livro, período) */
+static void print_positions(LoanSystem* ls, const HistPos* pos, long n) {
+    if (n == 0) {
+        printf("(nenhum evento)\n");
+        return;
     }
+    OutBuf* o = list_begin();
+    for (long i = 0; i < n; i++) {
+        HistEvent e;
+        hl_get(&ls->history, (long)pos[i], &e);
+        print_event(o, &e);
+    }
+    list_end();
+    printf("(%ld evento(s))\n", n);
+}
+
+static void read_period(long long* from, long long* to) {
+    *from = read_date("Data inicial (dd/mm/aaaa, vazio = desde o início): ", 0);
+    *to = read_date("Data final (dd/mm/aaaa, vazio = até hoje): ", 1);
+    if (*from < 0) *from = 0;
+    if (*to < 0) *to = LLONG_MAX;
+}
 
-    free(arr);
-    dsu_free(&d);
+static void ui_history_user(LoanSystem* ls) {
+    int user_id = read_int("ID do usuário: ");
+    long long from, to;
+    read_period(&from, &to);
+
+    const HistPos* pos = NULL;
+    long n = ls_history_of_user(ls, user_id, from, to, &pos);
+    printf("\n---- HISTÓRICO DO USUÁRIO %d ----\n", user_id);
+    print_positions(ls, pos, n);
+}
+
+static void ui_history_book(LoanSystem* ls) {
+    long long isbn = read_ll("ISBN do livro: ");
+    long long from, to;
+    read_period(&from, &to);
+
+    const HistPos* pos = NULL;
+    long n = ls_history_of_book(ls, isbn, from, to, &pos);
+    printf("\n---- HISTÓRICO DO ISBN %I64d ----\n", (long long)isbn);
+    print_positions(ls, pos, n);
+}
+
+static void ui_history_period(LoanSystem* ls) {
+    long long from, to;
+    read_period(&from, &to);
+
+    const HistPos* pos = NULL;
+    long n = ls_history_between(ls, from, to, &pos);
+    printf("\n---- HISTÓRICO NO PERÍODO ----\n");
+    print_positions(ls, pos, n);
+}
+
+/* "Quem pegou este também pegou" */
+static void ui_related(LoanSystem* ls, HashBooks* hb) {
+    long long isbn = read_ll("ISBN do livro: ");
+    int k = read_int("Mostrar quantos (máx. 10)? ");
+    if (k <= 0) return;
+    if (k > REC_TOPN) k = REC_TOPN;
+
+    RelatedBook out[REC_TOPN];
+    int n = ls_related(ls, isbn, out, k);
+
+    Book* b = hb_get(hb, isbn);
+    printf("\n---- QUEM PEGOU \"%s\" TAMBÉM PEGOU ----\n", b ? b->title : "(desconhecido)");
+    if (n == 0) printf("(nenhum outro livro em comum)\n");
+    for (int i = 0; i < n; i++) {
+        Book* o = hb_get(hb, out[i].isbn);
+        printf("%2d) %I64d | \"%s\" | leitores em comum: %d\n",
+               i + 1, (long long)out[i].isbn, o ? o->title : "(removido)", out[i].score);
+    }
+}
+
+/* ---------- UI DSU (Comunidades) ---------- */
+
+static void ui_dsu_same(UserNode* users, LoanSystem* ls) {
+    int a = read_int("User A (ID): ");
+    int b = read_int("User B (ID): ");
+
+    int r = ls_comm_same(ls, users, a, b);
+    if (r < 0) {
+        printf("Um dos usuários não existe.\n");
+    } else {
+        printf("Conectados (mesma comunidade)? %s\n", r ? "SIM" : "NÃO");
+    }
 }
 
 static void ui_dsu_size(UserNode* users, LoanSystem* ls) {
     int a = read_int("User (ID): ");
 
-    DSU d;
-    if (!build_dsu_from_history(&d, users, ls)) {
-        printf("Não foi possível construir DSU (sem usuários/histórico).\n");
+    int sz = ls_comm_size(ls, users, a);
+    if (sz < 0) {
+        printf("Usuário não existe.\n");
+    } else {
+        printf("Tamanho da comunidade do usuário %d: %d\n", a, sz);
+    }
+}
+
+/* Maiores comunidades, com os membros de cada uma */
+static void ui_dsu_top(UserNode* users, LoanSystem* ls) {
+    int k = read_int("Mostrar quantas comunidades? ");
+    if (k <= 0) return;
+
+    DSUGroups g;
+    if (!ls_comm_groups(ls, users, &g)) {
+        printf("Erro: sem memória.\n");
+        return;
+    }
+    if (g.ngroups == 0) {
+        printf("\n(Nenhuma comunidade: histórico sem empréstimos)\n");
+        dsu_groups_free(&g);
         return;
     }
+    if (k > g.ngroups) k = g.ngroups;
+
+    printf("\n---- %d MAIORES COMUNIDADES (de %d) ----\n", k, g.ngroups);
+    for (int i = 0; i < k; i++) {
+        int size = g.start[i + 1] - g.start[i];
+        printf("%2d) %d usuário(s): ", i + 1, size);
+        int shown = 0;
+        for (int j = g.start[i]; j < g.start[i + 1] && shown < 20; j++, shown++) {
+            printf("%d ", ls->comm.user_of[g.members[j]]);
+        }
+        if (size > shown) printf("... (+%d)", size - shown);
+        printf("\n");
+    }
+    dsu_groups_free(&g);
+}
 
-    int n = 0;
-    User** arr = users_build_sorted_array(users, &n);
-    if (!arr || n == 0) {
-        free(arr);
-        dsu_free(&d);
-        printf("Sem usuários.\n");
+/* Distribuição dos tamanhos das comunidades */
+static void ui_dsu_histogram(UserNode* users, LoanSystem* ls) {
+    int max = 0;
+    int* hist = ls_comm_histogram(ls, users, &max);
+    if (!hist) {
+        printf("Erro: sem memória.\n");
         return;
     }
 
-    int ia = index_of_user(arr, n, a);
-    if (ia < 0) {
-        printf("Usuário não existe.\n");
+    printf("\n---- TAMANHO DAS COMUNIDADES ----\n");
+    int any = 0;
+    for (int s = 1; s <= max; s++) {
+        if (hist[s] == 0) continue;
+        printf("tamanho %d: %d comunidade(s)\n", s, hist[s]);
+        any = 1;
+    }
+    if (!any) printf("(sem usuários)\n");
+    free(hist);
+}
+
+/* Junta o histórico de outra filial e refaz as comunidades em paralelo */
+static void ui_import_history(UserNode* users, LoanSystem* ls) {
+    char path[256];
+    read_line("Arquivo de histórico da outra filial: ", path, sizeof(path));
+    if (path[0] == '\0') return;
+
+    int nthreads = cdsu_default_threads();
+    clock_t t0 = clock();
+    long n = ls_import_history(ls, users, path, nthreads);
+    if (n < 0) {
+        printf("Erro ao abrir %s.\n", path);
+        return;
+    }
+    double secs = (double)(clock() - t0) / CLOCKS_PER_SEC;
+    printf("%ld eventos importados; comunidades refeitas com %d thread(s) em %.3f s.\n",
+           n, nthreads, secs);
+}
+
+/* ---------- ARQUIVOS ---------- */
+
+/* Grava agora, esperando terminar (saída) */
+static void save_all(Biblioteca* bib) {
+    BibSaveInfo info;
+    if (bib_save(bib, &info) == BIB_OK) {
+        printf("Livros, usuários, empréstimos, filas e histórico salvos em %s (%.3f s).\n",
+               BANCO_FILE, info.secs);
     } else {
-        printf("Tamanho da comunidade do usuário %d: %d\n", a, dsu_size(&d, ia));
+        printf("Aviso: checkpoint falhou; o diário continua valendo.\n");
+    }
+    if (info.sketches) printf("Esboços salvos em %s.\n", SKETCH_FILE);
+    if (info.text_index) printf("Índice de texto salvo em %s.\n", TEXT_INDEX_FILE);
+}
+
+/* Catálogo para um arquivo de texto (uma linha por livro) */
+static void ui_export_books(Biblioteca* bib) {
+    char path[256];
+    read_line("Arquivo de saída: ", path, sizeof(path));
+    if (path[0] == '\0') return;
+
+    struct timespec t0, t1;
+    long n = 0;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    BibStatus st = bib_export_books(bib, path, &n);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    if (st != BIB_OK) {
+        printf("Erro ao gravar %s.\n", path);
+        return;
+    }
+    printf("%ld livro(s) exportados para %s em %.3f s.\n", n, path,
+           (double)(t1.tv_sec - t0.tv_sec) + (double)(t1.tv_nsec - t0.tv_nsec) / 1e9);
+}
+
+/* Salvar pelo menu: tira a foto e volta na hora; o laço principal avisa
+   quando terminar. Se já houver um gravando, este fica na fila. */
+static void save_async(Biblioteca* bib) {
+    BibSaveInfo info;
+    BibStatus st = bib_save_async(bib, &info);
+    if (st == BIB_QUEUED) {
+        printf("Checkpoint em andamento; a gravação começa assim que ele terminar.\n");
+    } else if (st == BIB_OK) {
+        printf("Gravando em segundo plano (foto em %.1f ms); o sistema continua disponível.\n",
+               info.secs * 1000.0);
+    } else {
+        printf("Erro ao iniciar o checkpoint.\n");
+    }
+    if (info.text_index) printf("Índice de texto salvo em %s.\n", TEXT_INDEX_FILE);
+}
+
+/* ---------- LOTE ---------- */
+
+/* Modo lote (--lote arquivo, ou - para a entrada padrão): um comando por
+   linha, sem menu e com a saída em buffer.
+     E usuario isbn                 empréstimo
+     D usuario isbn                 devolução
+     L isbn ano qtd título|autor    cadastra livro
+     R isbn                         remove livro
+     U id nome|email                cadastra usuário
+     X id                           remove usuário
+     B isbn                         busca pelo ISBN
+   Linhas vazias ou começadas por # são puladas. */
+typedef struct {
+    FILE* in;
+    long line;
+    long ops;
+    long errors;
+    struct timespec t0;
+} Batch;
+
+static char batch_out[1 << 16];
+
+static int batch_open(Batch* bt, const char* path) {
+    memset(bt, 0, sizeof(*bt));
+    bt->in = strcmp(path, "-") == 0 ? stdin : fopen(path, "r");
+    if (!bt->in) {
+        printf("Erro ao abrir %s.\n", path);
+        return 0;
+    }
+    /* sem terminal do outro lado: a saída vai em blocos grandes */
+    setvbuf(stdout, batch_out, _IOFBF, sizeof(batch_out));
+    return 1;
+}
+
+/* Separa "a|b" em dois campos (b vazio se não houver |) */
+static void split_pair(const char* s, char* a, size_t a_sz, char* b, size_t b_sz) {
+    const char* bar = strchr(s, '|');
+    size_t la = bar ? (size_t)(bar - s) : strlen(s);
+    if (la >= a_sz) la = a_sz - 1;
+    memcpy(a, s, la);
+    a[la] = '\0';
+    snprintf(b, b_sz, "%s", bar ? bar + 1 : "");
+}
+
+/* Executa um comando; 0 = a entrada acabou */
+static int batch_step(Batch* bt, Biblioteca* bib) {
+    char line[512];
+    if (!fgets(line, sizeof(line), bt->in)) return 0;
+    trim_newline(line);
+    bt->line++;
+    if (line[0] == '\0' || line[0] == '#') return 1;
+    if (bt->ops == 0) clock_gettime(CLOCK_MONOTONIC, &bt->t0);
+    bt->ops++;
+
+    char cmd = line[0];
+    const char* args = line + 1;
+    long long isbn;
+    int id, n = 0, ok = 0;
+    BibResult r;
+
+    switch (cmd) {
+        case 'E':
+        case 'D':
+            if (sscanf(args, "%d %lld", &id, &isbn) != 2) break;
+            if (cmd == 'E') ok = report_borrow(bib_borrow(bib, id, isbn, &r), &r, id, isbn);
+            else ok = report_return(bib_return(bib, id, isbn, &r), &r, id, isbn);
+            bt->errors += !ok;
+            return 1;
+
+        case 'L': {
+            Book b;
+            memset(&b, 0, sizeof(b));
+            if (sscanf(args, "%lld %d %d %n", &b.isbn, &b.year, &b.copies_total, &n) != 3) break;
+            split_pair(args + n, b.title, sizeof(b.title), b.author, sizeof(b.author));
+            if (b.copies_total < 0) b.copies_total = 0;
+            b.copies_available = b.copies_total;
+            ok = bib_add_book(bib, &b) == BIB_OK;
+            if (!ok) printf("Linha %ld: já existe livro com ISBN %I64d.\n", bt->line, (long long)b.isbn);
+            bt->errors += !ok;
+            return 1;
+        }
+
+        case 'R':
+            if (sscanf(args, "%lld", &isbn) != 1) break;
+            bt->errors += !report_book_removed(bib_remove_book(bib, isbn, &r), &r);
+            return 1;
+
+        case 'U': {
+            User u;
+            memset(&u, 0, sizeof(u));
+            if (sscanf(args, "%d %n", &u.id, &n) != 1) break;
+            split_pair(args + n, u.name, sizeof(u.name), u.email, sizeof(u.email));
+            ok = bib_add_user(bib, &u) == BIB_OK;
+            if (!ok) printf("Linha %ld: já existe usuário com ID %d.\n", bt->line, u.id);
+            bt->errors += !ok;
+            return 1;
+        }
+
+        case 'X':
+            if (sscanf(args, "%d", &id) != 1) break;
+            bt->errors += !report_user_removed(bib_remove_user(bib, id, &r), &r);
+            return 1;
+
+        case 'B': {
+            if (sscanf(args, "%lld", &isbn) != 1) break;
+            const Book* b = bib_find_book(bib, isbn);
+            if (b) {
+                printf("%I64d | \"%s\" | %s | %d | Disp: %d/%d\n", (long long)b->isbn,
+                       b->title, b->author, b->year, b->copies_available, b->copies_total);
+            } else {
+                printf("Linha %ld: ISBN %I64d não encontrado.\n", bt->line, (long long)isbn);
+                bt->errors++;
+            }
+            return 1;
+        }
     }
 
-    free(arr);
-    dsu_free(&d);
+    if (!ok) {
+        printf("Linha %ld: comando inválido: %s\n", bt->line, line);
+        bt->errors++;
+    }
+    return 1;
+}
+
+/* Espera o diário confirmar tudo e mostra o resumo */
+static void batch_finish(Batch* bt, Biblioteca* bib) {
+    check_journal(bib_sync(bib));
+    struct timespec t1;
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    double secs = bt->ops ? (double)(t1.tv_sec - bt->t0.tv_sec) +
+                            (double)(t1.tv_nsec - bt->t0.tv_nsec) / 1e9 : 0.0;
+
+    printf("\nLote: %ld comando(s) em %.3f s", bt->ops, secs);
+    if (secs > 0) printf(" (%.0f ops/s)", (double)bt->ops / secs);
+    printf("; %ld com erro.\n", bt->errors);
+    if (bt->in != stdin) fclose(bt->in);
+    bt->in = NULL;
 }
 
 /* ---------- MENU ---------- */
@@ -391,7 +1101,10 @@ static void show_menu(void) {
     printf("4) Buscar livros por titulo/autor (Busca em Texto)\n");
     printf("5) Listar livros em ordem alfabética (AVL = ABB balanceada)\n");
     printf("6) Listar livros por intervalo de ISBN (Árvore B+)\n");
-    printf("7) TOP livros mais emprestados (HEAP)\n");
+    printf("7) TOP livros mais emprestados (ranking)\n");
+    printf("21) Livros em alta (7/30 dias)\n");
+    printf("22) Estimativas de popularidade e leitores distintos (esboços)\n");
+    printf("23) Mesclar esboços de outra filial\n");
     printf("8) Remover livro\n");
 
     printf("\n-- USUÁRIOS --\n");
@@ -406,84 +1119,177 @@ static void show_menu(void) {
     printf("15) Listar empréstimos ativos\n");
     printf("16) Mostrar filas de espera\n");
     printf("17) Mostrar histórico (pilha)\n");
+    printf("27) Quem pegou este também pegou\n");
+    printf("28) Empréstimos ativos de um usuário\n");
+    printf("29) Quem está com um livro\n");
+    printf("30) Posição na fila de espera\n");
+    printf("31) Histórico de um usuário (por período)\n");
+    printf("32) Histórico de um livro (por período)\n");
+    printf("33) Histórico por período\n");
 
     printf("\n-- ARQUIVOS --\n");
     printf("18) Salvar (tudo)\n");
+    printf("34) Exportar livros para arquivo de texto\n");
 
     printf("\n-- COMUNIDADES (DSU) --\n");
     printf("19) Verificar se 2 usuários estão conectados\n");
     printf("20) Tamanho da comunidade de um usuário\n");
+    printf("24) Maiores comunidades (com membros)\n");
+    printf("25) Distribuição dos tamanhos das comunidades\n");
+    printf("26) Importar histórico de outra filial\n");
 
     printf("\n0) Sair\n");
 }
 
-int main(void) {
-    BookNode* books = books_load();
-    UserNode* users = users_load();
-
-    LoanSystem ls;
-    ls_init(&ls);
-    ls_load(&ls);
-
-    HashBooks hb;
-    if (!hb_init(&hb, 997)) {
-        printf("Erro ao criar tabela hash.\n");
+int main(int argc, char** argv) {
+    Batch batch;
+    memset(&batch, 0, sizeof(batch));
+    const char* serve_addr = NULL;
+    if (argc == 3 && strcmp(argv[1], "--lote") == 0) {
+        if (!batch_open(&batch, argv[2])) return 1;
+    } else if (argc == 3 && strcmp(argv[1], "--servidor") == 0) {
+        serve_addr = argv[2];
+    } else if (argc != 1) {
+        printf("Uso: %s [--lote arquivo|-] [--servidor unix:/caminho|[host:]porta]\n", argv[0]);
         return 1;
     }
-    hb_build_from_list(&hb, books);
 
-    printf("Arquivos carregados. (%s, %s, emprestimos.dat, filas.dat, historico.dat)\n",
-           BOOKS_FILE, USERS_FILE);
+    /* o estado fica no motor; daqui para baixo é só ler, chamar e mostrar */
+    static Biblioteca bib;
+    ob_open(&out, plat_fileno(stdout), OUT_BUF_SIZE);
+    BibStatus st = bib_open(&bib);
+    if (st == BIB_CORRUPT) {
+        printf("Erro: %s corrompido.\n", BANCO_FILE);
+        return 1;
+    }
+    if (st != BIB_OK) {
+        printf("Erro ao criar %s.\n", BANCO_FILE);
+        return 1;
+    }
+    /* o motor não escreve na tela: o que a abertura achou é mostrado aqui */
+    HistStats* hs = &bib.ls.hist_stats;
+    if (bib.db.bad_tables > 0) {
+        printf("Aviso: %u tabela(s) de %s com registro de tamanho inesperado (ignoradas).\n",
+               bib.db.bad_tables, BANCO_FILE);
+    }
+    if (bib.db.bad_pages > 0) {
+        printf("Aviso: %u página(s) corrompida(s) em %s (o resto da tabela foi ignorado).\n",
+               bib.db.bad_pages, BANCO_FILE);
+    }
+    if (hs->bad_index) printf("Aviso: índice do histórico estragado; histórico ignorado.\n");
+    if (hs->bad_tail) printf("Aviso: último bloco do histórico estragado (ignorado).\n");
+    if (hs->lazy) {
+        printf("Histórico: %ld eventos (%.1f KB) no banco; lido quando for consultado.\n",
+               hs->events, (double)hs->bytes / 1024.0);
+    }
+    print_history_news(&bib.ls);
+    if (bib.journal_torn > 0) {
+        printf("Aviso: diário tinha %lld byte(s) incompletos no fim (descartados).\n", bib.journal_torn);
+    }
+    if (bib.replayed > 0) printf("Diário: %ld alteração(ões) recuperadas.\n", bib.replayed);
+    if (bib.sketches_reset) {
+        printf("Aviso: %s ilegível; esboços refeitos só com o histórico local "
+               "(mescle de novo os de outras filiais).\n", SKETCH_FILE);
+    }
+    if (!bib.journal_ok) {
+        printf("Aviso: não foi possível abrir o diário; alterações só serão gravadas ao salvar.\n");
+    }
+    if (!bib.migrated) printf("Arquivos carregados. (%s)\n", BANCO_FILE);
+    else printf("Arquivos carregados. (%s, %s, emprestimos.dat, filas.dat, historico.dat -> %s)\n",
+                BOOKS_FILE, USERS_FILE, BANCO_FILE);
+
+    /* o lote altera o catálogo desde o primeiro comando */
+    if (batch.in) ci_settle(&bib.ci);
+
+    /* servidor: atende até SIGINT/SIGTERM e sai gravando, como a opção 0 */
+    if (serve_addr) {
+        ci_settle(&bib.ci);
+        int served = srv_run(&bib, serve_addr);
+        save_all(&bib);
+        bib_close(&bib);
+        ob_close(&out);
+        printf("Saindo.\n");
+        return served ? 0 : 1;
+    }
 
     while (1) {
-        show_menu();
-        int op = read_int("Escolha: ");
+        /* a operação anterior só é confirmada depois de ir para o disco
+           (no lote, só no fim: o diário junta tudo em poucas gravações) */
+        if (!batch.in) check_journal(bib_sync(&bib));
+
+        /* checkpoint em segundo plano quando o diário cresce ou o tempo passa;
+           o fim de uma gravação pedida na opção 18 é avisado aqui */
+        BibSaveInfo saved;
+        BibStatus tick = bib_tick(&bib, &saved);
+        if (tick == BIB_IO_ERROR) {
+            printf("Aviso: checkpoint falhou; o diário continua valendo.\n");
+        } else if (tick == BIB_SAVED) {
+            printf("\n[Gravação concluída em %s (%.3f s).]\n", BANCO_FILE, saved.secs);
+        }
 
+        int op;
+        if (batch.in) {
+            if (batch_step(&batch, &bib)) continue;
+            batch_finish(&batch, &bib);
+            op = 0;
+        } else {
+            print_index_news(&bib.ci);
+            print_history_news(&bib.ls);
+            show_menu();
+            op = read_int("Escolha: ");
+        }
+
+        LoanSystem* ls = &bib.ls;
+        HashBooks* hb = &bib.hb;
         switch (op) {
             /* LIVROS */
-            case 1: ui_add_book(&books, &hb); break;
-            case 2: books_print(books); break;
-            case 3: ui_find_book_by_isbn_fast(&hb); break;
-            case 4: ui_text_search(books, &hb); break;
-            case 5: ui_list_books_avl(books); break;
-            case 6: ui_bptree_range(books); break;
-            case 7: ui_top_books(books); break;
-            case 8: ui_remove_book(&books, &hb); break;
+            case 1: ui_add_book(&bib); break;
+            case 2: print_books(bib.books); break;
+            case 3: ui_find_book_by_isbn_fast(&bib); break;
+            case 4: ui_text_search(&bib); break;
+            case 5: ui_list_books_avl(&bib); break;
+            case 6: ui_bptree_range(&bib); break;
+            case 7: ui_top_books(bib_rank(&bib)); break;
+            case 8: ui_remove_book(&bib); break;
+            case 21: ui_trending(ls, &bib.trend, hb); break;
+            case 22: ui_sketches(&bib.sk.view, hb); break;
+            case 23: ui_sketch_merge(&bib); break;
 
             /* USUÁRIOS */
-            case 9: ui_add_user(&users); break;
-            case 10: users_print(users); break;
-            case 11: ui_find_user(users); break;
-            case 12: ui_remove_user(&users); break;
+            case 9: ui_add_user(&bib); break;
+            case 10: print_users(bib.users); break;
+            case 11: ui_find_user(&bib); break;
+            case 12: ui_remove_user(&bib); break;
 
             /* EMPRÉSTIMOS */
-            case 13: ui_borrow(&ls, users, books); break;
-            case 14: ui_return(&ls, users, books); break;
-            case 15: ls_print_loans(&ls); break;
-            case 16: ls_print_waits(&ls); break;
-            case 17: ls_print_history(&ls); break;
+            case 13: ui_borrow(&bib); break;
+            case 14: ui_return(&bib); break;
+            case 15: print_loans(ls); break;
+            case 16: print_waits(ls); break;
+            case 17: print_history(ls); break;
+            case 27: ui_related(ls, hb); break;
+            case 28: ui_user_loans(ls, hb); break;
+            case 29: ui_book_holders(ls); break;
+            case 30: ui_wait_position(ls); break;
+            case 31: ui_history_user(ls); break;
+            case 32: ui_history_book(ls); break;
+            case 33: ui_history_period(ls); break;
 
             /* ARQUIVOS */
-            case 18:
-                books_save(books);
-                users_save(users);
-                ls_save(&ls);
-                break;
+            case 18: save_async(&bib); break;
+            case 34: ui_export_books(&bib); break;
 
             /* DSU */
-            case 19: ui_dsu_same(users, &ls); break;
-            case 20: ui_dsu_size(users, &ls); break;
+            case 19: ui_dsu_same(bib.users, ls); break;
+            case 20: ui_dsu_size(bib.users, ls); break;
+            case 24: ui_dsu_top(bib.users, ls); break;
+            case 25: ui_dsu_histogram(bib.users, ls); break;
+            case 26: ui_import_history(bib.users, ls); break;
 
             case 0:
-                books_save(books);
-                users_save(users);
-                ls_save(&ls);
-
-                hb_free(&hb);
-                ls_free(&ls);
-                books_free(books);
-                users_free(users);
-
+                save_all(&bib);
+                bib_close(&bib);
+                ob_close(&out);
                 printf("Saindo.\n");
                 return 0;
 
@@ -0,0 +1,465 @@
+#include "motor.h"
+#include "dsu_paralelo.h"
+#include "busca_usuarios.h"
+#include "saida.h"
+#include "plataforma.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* ---------- Funções auxiliares ---------- */
+
+static void out_of_memory(const char* what) {
+    printf("Erro ao criar %s: sem memória.\n", what);
+    exit(1);
+}
+
+/* Eventos que já entraram no histórico (do banco, do diário e desta sessão) */
+static long history_seq(Biblioteca* b) {
+    return b->ls.hist_base + hl_size(&b->ls.history);
+}
+
+/* Esboços com a marca do histórico que a parte local já viu */
+static int sketches_save(Biblioteca* b) {
+    b->sk.local.hist_seq = (unsigned long long)history_seq(b);
+    return sk_save(&b->sk, SKETCH_FILE);
+}
+
+/* Checkpoint terminado em segundo plano. Os esboços vão junto: sem isso,
+   o que volta pelo diário depois de uma queda ficaria fora deles.
+   Retorna 1 se gravou os esboços. */
+static int checkpoint_finish(Biblioteca* b) {
+    ls_checkpoint_done(&b->ls, &b->ck);
+    books_changes_done(&b->book_slots, b->ck.ok);
+    users_changes_done(&b->user_slots, b->ck.ok);
+    if (!b->ck.ok) {
+        b->ck_failed = 1;
+        return 0;
+    }
+    return sketches_save(b);
+}
+
+/* Tira a foto do estado e começa a gravá-la em segundo plano. Com o diário
+   aberto, ele passa para um segmento novo no mesmo instante da foto; sem
+   diário, a foto cobre o mesmo segmento de antes. */
+static int checkpoint_start(Biblioteca* b, int announce) {
+    if (ck_running(&b->ck)) return 0;
+    if (b->ls.jr) {
+        unsigned int next = jr_rotate(b->ls.jr);
+        if (next == 0) return 0;
+        b->seg = next;
+    }
+
+    /* livros e usuários: só o que mudou desde o último checkpoint */
+    size_t len;
+    unsigned char* data = books_changes(b->books, &b->book_slots, &len);
+    ck_add_patches(&b->ck, DB_BOOKS, DB_REC_BOOK, data, len);
+    data = users_changes(b->users, &b->user_slots, &len);
+    ck_add_patches(&b->ck, DB_USERS, DB_REC_USER, data, len);
+    ls_snapshot(&b->ls, &b->ck);
+    b->ck.announce = announce;
+    if (!ck_start(&b->ck, &b->db, DIARIO_PREFIX, b->seg)) {
+        /* o que foi tirado da foto volta a ser gravado no próximo */
+        b->ck.ok = 0;
+        checkpoint_finish(b);
+        return 0;
+    }
+    b->last_ck = time(NULL);
+    return 1;
+}
+
+/* Reaplica o diário antigo e os segmentos a partir de 'seg'. Retorna o
+   primeiro segmento que não existe (onde o diário continua). */
+static unsigned int replay_journal(Biblioteca* b, unsigned int seg) {
+    b->replayed = 0;
+    long n = ls_replay_journal(&b->ls, &b->books, &b->users, &b->book_slots, &b->user_slots,
+                               DIARIO_LEGACY, &b->journal_torn);
+    if (n > 0) b->replayed += n;
+
+    char path[96];
+    while (1) {
+        jr_segment_path(DIARIO_PREFIX, seg, path, sizeof(path));
+        n = ls_replay_journal(&b->ls, &b->books, &b->users, &b->book_slots, &b->user_slots,
+                              path, &b->journal_torn);
+        if (n < 0) break;
+        b->replayed += n;
+        seg++;
+    }
+    return seg;
+}
+
+/* Prazo do group commit (ms); BIBLIOTECA_LATENCIA_MS muda o padrão */
+static int journal_latency(void) {
+    const char* env = getenv("BIBLIOTECA_LATENCIA_MS");
+    int ms = env ? atoi(env) : 0;
+    return ms > 0 ? ms : DIARIO_LATENCY_MS;
+}
+
+/* Põe a parte local dos esboços em dia com o histórico: observa os
+   empréstimos depois da marca do esbocos.dat (os que voltaram pelo diário).
+   Sem arquivo, ou com uma marca além do histórico, refaz a parte local a
+   partir do histórico; a mesclada de outras filiais fica como está. */
+static void sketches_from_history(Biblioteca* b, int loaded) {
+    long from = (long)b->sk.local.hist_seq;
+    if (loaded <= 0 || from > history_seq(b)) {
+        an_clear(&b->sk.local);
+        from = 0;
+    }
+    /* eventos que ainda estão só no banco */
+    if (from < b->ls.hist_base) ls_history_ready(&b->ls);
+
+    long i = from - b->ls.hist_base;
+    if (i < 0) i = 0;   /* histórico do banco ilegível: só o que está no log */
+    for (long n = hl_size(&b->ls.history); i < n; i++) {
+        HistEvent e;
+        hl_get(&b->ls.history, i, &e);
+        if (e.type != ACT_BORROW && e.type != ACT_AUTO_BORROW) continue;
+        Book* bk = hb_get(&b->hb, e.isbn);
+        an_observe(&b->sk.local, e.user_id, e.isbn, bk ? bk->author : NULL);
+    }
+    sk_refresh(&b->sk);
+}
+
+/* ---------- Abertura e gravação ---------- */
+
+BibStatus bib_open(Biblioteca* b) {
+    memset(b, 0, sizeof(*b));
+
+    /* tudo fica no biblioteca.db; os .dat soltos só são lidos para migrar */
+    int have_db = db_open(&b->db, BANCO_FILE);
+    if (have_db < 0) return BIB_CORRUPT;
+    b->migrated = !have_db;
+
+    CkManifest man;
+    int have_ck = 0;
+    if (have_db) {
+        b->books = books_load_db(&b->db, &b->book_slots);
+        b->users = users_load_db(&b->db, &b->user_slots);
+    } else {
+        /* o último checkpoint diz até onde os .dat valem */
+        have_ck = ck_read_manifest(&man);
+        b->books = books_load(&b->book_slots);
+        b->users = users_load(&b->user_slots);
+        /* no banco novo todos os slots são gravados */
+        books_changes_all(&b->book_slots);
+        users_changes_all(&b->user_slots);
+    }
+
+    ls_init(&b->ls);
+
+    /* as hashes por ISBN e id já servem ao replay do diário */
+    if (!hb_init(&b->hb, 997)) out_of_memory("tabela hash");
+    if (!hu_init(&b->hu, 997)) out_of_memory("tabela hash");
+    b->ls.hb = &b->hb;
+    b->ls.hu = &b->hu;
+
+    /* o motor de tendências é alimentado enquanto o histórico é carregado */
+    if (!trend_init(&b->trend, 997)) out_of_memory("motor de tendências");
+    b->ls.trend = &b->trend;
+    unsigned int first_seg;
+    if (have_db) {
+        ls_load_db(&b->ls, &b->db);
+        first_seg = b->db.journal_seg;
+    } else {
+        ls_load(&b->ls, have_ck ? (long)man.hist_count : -1);
+        first_seg = have_ck ? man.seg : 1;
+    }
+
+    /* o que mudou depois do último checkpoint está no diário */
+    b->seg = replay_journal(b, first_seg);
+
+    if (!have_db && !db_create(&b->db, BANCO_FILE)) return BIB_IO_ERROR;
+
+    /* cada execução começa um segmento; os antigos saem no próximo checkpoint */
+    b->journal_ok = jr_open(&b->jr, DIARIO_PREFIX, b->seg, journal_latency());
+    if (b->journal_ok) b->ls.jr = &b->jr;
+
+    ck_init(&b->ck);
+    b->last_ck = time(NULL);
+    /* migração: o primeiro checkpoint leva os .dat para o banco */
+    if (!have_db) checkpoint_start(b, 0);
+
+    /* os outros índices são montados em paralelo enquanto a hash por ISBN,
+       que quase tudo usa, é montada aqui */
+    ci_init(&b->ci);
+    ci_open(&b->ci, b->books, b->users, cdsu_default_threads());
+    b->ls.rank = &b->ci.rank;
+
+    /* o replay só monta as hashes se o diário mexeu no catálogo */
+    if (b->hb.n == 0) hb_build_from_list(&b->hb, b->books);
+    if (b->hu.n == 0) hu_build_from_list(&b->hu, b->users);
+
+    if (!sk_init(&b->sk)) out_of_memory("esboços");
+    int sk_loaded = sk_load(&b->sk, SKETCH_FILE);
+    b->sketches_reset = sk_loaded < 0;
+    sketches_from_history(b, sk_loaded);
+    b->ls.sk = &b->sk;
+    return BIB_OK;
+}
+
+void bib_close(Biblioteca* b) {
+    if (ck_running(&b->ck)) {
+        ck_wait(&b->ck);
+        checkpoint_finish(b);
+    }
+    if (b->ls.jr) jr_close(b->ls.jr);
+    b->ls.jr = NULL;
+    db_close(&b->db);
+
+    hb_free(&b->hb);
+    hu_free(&b->hu);
+    trend_free(&b->trend);
+    sk_free(&b->sk);
+    ci_free(&b->ci);
+    ls_free(&b->ls);
+    books_free(b->books);
+    users_free(b->users);
+    sm_free(&b->book_slots);
+    sm_free(&b->user_slots);
+    b->books = NULL;
+    b->users = NULL;
+}
+
+BibStatus bib_tick(Biblioteca* b, BibSaveInfo* info) {
+    BibSaveInfo tmp;
+    if (!info) info = &tmp;
+    memset(info, 0, sizeof(*info));
+
+    int saved = 0;
+    if (ck_poll(&b->ck)) {
+        info->sketches = checkpoint_finish(b);
+        info->secs = b->ck.secs;
+        saved = b->ck.ok && b->ck.announce;
+        if (b->save_queued) {
+            b->save_queued = 0;
+            checkpoint_start(b, 1);
+        }
+    } else if (b->ls.jr && !ck_running(&b->ck)) {
+        long long pending = jr_size(b->ls.jr);
+        if (pending >= CHECKPOINT_BYTES ||
+            (pending > 0 && time(NULL) - b->last_ck >= CHECKPOINT_SECS)) {
+            checkpoint_start(b, 0);
+        }
+    }
+
+    int failed = b->ck_failed;
+    b->ck_failed = 0;
+    if (failed) return BIB_IO_ERROR;
+    return saved ? BIB_SAVED : BIB_OK;
+}
+
+BibStatus bib_sync(Biblioteca* b) {
+    if (!b->ls.jr) return BIB_OK;
+    jr_wait(b->ls.jr, jr_last(b->ls.jr));
+    return jr_failed(b->ls.jr) ? BIB_IO_ERROR : BIB_OK;
+}
+
+BibStatus bib_save(Biblioteca* b, BibSaveInfo* info) {
+    BibSaveInfo tmp;
+    if (!info) info = &tmp;
+    memset(info, 0, sizeof(*info));
+
+    if (ck_running(&b->ck)) {
+        ck_wait(&b->ck);
+        checkpoint_finish(b);
+    }
+    b->save_queued = 0;
+    BibStatus st = BIB_IO_ERROR;
+    if (checkpoint_start(b, 0)) {
+        ck_wait(&b->ck);
+        info->sketches = checkpoint_finish(b);
+        if (b->ck.ok) st = BIB_OK;
+        info->secs = b->ck.secs;
+    }
+    b->ck_failed = 0;   /* já respondido aqui */
+    info->text_index = ci_save(&b->ci, 1);
+    return st;
+}
+
+BibStatus bib_save_async(Biblioteca* b, BibSaveInfo* info) {
+    BibSaveInfo tmp;
+    if (!info) info = &tmp;
+    memset(info, 0, sizeof(*info));
+
+    if (ck_running(&b->ck)) {
+        b->save_queued = 1;
+        info->text_index = ci_save(&b->ci, 0);
+        return BIB_QUEUED;
+    }
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    int started = checkpoint_start(b, 1);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    info->secs = (double)(t1.tv_sec - t0.tv_sec) + (double)(t1.tv_nsec - t0.tv_nsec) / 1e9;
+    info->text_index = ci_save(&b->ci, 0);
+    return started ? BIB_OK : BIB_IO_ERROR;
+}
+
+BibStatus bib_sketch_import(Biblioteca* b, const char* path) {
+    if (!sk_import(&b->sk, path)) return BIB_CORRUPT;
+    return sketches_save(b) ? BIB_OK : BIB_IO_ERROR;
+}
+
+/* ---------- Livros ---------- */
+
+BibStatus bib_add_book(Biblioteca* b, const Book* book) {
+    if (hb_get(&b->hb, book->isbn)) return BIB_EXISTS;
+    /* o catálogo fica só leitura enquanto os índices são montados */
+    ci_settle(&b->ci);
+
+    books_push_front(&b->books, book);
+    hb_insert(&b->hb, b->books);
+    ci_book_added(&b->ci, &b->books->data);
+    ls_log_book_put(&b->ls, book);
+    return BIB_OK;
+}
+
+BibStatus bib_remove_book(Biblioteca* b, long long isbn, BibResult* r) {
+    BibResult tmp;
+    if (!r) r = &tmp;
+    memset(r, 0, sizeof(*r));
+
+    ls_holders_of_book(&b->ls, isbn, &r->loans);
+    if (r->loans > 0) return BIB_HAS_LOANS;
+
+    Book* found = hb_get(&b->hb, isbn);
+    if (!found) return BIB_NO_BOOK;
+    ci_settle(&b->ci);
+
+    /* cópia para tirar o livro dos índices depois que o nó sai; a hash
+       aponta para o nó e tem de largá-lo antes */
+    Book old = *found;
+    hb_remove(&b->hb, isbn);
+    books_remove(&b->books, &b->book_slots, isbn);
+    ci_book_removed(&b->ci, &old);
+    ls_log_book_del(&b->ls, isbn);
+    r->dropped = ls_drop_book(&b->ls, isbn);
+    return BIB_OK;
+}
+
+const Book* bib_find_book(Biblioteca* b, long long isbn) {
+    return hb_get(&b->hb, isbn);
+}
+
+BibStatus bib_export_books(Biblioteca* b, const char* path, long* count) {
+    long n = 0;
+    if (count) *count = 0;
+    FILE* f = fopen(path, "wb");
+    if (!f) return BIB_IO_ERROR;
+
+    OutBuf o;
+    ob_open(&o, plat_fileno(f), OUT_BUF_SIZE);
+    ob_str(&o, "isbn\ttitulo\tautor\tano\tdisponiveis\ttotal\temprestimos\n");
+    for (BookNode* cur = b->books; cur; cur = cur->next) {
+        const Book* bk = &cur->data;
+        ob_ll(&o, bk->isbn);
+        ob_char(&o, '\t');
+        ob_str(&o, bk->title);
+        ob_char(&o, '\t');
+        ob_str(&o, bk->author);
+        ob_char(&o, '\t');
+        ob_ll(&o, bk->year);
+        ob_char(&o, '\t');
+        ob_ll(&o, bk->copies_available);
+        ob_char(&o, '\t');
+        ob_ll(&o, bk->copies_total);
+        ob_char(&o, '\t');
+        ob_ll(&o, bk->times_borrowed);
+        ob_char(&o, '\n');
+        n++;
+    }
+    int ok = ob_close(&o);
+    if (fclose(f) != 0) ok = 0;
+    if (count) *count = n;
+    return ok ? BIB_OK : BIB_IO_ERROR;
+}
+
+AVLNode* bib_titles(Biblioteca* b) {
+    return ci_titles(&b->ci, b->books);
+}
+
+BPTree* bib_isbns(Biblioteca* b) {
+    return ci_isbns(&b->ci, b->books);
+}
+
+TopRank* bib_rank(Biblioteca* b) {
+    return ci_rank(&b->ci);
+}
+
+int bib_text_search(Biblioteca* b, const char* word, TextIter* it) {
+    memset(it, 0, sizeof(*it));
+    it->word = word;
+    it->hb = &b->hb;
+    if (ci_ready(&b->ci, CI_TEXT)) {
+        it->hit = ti_find(&b->ci.text, word);
+        return 1;
+    }
+    /* índice ainda sendo montado: varre a lista */
+    it->scan = b->books;
+    return 0;
+}
+
+const Book* bib_text_next(TextIter* it) {
+    while (it->hit) {
+        Book* bk = hb_get(it->hb, it->hit->isbn);
+        it->hit = it->hit->next;
+        if (bk) return bk;
+    }
+    while (it->scan) {
+        const Book* bk = &it->scan->data;
+        it->scan = it->scan->next;
+        if (ti_text_has_word(bk->title, it->word) || ti_text_has_word(bk->author, it->word)) return bk;
+    }
+    return NULL;
+}
+
+/* ---------- Usuários ---------- */
+
+BibStatus bib_add_user(Biblioteca* b, const User* u) {
+    if (hu_get(&b->hu, u->id)) return BIB_EXISTS;
+    ci_settle(&b->ci);
+
+    users_push_front(&b->users, u);
+    hu_insert(&b->hu, b->users);
+    ci_users_changed(&b->ci);
+    ls_log_user_put(&b->ls, u);
+    return BIB_OK;
+}
+
+BibStatus bib_remove_user(Biblioteca* b, int id, BibResult* r) {
+    BibResult tmp;
+    if (!r) r = &tmp;
+    memset(r, 0, sizeof(*r));
+
+    ls_loans_of_user(&b->ls, id, &r->loans);
+    if (r->loans > 0) return BIB_HAS_LOANS;
+    ci_settle(&b->ci);
+
+    /* a hash aponta para o nó e tem de largá-lo antes */
+    if (!hu_remove(&b->hu, id)) return BIB_NO_USER;
+    users_remove(&b->users, &b->user_slots, id);
+    ci_users_changed(&b->ci);
+    ls_log_user_del(&b->ls, id);
+    r->dropped = ls_drop_user(&b->ls, id);
+    ls_comm_invalidate(&b->ls); /* comunidades são refeitas sem o usuário */
+    return BIB_OK;
+}
+
+const User* bib_find_user(Biblioteca* b, int id) {
+    int n = 0;
+    User** arr = ci_users(&b->ci, b->users, &n);
+    if (!arr || n == 0) return NULL;
+    return users_binary_search(arr, n, id);
+}
+
+/* ---------- Empréstimos ---------- */
+
+BibStatus bib_borrow(Biblioteca* b, int user_id, long long isbn, BibResult* r) {
+    ci_settle(&b->ci);   /* mexe no ranking e nas contagens do livro */
+    return ls_borrow(&b->ls, user_id, isbn, r);
+}
+
+BibStatus bib_return(Biblioteca* b, int user_id, long long isbn, BibResult* r) {
+    ci_settle(&b->ci);
+    return ls_return(&b->ls, user_id, isbn, r);
+}
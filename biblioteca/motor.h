@@ -0,0 +1,134 @@
+#ifndef MOTOR_H
+#define MOTOR_H
+
+#include <time.h>
+#include "resultado.h"
+#include "banco.h"
+#include "livros.h"
+#include "usuarios.h"
+#include "hash_livros.h"
+#include "hash_usuarios.h"
+#include "indices.h"
+#include "emprestimos.h"
+#include "tendencias.h"
+#include "sketch.h"
+#include "diario.h"
+#include "checkpoint.h"
+
+/* Motor da biblioteca (libbiblioteca.a): o estado inteiro e as operações,
+   sem ler do teclado nem escrever na tela. O menu e o modo lote são
+   clientes dele.
+
+   - Operações devolvem um BibStatus (resultado.h) e, quando há o que
+     contar, preenchem um BibResult.
+   - Listagens são lidas com os iteradores de cada estrutura: a lista de
+     livros/usuários (next), avl_iter (título), bpt_range (ISBN), rank_top,
+     ls->loans e ls->waits, hl_iter (histórico) e bib_text_next (busca).
+   - Entre uma operação e outra, quem usa chama bib_tick (checkpoints em
+     segundo plano) e, para confirmar no disco, bib_sync.
+   - Depois de bib_open a struct não pode ser copiada nem movida: o sistema
+     de empréstimos aponta para o diário, o ranking e os esboços de dentro. */
+
+typedef struct {
+    Db db;
+    BookNode* books;
+    UserNode* users;
+    SlotMap book_slots;    /* slots dos livros e usuários no banco (save incremental) */
+    SlotMap user_slots;
+    HashBooks hb;          /* índice principal por ISBN */
+    HashUsers hu;          /* usuários por ID (empréstimos, devoluções, cadastro) */
+    CatalogIndex ci;       /* texto, AVL, B+, ranking e usuários por ID */
+    LoanSystem ls;
+    Trending trend;
+    SketchSet sk;
+
+    Journal jr;
+    Checkpoint ck;
+    unsigned int seg;      /* segmento atual do diário */
+    time_t last_ck;
+    int save_queued;       /* salvar pedido com um checkpoint já gravando */
+    int ck_failed;         /* um checkpoint falhou desde o último bib_tick */
+
+    /* como foi a abertura */
+    int migrated;          /* lido dos .dat soltos (e levado para o banco) */
+    long replayed;         /* alterações reaplicadas do diário */
+    long long journal_torn; /* bytes incompletos cortados do fim do diário */
+    int journal_ok;        /* 0 = sem diário: só o salvar grava */
+    int sketches_reset;    /* esbocos.dat ilegível: o que veio de outras
+                              filiais se perdeu (a parte local foi refeita) */
+} Biblioteca;
+
+/* Detalhes de uma gravação */
+typedef struct {
+    double secs;           /* bib_save e bib_tick: checkpoint; bib_save_async: foto */
+    int sketches;          /* esbocos.dat gravado (bib_save; no assíncrono e nos
+                              automáticos, ele vai quando o checkpoint termina) */
+    int text_index;        /* indice_texto.dat gravado */
+} BibSaveInfo;
+
+/* Abre (ou migra) o biblioteca.db, reaplica o diário e começa a montar os
+   índices. BIB_CORRUPT ou BIB_IO_ERROR: nada para fechar. */
+BibStatus bib_open(Biblioteca* b);
+/* Fecha sem gravar (chamar bib_save antes) e libera tudo */
+void bib_close(Biblioteca* b);
+
+/* Checkpoint em segundo plano quando o diário cresce ou o tempo passa.
+   BIB_IO_ERROR se um checkpoint falhou (o diário continua valendo);
+   BIB_SAVED quando termina o de um bib_save_async, com 'info' preenchido
+   (pode ser NULL). */
+BibStatus bib_tick(Biblioteca* b, BibSaveInfo* info);
+/* Espera o diário confirmar no disco tudo o que foi feito até aqui.
+   BIB_IO_ERROR: uma gravação do diário falhou e ele parou; o que mudou
+   desde então não está protegido. */
+BibStatus bib_sync(Biblioteca* b);
+
+/* Grava tudo e espera (BIB_OK / BIB_IO_ERROR) */
+BibStatus bib_save(Biblioteca* b, BibSaveInfo* info);
+/* Tira a foto e volta na hora (bib_tick avisa no fim). BIB_QUEUED: já
+   havia um checkpoint gravando; este começa quando ele terminar. */
+BibStatus bib_save_async(Biblioteca* b, BibSaveInfo* info);
+
+/* Mescla os esboços exportados por outra filial e grava o esbocos.dat na
+   hora (a parte mesclada só existe nele). BIB_CORRUPT: arquivo inválido ou
+   com parâmetros diferentes; BIB_IO_ERROR: mesclou, mas não gravou. */
+BibStatus bib_sketch_import(Biblioteca* b, const char* path);
+
+/* ---------- Livros ---------- */
+
+BibStatus   bib_add_book(Biblioteca* b, const Book* book);            /* BIB_EXISTS */
+BibStatus   bib_remove_book(Biblioteca* b, long long isbn, BibResult* r); /* BIB_NO_BOOK, BIB_HAS_LOANS */
+const Book* bib_find_book(Biblioteca* b, long long isbn);
+
+/* Exporta o catálogo em texto, uma linha por livro separada por
+   tabulações (com cabeçalho); BIB_IO_ERROR se não gravou tudo */
+BibStatus   bib_export_books(Biblioteca* b, const char* path, long* count);
+
+/* Índices derivados (esperam a montagem, se ainda não terminou) */
+AVLNode* bib_titles(Biblioteca* b);
+BPTree*  bib_isbns(Biblioteca* b);
+TopRank* bib_rank(Biblioteca* b);
+
+/* Busca por palavra no título/autor: pelo índice, se pronto; senão
+   varrendo a lista. Retorna 1 se usou o índice. */
+typedef struct {
+    const char* word;
+    IsbnNode* hit;         /* ISBNs do índice */
+    BookNode* scan;        /* posição na lista (sem índice) */
+    HashBooks* hb;
+} TextIter;
+
+int         bib_text_search(Biblioteca* b, const char* word, TextIter* it);
+const Book* bib_text_next(TextIter* it);   /* NULL quando acabou */
+
+/* ---------- Usuários ---------- */
+
+BibStatus   bib_add_user(Biblioteca* b, const User* u);                /* BIB_EXISTS */
+BibStatus   bib_remove_user(Biblioteca* b, int id, BibResult* r);       /* BIB_NO_USER, BIB_HAS_LOANS */
+const User* bib_find_user(Biblioteca* b, int id);                      /* busca binária */
+
+/* ---------- Empréstimos ---------- */
+
+BibStatus bib_borrow(Biblioteca* b, int user_id, long long isbn, BibResult* r);
+BibStatus bib_return(Biblioteca* b, int user_id, long long isbn, BibResult* r);
+
+#endif
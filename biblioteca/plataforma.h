@@ -0,0 +1,123 @@
+#ifndef PLATAFORMA_H
+#define PLATAFORMA_H
+
+/* Diferenças entre Windows (MinGW) e POSIX usadas na persistência */
+
+#include <stdio.h>
+
+#ifdef _WIN32
+#include <io.h>
+#include <windows.h>
+#define plat_fileno(f)          _fileno(f)
+#define plat_fsync(fd)          _commit(fd)
+#define plat_ftruncate(fd, sz)  _chsize_s((fd), (long long)(sz))
+#else
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/uio.h>
+#define plat_fileno(f)          fileno(f)
+#define plat_fsync(fd)          fsync(fd)
+#define plat_ftruncate(fd, sz)  ftruncate((fd), (off_t)(sz))
+#endif
+
+/* Garante que o que foi escrito em f chegou ao disco (0 = ok) */
+static inline int plat_sync_file(FILE* f) {
+    if (fflush(f) != 0) return -1;
+    return plat_fsync(plat_fileno(f));
+}
+
+/* Escreve len bytes na posição off do arquivo, sem mexer no resto
+   (0 = ok) */
+static inline int plat_pwrite(int fd, const void* buf, size_t len, long long off) {
+#ifdef _WIN32
+    if (_lseeki64(fd, off, SEEK_SET) < 0) return -1;
+    return _write(fd, buf, (unsigned int)len) == (int)len ? 0 : -1;
+#else
+    const char* p = (const char*)buf;
+    while (len > 0) {
+        ssize_t w = pwrite(fd, p, len, (off_t)off);
+        if (w <= 0) return -1;
+        p += w;
+        off += w;
+        len -= (size_t)w;
+    }
+    return 0;
+#endif
+}
+
+/* Escreve a e depois b no fim do descritor, numa chamada só quando dá
+   (writev); b pode ser vazio (0 = ok) */
+static inline int plat_write2(int fd, const void* a, size_t alen, const void* b, size_t blen) {
+#ifdef _WIN32
+    if (alen > 0 && _write(fd, a, (unsigned int)alen) != (int)alen) return -1;
+    if (blen > 0 && _write(fd, b, (unsigned int)blen) != (int)blen) return -1;
+    return 0;
+#else
+    struct iovec v[2];
+    v[0].iov_base = (void*)a;
+    v[0].iov_len = alen;
+    v[1].iov_base = (void*)b;
+    v[1].iov_len = blen;
+    int i = 0;
+    while (i < 2) {
+        if (v[i].iov_len == 0) {
+            i++;
+            continue;
+        }
+        ssize_t w = writev(fd, v + i, 2 - i);
+        if (w <= 0) return -1;
+        /* escrita parcial: avança pelo que já foi */
+        while (i < 2 && (size_t)w >= v[i].iov_len) {
+            w -= (ssize_t)v[i].iov_len;
+            v[i].iov_len = 0;
+            i++;
+        }
+        if (i < 2) {
+            v[i].iov_base = (char*)v[i].iov_base + w;
+            v[i].iov_len -= (size_t)w;
+        }
+    }
+    return 0;
+#endif
+}
+
+/* Lê len bytes da posição off (0 = leu tudo) */
+static inline int plat_pread(int fd, void* buf, size_t len, long long off) {
+#ifdef _WIN32
+    if (_lseeki64(fd, off, SEEK_SET) < 0) return -1;
+    return _read(fd, buf, (unsigned int)len) == (int)len ? 0 : -1;
+#else
+    char* p = (char*)buf;
+    while (len > 0) {
+        ssize_t r = pread(fd, p, len, (off_t)off);
+        if (r <= 0) return -1;
+        p += r;
+        off += r;
+        len -= (size_t)r;
+    }
+    return 0;
+#endif
+}
+
+/* Troca 'to' por 'from' de uma vez só (0 = ok); no Windows, rename não
+   substitui um arquivo existente */
+static inline int plat_replace(const char* from, const char* to) {
+#ifdef _WIN32
+    return MoveFileExA(from, to, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) ? 0 : -1;
+#else
+    return rename(from, to);
+#endif
+}
+
+/* Garante que renomeações na pasta atual chegaram ao disco */
+static inline void plat_sync_dir(void) {
+#ifndef _WIN32
+    int fd = open(".", O_RDONLY);
+    if (fd >= 0) {
+        fsync(fd);
+        close(fd);
+    }
+#endif
+}
+
+#endif
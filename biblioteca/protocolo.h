@@ -0,0 +1,55 @@
+#ifndef PROTOCOLO_H
+#define PROTOCOLO_H
+
+#include "banco.h"   /* le_put32/le_get32/le_put64/le_get64 */
+
+/* Protocolo binário do modo servidor (servidor.c) e do gerador de carga
+   (carga.c).
+
+   Cada quadro é um u32 com o tamanho do corpo seguido do corpo; inteiros
+   em little-endian.
+     pedido:   u8 op | u32 id | argumentos
+     resposta: u8 status | u32 id (o do pedido) | dados
+   O status é um BibStatus (resultado.h) ou PR_BAD_REQUEST. As respostas
+   de uma conexão saem na ordem dos pedidos, então o cliente pode mandar
+   vários sem esperar as respostas (pipelining).
+
+     op          argumentos                       dados da resposta
+     PR_BORROW   i32 usuário, i64 isbn            i32 posição, i32 total na fila
+     PR_RETURN   i32 usuário, i64 isbn            i32 próximo da fila, i32 estado
+                                                  (como em BibResult)
+     PR_LOOKUP   i64 isbn                         livro, se BIB_OK
+     PR_SEARCH   u16 máximo, palavra (o resto)    u32 n, n x i64 isbn
+     PR_RANGE    i64 início, i64 fim, u16 máximo  u32 n, n x i64 isbn
+
+   Livro: i64 isbn, i32 ano, i32 disponíveis, i32 total, i32 emprestado,
+   u16 + título, u16 + autor.
+
+   Empréstimo e devolução só são respondidos depois de irem para o disco
+   (diário). Op desconhecido ou argumentos curtos: PR_BAD_REQUEST, sem
+   dados; quadro maior que PR_MAX_FRAME fecha a conexão. */
+
+#define PR_LEN_BYTES   4
+#define PR_HEAD_BYTES  5        /* op/status + id */
+#define PR_MAX_FRAME   4096
+#define PR_MAX_HITS    1000     /* teto do máximo de busca e intervalo */
+#define PR_BAD_REQUEST 255
+
+typedef enum {
+    PR_BORROW = 1,
+    PR_RETURN,
+    PR_LOOKUP,
+    PR_SEARCH,
+    PR_RANGE
+} PrOp;
+
+static inline void le_put16(unsigned char* p, unsigned int v) {
+    p[0] = (unsigned char)v;
+    p[1] = (unsigned char)(v >> 8);
+}
+
+static inline unsigned int le_get16(const unsigned char* p) {
+    return (unsigned int)p[0] | ((unsigned int)p[1] << 8);
+}
+
+#endif
@@ -0,0 +1,253 @@
+#include "recomendacao.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* ---------- Funções auxiliares ---------- */
+
+static void* xmalloc(size_t sz) {
+    void* p = malloc(sz ? sz : 1);
+    if (!p) {
+        printf("Erro: sem memória.\n");
+        exit(1);
+    }
+    return p;
+}
+
+static void* xcalloc(size_t n, size_t sz) {
+    void* p = calloc(n ? n : 1, sz);
+    if (!p) {
+        printf("Erro: sem memória.\n");
+        exit(1);
+    }
+    return p;
+}
+
+static int cmp_pair(const void* a, const void* b) {
+    const BorrowPair* x = (const BorrowPair*)a;
+    const BorrowPair* y = (const BorrowPair*)b;
+    if (x->user_id != y->user_id) return (x->user_id < y->user_id) ? -1 : 1;
+    if (x->isbn != y->isbn) return (x->isbn < y->isbn) ? -1 : 1;
+    return 0;
+}
+
+static int cmp_ll(const void* a, const void* b) {
+    long long x = *(const long long*)a, y = *(const long long*)b;
+    return (x > y) - (x < y);
+}
+
+/* Busca binária do ISBN no vetor ordenado; -1 se não está */
+static int isbn_index(const Incidence* m, long long isbn) {
+    int lo = 0, hi = m->n_books - 1;
+    while (lo <= hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (m->isbns[mid] == isbn) return mid;
+        if (m->isbns[mid] < isbn) lo = mid + 1;
+        else hi = mid - 1;
+    }
+    return -1;
+}
+
+static void inc_free(Incidence* m) {
+    free(m->user_ids);
+    free(m->isbns);
+    free(m->row_ptr);
+    free(m->col_idx);
+    free(m->col_ptr);
+    free(m->row_idx);
+    memset(m, 0, sizeof(*m));
+}
+
+/* Monta CSR + CSC a partir dos pares (o vetor é ordenado e deduplicado aqui) */
+static void inc_build(Incidence* m, BorrowPair* p, long n) {
+    qsort(p, (size_t)n, sizeof(BorrowPair), cmp_pair);
+
+    long w = 0;
+    for (long i = 0; i < n; i++) {
+        if (w > 0 && cmp_pair(&p[w - 1], &p[i]) == 0) continue;
+        p[w++] = p[i];
+    }
+    n = w;
+    m->nnz = n;
+
+    /* usuários distintos já saem em ordem */
+    int nu = 0;
+    for (long i = 0; i < n; i++) {
+        if (i == 0 || p[i].user_id != p[i - 1].user_id) nu++;
+    }
+
+    /* ISBNs distintos: ordena uma cópia e deduplica */
+    long long* is = (long long*)xmalloc((size_t)n * sizeof(long long));
+    for (long i = 0; i < n; i++) is[i] = p[i].isbn;
+    qsort(is, (size_t)n, sizeof(long long), cmp_ll);
+    int nb = 0;
+    for (long i = 0; i < n; i++) {
+        if (nb == 0 || is[nb - 1] != is[i]) is[nb++] = is[i];
+    }
+
+    m->n_users = nu;
+    m->n_books = nb;
+    m->isbns = is;
+    m->user_ids = (int*)xmalloc((size_t)nu * sizeof(int));
+    m->row_ptr = (long*)xmalloc(((size_t)nu + 1) * sizeof(long));
+    m->col_idx = (int*)xmalloc((size_t)n * sizeof(int));
+    m->col_ptr = (long*)xcalloc((size_t)nb + 1, sizeof(long));
+    m->row_idx = (int*)xmalloc((size_t)n * sizeof(int));
+
+    /* linhas (usuário -> livros) */
+    int u = -1;
+    for (long i = 0; i < n; i++) {
+        if (i == 0 || p[i].user_id != p[i - 1].user_id) {
+            u++;
+            m->user_ids[u] = p[i].user_id;
+            m->row_ptr[u] = i;
+        }
+        m->col_idx[i] = isbn_index(m, p[i].isbn);
+        m->col_ptr[m->col_idx[i] + 1]++;
+    }
+    m->row_ptr[nu] = n;
+
+    /* transposta por contagem (livro -> usuários, usuários em ordem) */
+    for (int b = 0; b < nb; b++) m->col_ptr[b + 1] += m->col_ptr[b];
+    long* fill = (long*)xmalloc((size_t)nb * sizeof(long));
+    memcpy(fill, m->col_ptr, (size_t)nb * sizeof(long));
+    for (int r = 0; r < nu; r++) {
+        for (long k = m->row_ptr[r]; k < m->row_ptr[r + 1]; k++) {
+            m->row_idx[fill[m->col_idx[k]]++] = r;
+        }
+    }
+    free(fill);
+}
+
+/* ---------- Top-N com min-heap limitado ---------- */
+
+/* "a é pior que b": menos leitores em comum, ou mesmo número e ISBN maior */
+static int worse(const Incidence* m, int sa, int ba, int sb, int bb) {
+    if (sa != sb) return sa < sb;
+    return m->isbns[ba] > m->isbns[bb];
+}
+
+static void heap_down(const Incidence* m, int* hb, int* hs, int n, int i) {
+    for (;;) {
+        int l = 2 * i + 1, r = l + 1, w = i;
+        if (l < n && worse(m, hs[l], hb[l], hs[w], hb[w])) w = l;
+        if (r < n && worse(m, hs[r], hb[r], hs[w], hb[w])) w = r;
+        if (w == i) return;
+        int tb = hb[i], ts = hs[i];
+        hb[i] = hb[w]; hs[i] = hs[w];
+        hb[w] = tb; hs[w] = ts;
+        i = w;
+    }
+}
+
+static void heap_up(const Incidence* m, int* hb, int* hs, int i) {
+    while (i > 0) {
+        int pa = (i - 1) / 2;
+        if (!worse(m, hs[i], hb[i], hs[pa], hb[pa])) return;
+        int tb = hb[i], ts = hs[i];
+        hb[i] = hb[pa]; hs[i] = hs[pa];
+        hb[pa] = tb; hs[pa] = ts;
+        i = pa;
+    }
+}
+
+/* Linha b de A^T·A com acumulador esparso (acc denso + lista dos tocados),
+   guardando só os REC_TOPN maiores */
+static void related_of(CoBorrow* c, int b, int* acc, int* touched) {
+    const Incidence* m = &c->m;
+    int nt = 0;
+
+    for (long k = m->col_ptr[b]; k < m->col_ptr[b + 1]; k++) {
+        int u = m->row_idx[k];
+        long deg = m->row_ptr[u + 1] - m->row_ptr[u];
+        if (deg > REC_MAX_DEGREE) continue;
+        for (long j = m->row_ptr[u]; j < m->row_ptr[u + 1]; j++) {
+            int o = m->col_idx[j];
+            if (o == b) continue;
+            if (acc[o] == 0) touched[nt++] = o;
+            acc[o]++;
+        }
+    }
+
+    int* hb = c->rel_book + (long)b * REC_TOPN;
+    int* hs = c->rel_score + (long)b * REC_TOPN;
+    int n = 0;
+    for (int i = 0; i < nt; i++) {
+        int o = touched[i];
+        int s = acc[o];
+        acc[o] = 0;
+        if (n < REC_TOPN) {
+            hb[n] = o; hs[n] = s;
+            heap_up(m, hb, hs, n);
+            n++;
+        } else if (worse(m, hs[0], hb[0], s, o)) {
+            hb[0] = o; hs[0] = s;
+            heap_down(m, hb, hs, n, 0);
+        }
+    }
+
+    /* esvazia o heap do fim para o começo: fica do melhor para o pior */
+    for (int end = n - 1; end > 0; end--) {
+        int tb = hb[0], ts = hs[0];
+        hb[0] = hb[end]; hs[0] = hs[end];
+        hb[end] = tb; hs[end] = ts;
+        heap_down(m, hb, hs, end, 0);
+    }
+    c->rel_n[b] = (unsigned char)n;
+}
+
+/* ---------- API ---------- */
+
+void cb_init(CoBorrow* c) {
+    memset(c, 0, sizeof(*c));
+    c->built_from = -1;
+}
+
+void cb_free(CoBorrow* c) {
+    inc_free(&c->m);
+    free(c->rel_book);
+    free(c->rel_score);
+    free(c->rel_n);
+    cb_init(c);
+}
+
+int cb_build(CoBorrow* c, BorrowPair* pairs, long n) {
+    cb_free(c);
+    inc_build(&c->m, pairs, n);
+
+    int nb = c->m.n_books;
+    c->rel_book = (int*)xmalloc((size_t)nb * REC_TOPN * sizeof(int));
+    c->rel_score = (int*)xmalloc((size_t)nb * REC_TOPN * sizeof(int));
+    c->rel_n = (unsigned char*)xcalloc((size_t)nb, 1);
+
+    int* acc = (int*)xcalloc((size_t)nb, sizeof(int));
+    int* touched = (int*)xmalloc((size_t)nb * sizeof(int));
+    for (int b = 0; b < nb; b++) related_of(c, b, acc, touched);
+    free(acc);
+    free(touched);
+
+    c->built_from = n;
+    c->valid = 1;
+    return 1;
+}
+
+int cb_stale(const CoBorrow* c) {
+    if (!c->valid) return 1;
+    if (c->pending == 0) return 0;
+    return c->built_from < REC_REBUILD_MIN || c->pending >= c->built_from / REC_REBUILD_DIV;
+}
+
+int cb_related(CoBorrow* c, long long isbn, RelatedBook* out, int k) {
+    if (!c->valid) return 0;
+    int b = isbn_index(&c->m, isbn);
+    if (b < 0) return 0;
+
+    int n = c->rel_n[b];
+    if (k < n) n = k;
+    for (int i = 0; i < n; i++) {
+        int o = c->rel_book[(long)b * REC_TOPN + i];
+        out[i].isbn = c->m.isbns[o];
+        out[i].score = c->rel_score[(long)b * REC_TOPN + i];
+    }
+    return n;
+}
@@ -0,0 +1,61 @@
+#ifndef RECOMENDACAO_H
+#define RECOMENDACAO_H
+
+#define REC_TOPN        10    /* relacionados guardados por livro */
+#define REC_MAX_DEGREE  1000  /* usuários com mais livros que isso ficam fora
+                                 das co-ocorrências (evita custo quadrático) */
+#define REC_REBUILD_MIN 4096  /* lotes menores são refeitos a cada empréstimo novo */
+#define REC_REBUILD_DIV 10    /* maiores, quando os novos passam de 1/10 do lote */
+
+/* Matriz esparsa usuário x livro em CSR (e a transposta em CSC).
+   Linha u: livros de u em col_idx[row_ptr[u] .. row_ptr[u+1]-1]
+   Coluna b: usuários de b em row_idx[col_ptr[b] .. col_ptr[b+1]-1] */
+typedef struct {
+    int n_users;
+    int n_books;
+    int* user_ids;        /* índice -> user_id (crescente) */
+    long long* isbns;     /* índice -> ISBN (crescente) */
+    long* row_ptr;
+    int* col_idx;
+    long* col_ptr;
+    int* row_idx;
+    long nnz;
+} Incidence;
+
+/* Um livro relacionado */
+typedef struct {
+    long long isbn;
+    int score;            /* quantos leitores pegaram os dois */
+} RelatedBook;
+
+/* Motor "quem pegou este também pegou": tudo pré-calculado em lote */
+typedef struct {
+    Incidence m;
+    int* rel_book;        /* n_books x REC_TOPN índices de livros */
+    int* rel_score;
+    unsigned char* rel_n; /* quantos relacionados cada livro tem */
+    long built_from;      /* empréstimos usados no lote */
+    long pending;         /* empréstimos que entraram no histórico depois dele */
+    int valid;
+} CoBorrow;
+
+/* Par (usuário, ISBN) vindo do histórico */
+typedef struct {
+    int user_id;
+    long long isbn;
+} BorrowPair;
+
+void cb_init(CoBorrow* c);
+void cb_free(CoBorrow* c);
+
+/* monta a matriz e pré-calcula os relacionados de todos os livros */
+int  cb_build(CoBorrow* c, BorrowPair* pairs, long n);
+
+/* O lote precisa ser refeito? Até lá as consultas usam o último, que não
+   conta os empréstimos pendentes. */
+int  cb_stale(const CoBorrow* c);
+
+/* relacionados de um ISBN: busca binária + cópia; retorna quantos */
+int  cb_related(CoBorrow* c, long long isbn, RelatedBook* out, int k);
+
+#endif
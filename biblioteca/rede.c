@@ -0,0 +1,167 @@
+#include "rede.h"
+#include <stdio.h>
+#include <string.h>
+
+#ifdef _WIN32
+
+int net_listen(const char* addr) {
+    (void)addr;
+    printf("Modo servidor indisponível no Windows.\n");
+    return -1;
+}
+
+int net_connect(const char* addr) {
+    (void)addr;
+    printf("Conexão indisponível no Windows.\n");
+    return -1;
+}
+
+void net_cleanup(const char* addr) {
+    (void)addr;
+}
+
+int net_nonblocking(int fd) {
+    (void)fd;
+    return 0;
+}
+
+#else
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#define NET_BACKLOG 128
+
+/* Caminho do socket local, ou NULL se o endereço é TCP */
+static const char* unix_path(const char* addr) {
+    return strncmp(addr, "unix:", 5) == 0 ? addr + 5 : NULL;
+}
+
+/* "[host:]porta" -> host (vazio = 127.0.0.1) e porta */
+static int split_host_port(const char* addr, char* host, size_t host_sz, const char** port) {
+    const char* colon = strrchr(addr, ':');
+    if (!colon) {
+        snprintf(host, host_sz, "127.0.0.1");
+        *port = addr;
+        return 1;
+    }
+    size_t n = (size_t)(colon - addr);
+    if (n >= host_sz) return 0;
+    memcpy(host, addr, n);
+    host[n] = '\0';
+    if (n == 0) snprintf(host, host_sz, "127.0.0.1");
+    *port = colon + 1;
+    return **port != '\0';
+}
+
+int net_nonblocking(int fd) {
+    int fl = fcntl(fd, F_GETFL, 0);
+    return fl >= 0 && fcntl(fd, F_SETFL, fl | O_NONBLOCK) == 0;
+}
+
+static int unix_socket(const char* path, struct sockaddr_un* sa) {
+    if (strlen(path) >= sizeof(sa->sun_path)) {
+        printf("Caminho do socket longo demais: %s\n", path);
+        return -1;
+    }
+    memset(sa, 0, sizeof(*sa));
+    sa->sun_family = AF_UNIX;
+    strcpy(sa->sun_path, path);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) printf("Erro ao criar o socket.\n");
+    return fd;
+}
+
+/* Resolve host:porta e escuta (passive) ou conecta no primeiro endereço
+   que der certo */
+static int tcp_socket(const char* addr, int passive) {
+    char host[256];
+    const char* port;
+    if (!split_host_port(addr, host, sizeof(host), &port)) {
+        printf("Endereço inválido: %s\n", addr);
+        return -1;
+    }
+
+    struct addrinfo hints, *res = NULL;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    if (passive) hints.ai_flags = AI_PASSIVE;
+    if (getaddrinfo(host, port, &hints, &res) != 0) {
+        printf("Endereço inválido: %s\n", addr);
+        return -1;
+    }
+
+    int fd = -1;
+    for (struct addrinfo* ai = res; ai; ai = ai->ai_next) {
+        fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (fd < 0) continue;
+        int one = 1;
+        int ok;
+        if (passive) {
+            setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+            ok = bind(fd, ai->ai_addr, ai->ai_addrlen) == 0 && listen(fd, NET_BACKLOG) == 0;
+        } else {
+            ok = connect(fd, ai->ai_addr, ai->ai_addrlen) == 0;
+            /* pedidos pequenos: não esperar juntar (Nagle) */
+            if (ok) setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        }
+        if (ok) break;
+        close(fd);
+        fd = -1;
+    }
+    freeaddrinfo(res);
+    if (fd < 0) printf("Erro ao %s %s.\n", passive ? "abrir" : "conectar em", addr);
+    return fd;
+}
+
+int net_listen(const char* addr) {
+    int fd;
+    const char* path = unix_path(addr);
+    if (path) {
+        struct sockaddr_un sa;
+        fd = unix_socket(path, &sa);
+        if (fd < 0) return -1;
+        unlink(path);   /* sobra de uma execução anterior */
+        if (bind(fd, (struct sockaddr*)&sa, sizeof(sa)) != 0 || listen(fd, NET_BACKLOG) != 0) {
+            printf("Erro ao abrir %s.\n", addr);
+            close(fd);
+            return -1;
+        }
+    } else {
+        fd = tcp_socket(addr, 1);
+        if (fd < 0) return -1;
+    }
+    if (!net_nonblocking(fd)) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int net_connect(const char* addr) {
+    const char* path = unix_path(addr);
+    if (!path) return tcp_socket(addr, 0);
+
+    struct sockaddr_un sa;
+    int fd = unix_socket(path, &sa);
+    if (fd < 0) return -1;
+    if (connect(fd, (struct sockaddr*)&sa, sizeof(sa)) != 0) {
+        printf("Erro ao conectar em %s.\n", addr);
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+void net_cleanup(const char* addr) {
+    const char* path = unix_path(addr);
+    if (path) unlink(path);
+}
+
+#endif
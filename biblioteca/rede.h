@@ -0,0 +1,15 @@
+#ifndef REDE_H
+#define REDE_H
+
+/* Sockets do modo servidor e do gerador de carga.
+
+   Endereço: "unix:/caminho" (socket local) ou "[host:]porta" (TCP). Sem
+   host, só a própria máquina (127.0.0.1); "0.0.0.0:porta" abre para a
+   rede. */
+
+int  net_listen(const char* addr);    /* não bloqueante; -1 = erro (já avisado) */
+int  net_connect(const char* addr);   /* bloqueante; -1 = erro (já avisado) */
+void net_cleanup(const char* addr);   /* apaga o arquivo do socket local */
+int  net_nonblocking(int fd);         /* 1 = ok */
+
+#endif
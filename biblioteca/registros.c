@@ -0,0 +1,88 @@
+#include "registros.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* ---------- Funções auxiliares ---------- */
+
+static void push_slot(long** arr, long* n, long* cap, long slot) {
+    if (*n == *cap) {
+        long nc = *cap ? *cap * 2 : 16;
+        long* tmp = (long*)realloc(*arr, (size_t)nc * sizeof(long));
+        if (!tmp) {
+            printf("Erro: sem memória.\n");
+            exit(1);
+        }
+        *arr = tmp;
+        *cap = nc;
+    }
+    (*arr)[(*n)++] = slot;
+}
+
+/* ---------- Mapa de slots ---------- */
+
+void sm_init(SlotMap* m) {
+    memset(m, 0, sizeof(*m));
+}
+
+void sm_free(SlotMap* m) {
+    free(m->free_slots);
+    free(m->dead);
+    sm_init(m);
+}
+
+void sm_loaded_free(SlotMap* m, long slot) {
+    push_slot(&m->free_slots, &m->n_free, &m->cap_free, slot);
+}
+
+void sm_release(SlotMap* m, long slot) {
+    if (slot >= 0) push_slot(&m->dead, &m->n_dead, &m->cap_dead, slot);
+}
+
+long sm_begin(SlotMap* m) {
+    long mark = m->n_free;
+    for (long i = 0; i < m->n_dead; i++) {
+        push_slot(&m->free_slots, &m->n_free, &m->cap_free, m->dead[i]);
+    }
+    m->n_dead = 0;
+    return mark;
+}
+
+long sm_take(SlotMap* m) {
+    /* as vagas abertas neste save saem primeiro: dispensam a lápide */
+    if (m->n_free > 0) return m->free_slots[--m->n_free];
+    return m->n_slots++;
+}
+
+void sm_tombstones(SlotMap* m, long mark, SlotPatch* p, const void* tomb) {
+    long from = m->full ? 0 : mark;
+    for (long i = from; i < m->n_free; i++) sp_put(p, m->free_slots[i], tomb);
+    m->full = 0;
+}
+
+/* ---------- Remendos ---------- */
+
+void sp_init(SlotPatch* p, size_t rec_size) {
+    p->data = NULL;
+    p->len = p->cap = 0;
+    p->rec_size = rec_size;
+}
+
+void sp_put(SlotPatch* p, long slot, const void* rec) {
+    size_t need = sizeof(long long) + p->rec_size;
+    if (p->len + need > p->cap) {
+        size_t nc = p->cap ? p->cap * 2 : 4096;
+        while (nc < p->len + need) nc *= 2;
+        unsigned char* tmp = (unsigned char*)realloc(p->data, nc);
+        if (!tmp) {
+            printf("Erro: sem memória.\n");
+            exit(1);
+        }
+        p->data = tmp;
+        p->cap = nc;
+    }
+    long long s = slot;
+    memcpy(p->data + p->len, &s, sizeof(long long));
+    memcpy(p->data + p->len + sizeof(long long), rec, p->rec_size);
+    p->len += need;
+}
@@ -0,0 +1,47 @@
+#ifndef REGISTROS_H
+#define REGISTROS_H
+
+#include <stddef.h>
+
+/* Arquivo de registros de tamanho fixo gravado aos pedaços.
+   Cada registro tem um slot (posição no arquivo). Um save só escreve, no
+   próprio slot, os registros alterados; registros novos ocupam uma vaga ou
+   vão para o fim; um removido vira lápide e a vaga é reaproveitada. */
+
+typedef struct {
+    long n_slots;        /* slots no arquivo (registros + lápides) */
+    long* free_slots;    /* lápides que podem receber registros novos */
+    long n_free, cap_free;
+    long* dead;          /* slots de registros removidos desde o último save */
+    long n_dead, cap_dead;
+    int full;            /* o próximo save escreve todos os slots */
+} SlotMap;
+
+/* Remendos de um save: vários (long long slot, registro) seguidos */
+typedef struct {
+    unsigned char* data;
+    size_t len, cap;
+    size_t rec_size;
+} SlotPatch;
+
+void sm_init(SlotMap* m);
+void sm_free(SlotMap* m);
+
+/* Carga: o slot lido era lápide (vaga livre) */
+void sm_loaded_free(SlotMap* m, long slot);
+/* Registro removido (slot < 0 = nunca foi gravado) */
+void sm_release(SlotMap* m, long slot);
+
+/* Início de um save: os removidos viram vagas. Retorna a marca a passar
+   para sm_tombstones. */
+long sm_begin(SlotMap* m);
+/* Slot para um registro novo */
+long sm_take(SlotMap* m);
+/* Fim de um save: lápide em cada vaga aberta neste save (ou em todas, se
+   for um save completo) */
+void sm_tombstones(SlotMap* m, long mark, SlotPatch* p, const void* tomb);
+
+void sp_init(SlotPatch* p, size_t rec_size);
+void sp_put(SlotPatch* p, long slot, const void* rec);
+
+#endif
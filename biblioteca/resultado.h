@@ -0,0 +1,33 @@
+#ifndef RESULTADO_H
+#define RESULTADO_H
+
+/* Resultado das operações do motor (motor.h) e do sistema de empréstimos.
+   Nenhuma delas escreve na tela: quem chama decide a mensagem. */
+
+typedef enum {
+    BIB_OK = 0,
+    BIB_QUEUED,            /* sem exemplar: o usuário entrou na fila */
+    BIB_ALREADY_QUEUED,    /* já estava na fila desse livro */
+    BIB_ALREADY_BORROWED,  /* já está com esse livro */
+    BIB_NO_USER,           /* usuário não existe */
+    BIB_NO_BOOK,           /* livro não existe */
+    BIB_NO_LOAN,           /* devolução sem empréstimo ativo */
+    BIB_EXISTS,            /* ISBN ou ID repetido */
+    BIB_HAS_LOANS,         /* remoção recusada: ainda há empréstimo ativo */
+    BIB_CORRUPT,           /* biblioteca.db estragado */
+    BIB_IO_ERROR,          /* erro de gravação */
+    BIB_SAVED              /* bib_tick: terminou a gravação de um bib_save_async */
+} BibStatus;
+
+/* Detalhes de uma operação (todos opcionais para quem chama) */
+typedef struct {
+    int position;          /* lugar na fila (BIB_QUEUED / BIB_ALREADY_QUEUED) */
+    int total;             /* tamanho da fila */
+    int next_user;         /* devolução: primeiro da fila, se havia */
+    int next_state;        /* 0 = fila vazia, 1 = emprestado a next_user,
+                              -1 = next_user não existe mais (ignorado) */
+    int loans;             /* remoção recusada: empréstimos ativos */
+    int dropped;           /* remoção: lugares em filas de espera apagados */
+} BibResult;
+
+#endif
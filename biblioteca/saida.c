@@ -0,0 +1,110 @@
+#include "saida.h"
+#include "plataforma.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+void ob_open(OutBuf* o, int fd, size_t cap) {
+    memset(o, 0, sizeof(*o));
+    if (cap < 64) cap = 64;   /* cabe qualquer número */
+    o->buf = (char*)malloc(cap);
+    if (!o->buf) {
+        printf("Erro: sem memória.\n");
+        exit(1);
+    }
+    o->fd = fd;
+    o->cap = cap;
+}
+
+/* Envia o buffer e, atrás dele, p[0..n) */
+static int ob_send(OutBuf* o, const void* p, size_t n) {
+    if (o->len + n == 0) return 1;
+    if (o->error || plat_write2(o->fd, o->buf, o->len, p, n) != 0) {
+        o->error = 1;
+    } else {
+        o->bytes += o->len + n;
+    }
+    o->len = 0;
+    return !o->error;
+}
+
+int ob_flush(OutBuf* o) {
+    return ob_send(o, NULL, 0);
+}
+
+int ob_close(OutBuf* o) {
+    int ok = ob_flush(o);
+    free(o->buf);
+    o->buf = NULL;
+    o->cap = 0;
+    return ok;
+}
+
+void ob_write(OutBuf* o, const void* p, size_t n) {
+    if (n <= o->cap - o->len) {
+        memcpy(o->buf + o->len, p, n);
+        o->len += n;
+    } else if (n < o->cap / 2) {
+        /* pedaço pequeno: completa o buffer e continua no próximo */
+        size_t room = o->cap - o->len;
+        memcpy(o->buf + o->len, p, room);
+        o->len = o->cap;
+        ob_flush(o);
+        memcpy(o->buf, (const char*)p + room, n - room);
+        o->len = n - room;
+    } else {
+        ob_send(o, p, n);
+    }
+}
+
+void ob_str(OutBuf* o, const char* s) {
+    size_t n = strlen(s);
+    if (n <= o->cap - o->len) {
+        memcpy(o->buf + o->len, s, n);
+        o->len += n;
+    } else {
+        ob_write(o, s, n);
+    }
+}
+
+/* Dígitos de v no fim de tmp[24]; retorna onde começam */
+static char* format_ll(char tmp[24], long long v) {
+    char* p = tmp + 24;
+    unsigned long long u = v < 0 ? 0ULL - (unsigned long long)v : (unsigned long long)v;
+    /* dois dígitos por divisão */
+    static const char pairs[] =
+        "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+        "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+        "8081828384858687888990919293949596979899";
+    while (u >= 100) {
+        unsigned int r = (unsigned int)(u % 100);
+        u /= 100;
+        *--p = pairs[r * 2 + 1];
+        *--p = pairs[r * 2];
+    }
+    if (u >= 10) {
+        *--p = pairs[u * 2 + 1];
+        *--p = pairs[u * 2];
+    } else {
+        *--p = (char)('0' + u);
+    }
+    if (v < 0) *--p = '-';
+    return p;
+}
+
+void ob_ll(OutBuf* o, long long v) {
+    char tmp[24];
+    char* p = format_ll(tmp, v);
+    size_t n = (size_t)(tmp + 24 - p);
+    if (o->cap - o->len < n) ob_flush(o);
+    memcpy(o->buf + o->len, p, n);
+    o->len += n;
+}
+
+void ob_ll_pad(OutBuf* o, long long v, int width) {
+    char tmp[24];
+    char* p = format_ll(tmp, v);
+    int n = (int)(tmp + 24 - p);
+    for (; width > n; width--) ob_char(o, ' ');
+    ob_write(o, p, (size_t)n);
+}
@@ -0,0 +1,43 @@
+#ifndef SAIDA_H
+#define SAIDA_H
+
+#include <stddef.h>
+
+/* Saída em bloco para listagens e exportações grandes.
+
+   printf por linha trava o stdout e interpreta o formato a cada registro;
+   com milhões de livros isso é quase todo o tempo da listagem. Aqui as
+   linhas são montadas à mão num buffer grande (números convertidos sem
+   printf) e o buffer vai para o descritor de uma vez quando enche. Um
+   pedaço maior que o espaço que sobra sai junto com o buffer na mesma
+   chamada (writev), sem ser copiado.
+
+   Quem mistura com printf no mesmo descritor chama fflush antes de
+   ob_open e ob_flush antes de voltar ao printf. */
+
+#define OUT_BUF_SIZE (1 << 20)
+
+typedef struct {
+    int fd;
+    char* buf;
+    size_t len;
+    size_t cap;
+    int error;               /* alguma gravação falhou */
+    unsigned long long bytes; /* total enviado ao descritor */
+} OutBuf;
+
+void ob_open(OutBuf* o, int fd, size_t cap);
+int  ob_close(OutBuf* o);                 /* grava o resto e libera (1 = ok) */
+int  ob_flush(OutBuf* o);                 /* 1 = ok */
+
+void ob_write(OutBuf* o, const void* p, size_t n);
+void ob_str(OutBuf* o, const char* s);
+void ob_ll(OutBuf* o, long long v);              /* decimal, sem printf */
+void ob_ll_pad(OutBuf* o, long long v, int width); /* alinhado à direita */
+
+static inline void ob_char(OutBuf* o, char c) {
+    if (o->len == o->cap) ob_flush(o);
+    o->buf[o->len++] = c;
+}
+
+#endif
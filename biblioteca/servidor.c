@@ -0,0 +1,476 @@
+#include "servidor.h"
+#include <stdio.h>
+
+#ifndef __linux__
+
+int srv_run(Biblioteca* b, const char* addr) {
+    (void)b;
+    (void)addr;
+    printf("Modo servidor disponível só no Linux (epoll).\n");
+    return 0;
+}
+
+#else
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include "protocolo.h"
+#include "rede.h"
+
+#define SRV_EVENTS    256
+#define SRV_READ_MIN  16384        /* espaço livre garantido antes de cada read */
+#define SRV_IN_LIMIT  (1 << 20)    /* lido por volta, por conexão */
+#define SRV_OUT_LIMIT (1 << 20)    /* resposta acumulada que suspende a leitura */
+#define SRV_TICK_MS   1000
+
+typedef struct Conn {
+    int fd;
+    unsigned char* in;
+    size_t in_len, in_cap;
+    unsigned char* out;
+    size_t out_len, out_off, out_cap;
+    unsigned int events;        /* interesse registrado no epoll */
+    int eof;                    /* o cliente fechou o lado dele */
+    int dead;                   /* erro: fechar no fim da volta */
+    int in_work;                /* já está na lista da volta */
+    struct Conn* work_next;
+    struct Conn* prev;          /* todas as conexões abertas */
+    struct Conn* next;
+} Conn;
+
+typedef struct {
+    Biblioteca* b;
+    int ep;
+    int listen_fd;
+    Conn* conns;
+    Conn* backlog;              /* conexões com quadros prontos para a próxima volta */
+    int mutated;                /* alguma alteração nesta volta (esperar o diário) */
+    int journal_warned;         /* a falha do diário já foi avisada */
+    unsigned long long requests;
+    unsigned long long accepted;
+} Server;
+
+static volatile sig_atomic_t srv_stop = 0;
+
+static void on_signal(int sig) {
+    (void)sig;
+    srv_stop = 1;
+}
+
+static void* xrealloc(void* p, size_t n) {
+    void* q = realloc(p, n);
+    if (!q) {
+        printf("Erro: sem memória.\n");
+        exit(1);
+    }
+    return q;
+}
+
+/* ---------- Conexões ---------- */
+
+static void conn_close(Server* s, Conn* c) {
+    if (c->prev) c->prev->next = c->next;
+    else s->conns = c->next;
+    if (c->next) c->next->prev = c->prev;
+    epoll_ctl(s->ep, EPOLL_CTL_DEL, c->fd, NULL);
+    close(c->fd);
+    free(c->in);
+    free(c->out);
+    free(c);
+}
+
+static void conn_accept(Server* s) {
+    while (1) {
+        int fd = accept(s->listen_fd, NULL, NULL);
+        if (fd < 0) return;   /* EAGAIN: acabou a fila; outro erro: tenta na próxima */
+        if (!net_nonblocking(fd)) {
+            close(fd);
+            continue;
+        }
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));   /* falha em socket local */
+
+        Conn* c = (Conn*)calloc(1, sizeof(Conn));
+        if (!c) {
+            printf("Erro: sem memória.\n");
+            exit(1);
+        }
+        c->fd = fd;
+        c->events = EPOLLIN;
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = c->events;
+        ev.data.ptr = c;
+        if (epoll_ctl(s->ep, EPOLL_CTL_ADD, fd, &ev) != 0) {
+            close(fd);
+            free(c);
+            continue;
+        }
+        c->next = s->conns;
+        if (s->conns) s->conns->prev = c;
+        s->conns = c;
+        s->accepted++;
+    }
+}
+
+static size_t out_pending(const Conn* c) {
+    return c->out_len - c->out_off;
+}
+
+/* Lê o que houver, até SRV_IN_LIMIT por volta */
+static void conn_read(Conn* c) {
+    size_t got = 0;
+    while (got < SRV_IN_LIMIT) {
+        if (c->in_cap - c->in_len < SRV_READ_MIN) {
+            c->in_cap = c->in_cap ? c->in_cap * 2 : SRV_READ_MIN * 2;
+            c->in = (unsigned char*)xrealloc(c->in, c->in_cap);
+        }
+        ssize_t r = read(c->fd, c->in + c->in_len, c->in_cap - c->in_len);
+        if (r > 0) {
+            c->in_len += (size_t)r;
+            got += (size_t)r;
+        } else if (r == 0) {
+            c->eof = 1;
+            return;
+        } else {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) c->dead = 1;
+            return;
+        }
+    }
+}
+
+/* Envia o que der sem bloquear */
+static void conn_flush(Conn* c) {
+    while (out_pending(c) > 0) {
+        ssize_t w = send(c->fd, c->out + c->out_off, out_pending(c), MSG_NOSIGNAL);
+        if (w > 0) {
+            c->out_off += (size_t)w;
+        } else {
+            if (w < 0 && errno == EINTR) continue;
+            if (w < 0 && errno != EAGAIN && errno != EWOULDBLOCK) c->dead = 1;
+            break;
+        }
+    }
+    if (c->out_off == c->out_len) {
+        c->out_off = 0;
+        c->out_len = 0;
+    } else if (c->out_off > c->out_cap / 2) {
+        memmove(c->out, c->out + c->out_off, out_pending(c));
+        c->out_len -= c->out_off;
+        c->out_off = 0;
+    }
+}
+
+/* Lê enquanto a saída não acumula; espera poder escrever se sobrou saída */
+static void conn_update_events(Server* s, Conn* c) {
+    unsigned int want = 0;
+    if (!c->eof && out_pending(c) < SRV_OUT_LIMIT) want |= EPOLLIN;
+    if (out_pending(c) > 0) want |= EPOLLOUT;
+    if (want == c->events) return;
+
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = want;
+    ev.data.ptr = c;
+    if (epoll_ctl(s->ep, EPOLL_CTL_MOD, c->fd, &ev) == 0) c->events = want;
+}
+
+/* ---------- Respostas ---------- */
+
+static unsigned char* out_reserve(Conn* c, size_t n) {
+    if (c->out_cap - c->out_len < n) {
+        size_t cap = c->out_cap ? c->out_cap : 4096;
+        while (cap - c->out_len < n) cap *= 2;
+        c->out = (unsigned char*)xrealloc(c->out, cap);
+        c->out_cap = cap;
+    }
+    unsigned char* p = c->out + c->out_len;
+    c->out_len += n;
+    return p;
+}
+
+/* Começa uma resposta; o tamanho é preenchido em resp_end */
+static size_t resp_begin(Conn* c, int status, unsigned int id) {
+    size_t start = c->out_len;
+    unsigned char* p = out_reserve(c, PR_LEN_BYTES + PR_HEAD_BYTES);
+    p[4] = (unsigned char)status;
+    le_put32(p + 5, id);
+    return start;
+}
+
+static void resp_end(Conn* c, size_t start) {
+    le_put32(c->out + start, (unsigned int)(c->out_len - start - PR_LEN_BYTES));
+}
+
+static void put_i32(Conn* c, int v) {
+    le_put32(out_reserve(c, 4), (unsigned int)v);
+}
+
+static void put_i64(Conn* c, long long v) {
+    le_put64(out_reserve(c, 8), (unsigned long long)v);
+}
+
+static void put_text(Conn* c, const char* s) {
+    size_t n = strlen(s);
+    if (n > 0xFFFF) n = 0xFFFF;
+    unsigned char* p = out_reserve(c, 2 + n);
+    le_put16(p, (unsigned int)n);
+    memcpy(p + 2, s, n);
+}
+
+static int clamp_hits(unsigned int max) {
+    return max > PR_MAX_HITS ? PR_MAX_HITS : (int)max;
+}
+
+/* Lista de ISBNs: u32 n, depois n x i64 */
+static size_t hits_begin(Conn* c) {
+    size_t at = c->out_len;
+    out_reserve(c, 4);
+    return at;
+}
+
+static void hits_end(Conn* c, size_t at, unsigned int n) {
+    le_put32(c->out + at, n);
+}
+
+/* Atende um pedido (corpo sem o tamanho) */
+static void handle(Server* s, Conn* c, const unsigned char* body, size_t len) {
+    Biblioteca* b = s->b;
+    int op = body[0];
+    unsigned int id = le_get32(body + 1);
+    const unsigned char* a = body + PR_HEAD_BYTES;
+    size_t alen = len - PR_HEAD_BYTES;
+    BibResult r;
+    size_t start, at;
+    s->requests++;
+
+    switch (op) {
+        case PR_BORROW:
+        case PR_RETURN: {
+            if (alen < 12) break;
+            int user_id = (int)le_get32(a);
+            long long isbn = (long long)le_get64(a + 4);
+            BibStatus st = op == PR_BORROW ? bib_borrow(b, user_id, isbn, &r)
+                                           : bib_return(b, user_id, isbn, &r);
+            s->mutated = 1;
+            start = resp_begin(c, st, id);
+            if (op == PR_BORROW) {
+                put_i32(c, r.position);
+                put_i32(c, r.total);
+            } else {
+                put_i32(c, r.next_user);
+                put_i32(c, r.next_state);
+            }
+            resp_end(c, start);
+            return;
+        }
+
+        case PR_LOOKUP: {
+            if (alen < 8) break;
+            const Book* bk = bib_find_book(b, (long long)le_get64(a));
+            start = resp_begin(c, bk ? BIB_OK : BIB_NO_BOOK, id);
+            if (bk) {
+                put_i64(c, bk->isbn);
+                put_i32(c, bk->year);
+                put_i32(c, bk->copies_available);
+                put_i32(c, bk->copies_total);
+                put_i32(c, bk->times_borrowed);
+                put_text(c, bk->title);
+                put_text(c, bk->author);
+            }
+            resp_end(c, start);
+            return;
+        }
+
+        case PR_SEARCH: {
+            if (alen < 2) break;
+            int max = clamp_hits(le_get16(a));
+            char word[64];
+            size_t wl = alen - 2 < sizeof(word) - 1 ? alen - 2 : sizeof(word) - 1;
+            memcpy(word, a + 2, wl);
+            word[wl] = '\0';
+
+            TextIter it;
+            const Book* bk;
+            unsigned int n = 0;
+            bib_text_search(b, word, &it);
+            start = resp_begin(c, BIB_OK, id);
+            at = hits_begin(c);
+            while ((int)n < max && (bk = bib_text_next(&it)) != NULL) {
+                put_i64(c, bk->isbn);
+                n++;
+            }
+            hits_end(c, at, n);
+            resp_end(c, start);
+            return;
+        }
+
+        case PR_RANGE: {
+            if (alen < 18) break;
+            long long lo = (long long)le_get64(a);
+            long long hi = (long long)le_get64(a + 8);
+            int max = clamp_hits(le_get16(a + 16));
+
+            BptIter it;
+            Book* bk;
+            unsigned int n = 0;
+            bpt_range(bib_isbns(b), lo, hi, &it);
+            start = resp_begin(c, BIB_OK, id);
+            at = hits_begin(c);
+            while ((int)n < max && (bk = bpt_range_next(&it)) != NULL) {
+                put_i64(c, bk->isbn);
+                n++;
+            }
+            hits_end(c, at, n);
+            resp_end(c, start);
+            return;
+        }
+    }
+
+    resp_end(c, resp_begin(c, PR_BAD_REQUEST, id));
+}
+
+/* Atende os quadros completos enquanto a saída não acumula */
+static void conn_process(Server* s, Conn* c) {
+    size_t pos = 0;
+    while (c->in_len - pos >= PR_LEN_BYTES && out_pending(c) < SRV_OUT_LIMIT) {
+        size_t len = le_get32(c->in + pos);
+        if (len < PR_HEAD_BYTES || len > PR_MAX_FRAME) {
+            c->dead = 1;
+            break;
+        }
+        if (c->in_len - pos - PR_LEN_BYTES < len) break;
+        handle(s, c, c->in + pos + PR_LEN_BYTES, len);
+        pos += PR_LEN_BYTES + len;
+    }
+    if (pos > 0) {
+        memmove(c->in, c->in + pos, c->in_len - pos);
+        c->in_len -= pos;
+    }
+}
+
+/* Sobrou quadro completo que só não foi atendido por falta de vez */
+static int conn_has_frame(const Conn* c) {
+    if (c->in_len < PR_LEN_BYTES) return 0;
+    return c->in_len - PR_LEN_BYTES >= le_get32(c->in);
+}
+
+/* ---------- Laço ---------- */
+
+static void work_add(Conn** work, Conn* c) {
+    if (c->in_work) return;
+    c->in_work = 1;
+    c->work_next = *work;
+    *work = c;
+}
+
+static void serve_round(Server* s, struct epoll_event* evs, int n) {
+    Conn* work = s->backlog;
+    s->backlog = NULL;
+    s->mutated = 0;
+
+    for (int i = 0; i < n; i++) {
+        if (evs[i].data.ptr == NULL) {
+            conn_accept(s);
+            continue;
+        }
+        Conn* c = (Conn*)evs[i].data.ptr;
+        if (evs[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) conn_read(c);
+        work_add(&work, c);
+    }
+
+    for (Conn* c = work; c; c = c->work_next) {
+        if (!c->dead) conn_process(s, c);
+    }
+
+    /* alterações da volta inteira: uma espera só pelo diário, e nenhuma
+       resposta sai antes de elas estarem no disco */
+    if (s->mutated && bib_sync(s->b) == BIB_IO_ERROR && !s->journal_warned) {
+        s->journal_warned = 1;
+        printf("Erro: falha ao gravar o diário; alterações novas não estão protegidas.\n");
+        fflush(stdout);
+    }
+
+    Conn* next;
+    for (Conn* c = work; c; c = next) {
+        next = c->work_next;
+        c->in_work = 0;
+        if (!c->dead) conn_flush(c);
+        if (c->dead || (c->eof && out_pending(c) == 0 && !conn_has_frame(c))) {
+            conn_close(s, c);
+            continue;
+        }
+        if (conn_has_frame(c) && out_pending(c) < SRV_OUT_LIMIT) work_add(&s->backlog, c);
+        conn_update_events(s, c);
+    }
+}
+
+int srv_run(Biblioteca* b, const char* addr) {
+    Server s;
+    memset(&s, 0, sizeof(s));
+    s.b = b;
+    s.listen_fd = net_listen(addr);
+    if (s.listen_fd < 0) return 0;
+
+    s.ep = epoll_create1(0);
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.ptr = NULL;   /* NULL = socket de escuta */
+    if (s.ep < 0 || epoll_ctl(s.ep, EPOLL_CTL_ADD, s.listen_fd, &ev) != 0) {
+        printf("Erro ao criar o epoll.\n");
+        close(s.listen_fd);
+        if (s.ep >= 0) close(s.ep);
+        net_cleanup(addr);
+        return 0;
+    }
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_signal;   /* sem SA_RESTART: interrompe o epoll_wait */
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    printf("Servidor em %s (Ctrl+C para parar).\n", addr);
+    fflush(stdout);
+
+    struct epoll_event evs[SRV_EVENTS];
+    while (!srv_stop) {
+        int n = epoll_wait(s.ep, evs, SRV_EVENTS, s.backlog ? 0 : SRV_TICK_MS);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            printf("Erro no epoll_wait.\n");
+            break;
+        }
+        serve_round(&s, evs, n);
+
+        /* checkpoint em segundo plano, como entre as opções do menu */
+        if (bib_tick(b, NULL) == BIB_IO_ERROR) {
+            printf("Aviso: checkpoint falhou; o diário continua valendo.\n");
+            fflush(stdout);
+        }
+    }
+
+    /* o que já foi respondido está no diário; quem ainda está conectado
+       recebe o que sobrou na saída, se couber, e é desconectado */
+    while (s.conns) {
+        conn_flush(s.conns);
+        conn_close(&s, s.conns);
+    }
+    close(s.listen_fd);
+    net_cleanup(addr);
+    printf("\nServidor: %llu pedido(s) em %llu conexão(ões).\n", s.requests, s.accepted);
+    close(s.ep);
+    return 1;
+}
+
+#endif
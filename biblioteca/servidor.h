@@ -0,0 +1,23 @@
+#ifndef SERVIDOR_H
+#define SERVIDOR_H
+
+#include "motor.h"
+
+/* Modo servidor: vários clientes (balcões, totens, o site) ao mesmo tempo
+   pelo protocolo binário de protocolo.h, num laço de eventos (epoll) sem
+   threads por conexão.
+
+   - Sockets não bloqueantes; cada conexão tem um buffer de entrada e um
+     de saída. Todos os quadros completos que chegaram são atendidos na
+     mesma volta do laço (pipelining).
+   - Empréstimos e devoluções da volta inteira, de todas as conexões,
+     esperam uma gravação só do diário (bib_sync) antes de as respostas
+     saírem.
+   - Uma conexão com muita resposta acumulada para de ser lida até o
+     cliente consumir (o TCP segura o resto).
+
+   Roda até SIGINT/SIGTERM; 0 = não conseguiu abrir o endereço (rede.h). */
+
+int srv_run(Biblioteca* b, const char* addr);
+
+#endif
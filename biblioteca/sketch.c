@@ -0,0 +1,505 @@
+#include "sketch.h"
+#include "plataforma.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+
+#define SKETCH_MAGIC   0x31544B53u /* "SKT1" */
+#define SKETCH_VERSION 3u   /* 2: marca do histórico depois de 'events';
+                               3: parte local e parte mesclada */
+
+/* ---------- Hash ---------- */
+
+/* finalizador do splitmix64 */
+static unsigned long long mix64(unsigned long long x) {
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+static unsigned long long key_isbn(long long isbn) {
+    return mix64((unsigned long long)isbn ^ 0x1B00C0FFEEULL);
+}
+
+static unsigned long long key_user(int user_id) {
+    return mix64((unsigned long long)(unsigned int)user_id ^ 0x05E2000000ULL);
+}
+
+/* FNV-1a sobre letras/números em minúsculas (ignora espaços e pontuação) */
+static unsigned long long key_author(const char* s) {
+    unsigned long long h = 0xcbf29ce484222325ULL;
+    for (; *s; s++) {
+        unsigned char c = (unsigned char)*s;
+        if (!isalnum(c)) continue;
+        h ^= (unsigned long long)tolower(c);
+        h *= 0x100000001b3ULL;
+    }
+    return mix64(h);
+}
+
+/* coluna da linha 'row' para a chave */
+static int row_col(unsigned long long key, int row, int width) {
+    unsigned long long h = mix64(key + (unsigned long long)(row + 1) * 0x9E3779B97F4A7C15ULL);
+    return (int)(h % (unsigned long long)width);
+}
+
+/* ---------- HyperLogLog ---------- */
+
+static void hll_add(unsigned char* reg, int p, unsigned long long h) {
+    int idx = (int)(h >> (64 - p));
+    unsigned long long w = h << p;
+    int rank = w ? __builtin_clzll(w) + 1 : 64 - p + 1;
+    if (rank > reg[idx]) reg[idx] = (unsigned char)rank;
+}
+
+static double hll_count(const unsigned char* reg, int p) {
+    int m = 1 << p;
+    double alpha;
+    if (m == 16) alpha = 0.673;
+    else if (m == 32) alpha = 0.697;
+    else if (m == 64) alpha = 0.709;
+    else alpha = 0.7213 / (1.0 + 1.079 / m);
+
+    double sum = 0.0;
+    int zeros = 0;
+    for (int i = 0; i < m; i++) {
+        sum += ldexp(1.0, -reg[i]);
+        if (reg[i] == 0) zeros++;
+    }
+
+    double e = alpha * m * m / sum;
+    /* faixa pequena: contagem linear é mais precisa */
+    if (e <= 2.5 * m && zeros > 0) e = m * log((double)m / zeros);
+    return e;
+}
+
+static void hll_merge(unsigned char* dst, const unsigned char* src, int m) {
+    for (int i = 0; i < m; i++) {
+        if (src[i] > dst[i]) dst[i] = src[i];
+    }
+}
+
+/* ---------- Count-Min ---------- */
+
+static int cms_init(CountMin* c) {
+    c->total = 0;
+    c->cells = (unsigned int*)calloc((size_t)CMS_DEPTH * CMS_WIDTH, sizeof(unsigned int));
+    return c->cells != NULL;
+}
+
+static void cms_add(CountMin* c, unsigned long long key) {
+    for (int r = 0; r < CMS_DEPTH; r++) {
+        unsigned int* cell = &c->cells[r * CMS_WIDTH + row_col(key, r, CMS_WIDTH)];
+        if (*cell != 0xFFFFFFFFu) (*cell)++;
+    }
+    c->total++;
+}
+
+static unsigned int cms_estimate(const CountMin* c, unsigned long long key) {
+    unsigned int best = 0xFFFFFFFFu;
+    for (int r = 0; r < CMS_DEPTH; r++) {
+        unsigned int v = c->cells[r * CMS_WIDTH + row_col(key, r, CMS_WIDTH)];
+        if (v < best) best = v;
+    }
+    return best;
+}
+
+static void cms_merge(CountMin* dst, const CountMin* src) {
+    for (int i = 0; i < CMS_DEPTH * CMS_WIDTH; i++) {
+        unsigned long long v = (unsigned long long)dst->cells[i] + src->cells[i];
+        dst->cells[i] = (v > 0xFFFFFFFFu) ? 0xFFFFFFFFu : (unsigned int)v;
+    }
+    dst->total += src->total;
+}
+
+/* ---------- Matriz de HLLs ---------- */
+
+static int ds_init(DistinctSketch* d) {
+    d->regs = (unsigned char*)calloc((size_t)DS_DEPTH * DS_WIDTH * HLL_REGS, 1);
+    return d->regs != NULL;
+}
+
+static unsigned char* ds_cell(const DistinctSketch* d, unsigned long long key, int row) {
+    return d->regs + ((size_t)row * DS_WIDTH + (size_t)row_col(key, row, DS_WIDTH)) * HLL_REGS;
+}
+
+static void ds_add(DistinctSketch* d, unsigned long long key, unsigned long long item) {
+    for (int r = 0; r < DS_DEPTH; r++) hll_add(ds_cell(d, key, r), HLL_P, item);
+}
+
+static double ds_estimate(const DistinctSketch* d, unsigned long long key) {
+    double best = -1.0;
+    for (int r = 0; r < DS_DEPTH; r++) {
+        double v = hll_count(ds_cell(d, key, r), HLL_P);
+        if (best < 0.0 || v < best) best = v;
+    }
+    return best;
+}
+
+/* ---------- Mais populares ---------- */
+
+/* Mantém os HH_CAP candidatos de maior estimativa */
+static void hh_offer(HeavyList* l, unsigned long long key, long long id, const char* label, unsigned int est) {
+    for (int i = 0; i < l->n; i++) {
+        if (l->items[i].key == key) {
+            l->items[i].est = est;
+            return;
+        }
+    }
+
+    int slot = -1;
+    if (l->n < HH_CAP) {
+        slot = l->n++;
+    } else {
+        int min = 0;
+        for (int i = 1; i < l->n; i++) {
+            if (l->items[i].est < l->items[min].est) min = i;
+        }
+        if (est <= l->items[min].est) return;
+        slot = min;
+    }
+
+    HeavyHitter* h = &l->items[slot];
+    h->key = key;
+    h->id = id;
+    h->est = est;
+    h->label[0] = '\0';
+    if (label) {
+        strncpy(h->label, label, sizeof(h->label) - 1);
+        h->label[sizeof(h->label) - 1] = '\0';
+    }
+}
+
+static int cmp_heavy(const void* a, const void* b) {
+    const HeavyHitter* x = (const HeavyHitter*)a;
+    const HeavyHitter* y = (const HeavyHitter*)b;
+    if (x->est != y->est) return (x->est > y->est) ? -1 : 1;
+    return (x->id < y->id) ? -1 : (x->id > y->id);
+}
+
+int an_heavy(const HeavyList* l, int k, HeavyHitter* out) {
+    int n = l->n;
+    memcpy(out, l->items, sizeof(HeavyHitter) * (size_t)n);
+    qsort(out, (size_t)n, sizeof(HeavyHitter), cmp_heavy);
+    return (k < n) ? k : n;
+}
+
+/* ---------- API ---------- */
+
+int an_init(Analytics* a) {
+    memset(a, 0, sizeof(*a));
+    if (!cms_init(&a->books) || !cms_init(&a->authors)) return 0;
+    if (!ds_init(&a->per_book) || !ds_init(&a->per_user)) return 0;
+    return 1;
+}
+
+void an_free(Analytics* a) {
+    if (!a) return;
+    free(a->books.cells);
+    free(a->authors.cells);
+    free(a->per_book.regs);
+    free(a->per_user.regs);
+    a->books.cells = NULL;
+    a->authors.cells = NULL;
+    a->per_book.regs = NULL;
+    a->per_user.regs = NULL;
+}
+
+void an_observe(Analytics* a, int user_id, long long isbn, const char* author) {
+    if (!a || !a->books.cells) return;
+
+    unsigned long long kb = key_isbn(isbn);
+    unsigned long long ku = key_user(user_id);
+
+    cms_add(&a->books, kb);
+    hh_offer(&a->top_books, kb, isbn, NULL, cms_estimate(&a->books, kb));
+
+    if (author && author[0] != '\0') {
+        unsigned long long ka = key_author(author);
+        cms_add(&a->authors, ka);
+        hh_offer(&a->top_authors, ka, 0, author, cms_estimate(&a->authors, ka));
+    }
+
+    ds_add(&a->per_book, kb, ku);
+    ds_add(&a->per_user, ku, kb);
+    hll_add(a->all_users, HLL_GLOBAL_P, ku);
+    hll_add(a->all_books, HLL_GLOBAL_P, kb);
+    a->events++;
+}
+
+unsigned int an_book_borrows(Analytics* a, long long isbn) {
+    return cms_estimate(&a->books, key_isbn(isbn));
+}
+
+unsigned int an_author_borrows(Analytics* a, const char* author) {
+    return cms_estimate(&a->authors, key_author(author));
+}
+
+double an_book_readers(Analytics* a, long long isbn) {
+    return ds_estimate(&a->per_book, key_isbn(isbn));
+}
+
+double an_user_books(Analytics* a, int user_id) {
+    return ds_estimate(&a->per_user, key_user(user_id));
+}
+
+double an_total_users(Analytics* a) {
+    return hll_count(a->all_users, HLL_GLOBAL_P);
+}
+
+double an_total_books(Analytics* a) {
+    return hll_count(a->all_books, HLL_GLOBAL_P);
+}
+
+size_t an_memory(void) {
+    return 2 * (size_t)CMS_DEPTH * CMS_WIDTH * sizeof(unsigned int) +
+           2 * (size_t)DS_DEPTH * DS_WIDTH * HLL_REGS +
+           2 * (size_t)HLL_GLOBAL_REGS + sizeof(Analytics);
+}
+
+/* Refaz as estimativas dos candidatos com o Count-Min já mesclado */
+static void hh_merge(HeavyList* dst, const HeavyList* src, const CountMin* c) {
+    for (int i = 0; i < dst->n; i++) {
+        dst->items[i].est = cms_estimate(c, dst->items[i].key);
+    }
+    for (int i = 0; i < src->n; i++) {
+        const HeavyHitter* h = &src->items[i];
+        hh_offer(dst, h->key, h->id, h->label, cms_estimate(c, h->key));
+    }
+}
+
+void an_merge(Analytics* dst, const Analytics* src) {
+    cms_merge(&dst->books, &src->books);
+    cms_merge(&dst->authors, &src->authors);
+    hh_merge(&dst->top_books, &src->top_books, &dst->books);
+    hh_merge(&dst->top_authors, &src->top_authors, &dst->authors);
+    hll_merge(dst->per_book.regs, src->per_book.regs, DS_DEPTH * DS_WIDTH * HLL_REGS);
+    hll_merge(dst->per_user.regs, src->per_user.regs, DS_DEPTH * DS_WIDTH * HLL_REGS);
+    hll_merge(dst->all_users, src->all_users, HLL_GLOBAL_REGS);
+    hll_merge(dst->all_books, src->all_books, HLL_GLOBAL_REGS);
+    dst->events += src->events;
+}
+
+/* ---------- Arquivo (little-endian) ---------- */
+
+static void put_u32(FILE* f, unsigned int v) {
+    unsigned char b[4];
+    for (int i = 0; i < 4; i++) b[i] = (unsigned char)(v >> (8 * i));
+    fwrite(b, 1, 4, f);
+}
+
+static void put_u64(FILE* f, unsigned long long v) {
+    unsigned char b[8];
+    for (int i = 0; i < 8; i++) b[i] = (unsigned char)(v >> (8 * i));
+    fwrite(b, 1, 8, f);
+}
+
+static int get_u32(FILE* f, unsigned int* v) {
+    unsigned char b[4];
+    if (fread(b, 1, 4, f) != 4) return 0;
+    *v = 0;
+    for (int i = 0; i < 4; i++) *v |= (unsigned int)b[i] << (8 * i);
+    return 1;
+}
+
+static int get_u64(FILE* f, unsigned long long* v) {
+    unsigned char b[8];
+    if (fread(b, 1, 8, f) != 8) return 0;
+    *v = 0;
+    for (int i = 0; i < 8; i++) *v |= (unsigned long long)b[i] << (8 * i);
+    return 1;
+}
+
+static void put_cms(FILE* f, const CountMin* c) {
+    put_u64(f, c->total);
+    for (int i = 0; i < CMS_DEPTH * CMS_WIDTH; i++) put_u32(f, c->cells[i]);
+}
+
+static int get_cms(FILE* f, CountMin* c) {
+    if (!get_u64(f, &c->total)) return 0;
+    for (int i = 0; i < CMS_DEPTH * CMS_WIDTH; i++) {
+        if (!get_u32(f, &c->cells[i])) return 0;
+    }
+    return 1;
+}
+
+static void put_heavy(FILE* f, const HeavyList* l) {
+    put_u32(f, (unsigned int)l->n);
+    for (int i = 0; i < l->n; i++) {
+        put_u64(f, l->items[i].key);
+        put_u64(f, (unsigned long long)l->items[i].id);
+        put_u32(f, l->items[i].est);
+        fwrite(l->items[i].label, 1, sizeof(l->items[i].label), f);
+    }
+}
+
+static int get_heavy(FILE* f, HeavyList* l) {
+    unsigned int n;
+    if (!get_u32(f, &n) || n > HH_CAP) return 0;
+    l->n = (int)n;
+    for (int i = 0; i < l->n; i++) {
+        unsigned long long id;
+        if (!get_u64(f, &l->items[i].key)) return 0;
+        if (!get_u64(f, &id)) return 0;
+        if (!get_u32(f, &l->items[i].est)) return 0;
+        if (fread(l->items[i].label, 1, sizeof(l->items[i].label), f) != sizeof(l->items[i].label)) return 0;
+        l->items[i].label[sizeof(l->items[i].label) - 1] = '\0';
+        l->items[i].id = (long long)id;
+    }
+    return 1;
+}
+
+/* Uma parte do arquivo: contagens, marca do histórico e esboços */
+static void put_section(FILE* f, const Analytics* a) {
+    put_u64(f, a->events);
+    put_u64(f, a->hist_seq);
+
+    put_cms(f, &a->books);
+    put_cms(f, &a->authors);
+    put_heavy(f, &a->top_books);
+    put_heavy(f, &a->top_authors);
+
+    /* registradores HLL são bytes: não dependem de endianness */
+    fwrite(a->per_book.regs, 1, (size_t)DS_DEPTH * DS_WIDTH * HLL_REGS, f);
+    fwrite(a->per_user.regs, 1, (size_t)DS_DEPTH * DS_WIDTH * HLL_REGS, f);
+    fwrite(a->all_users, 1, HLL_GLOBAL_REGS, f);
+    fwrite(a->all_books, 1, HLL_GLOBAL_REGS, f);
+}
+
+static int get_section(FILE* f, Analytics* a) {
+    size_t ds_bytes = (size_t)DS_DEPTH * DS_WIDTH * HLL_REGS;
+    return get_u64(f, &a->events) &&
+           get_u64(f, &a->hist_seq) &&
+           get_cms(f, &a->books) &&
+           get_cms(f, &a->authors) &&
+           get_heavy(f, &a->top_books) &&
+           get_heavy(f, &a->top_authors) &&
+           fread(a->per_book.regs, 1, ds_bytes, f) == ds_bytes &&
+           fread(a->per_user.regs, 1, ds_bytes, f) == ds_bytes &&
+           fread(a->all_users, 1, HLL_GLOBAL_REGS, f) == HLL_GLOBAL_REGS &&
+           fread(a->all_books, 1, HLL_GLOBAL_REGS, f) == HLL_GLOBAL_REGS;
+}
+
+/* zera os contadores (mantém a memória alocada) */
+void an_clear(Analytics* a) {
+    memset(a->books.cells, 0, sizeof(unsigned int) * CMS_DEPTH * CMS_WIDTH);
+    memset(a->authors.cells, 0, sizeof(unsigned int) * CMS_DEPTH * CMS_WIDTH);
+    memset(a->per_book.regs, 0, (size_t)DS_DEPTH * DS_WIDTH * HLL_REGS);
+    memset(a->per_user.regs, 0, (size_t)DS_DEPTH * DS_WIDTH * HLL_REGS);
+    memset(a->all_users, 0, HLL_GLOBAL_REGS);
+    memset(a->all_books, 0, HLL_GLOBAL_REGS);
+    a->books.total = a->authors.total = 0;
+    a->top_books.n = a->top_authors.n = 0;
+    a->events = 0;
+    a->hist_seq = 0;
+}
+
+/* Lê o arquivo: a parte local e, se 'merged' não for NULL, a mesclada.
+   A versão 2 só tem uma parte, lida como local. -1 = arquivo estragado
+   ou com parâmetros diferentes, 0 = não existe, 1 = lido. */
+static int sk_read(const char* path, Analytics* local, Analytics* merged) {
+    FILE* f = fopen(path, "rb");
+    if (!f) return 0;
+
+    unsigned int hdr[8];
+    unsigned int expect[8] = {
+        SKETCH_MAGIC, SKETCH_VERSION, CMS_WIDTH, CMS_DEPTH,
+        DS_WIDTH, DS_DEPTH, HLL_P, HLL_GLOBAL_P
+    };
+    for (int i = 0; i < 8; i++) {
+        /* parâmetros diferentes não podem ser mesclados */
+        if (!get_u32(f, &hdr[i]) ||
+            (hdr[i] != expect[i] && !(i == 1 && hdr[i] == 2u))) {
+            fclose(f);
+            return -1;
+        }
+    }
+
+    int ok = get_section(f, local);
+    if (ok && merged) {
+        if (hdr[1] == 2u) an_clear(merged);
+        else ok = get_section(f, merged);
+    }
+    fclose(f);
+    return ok ? 1 : -1;
+}
+
+/* ---------- Esboços da biblioteca ---------- */
+
+int sk_init(SketchSet* s) {
+    return an_init(&s->local) && an_init(&s->merged) && an_init(&s->view);
+}
+
+void sk_free(SketchSet* s) {
+    an_free(&s->local);
+    an_free(&s->merged);
+    an_free(&s->view);
+}
+
+void sk_observe(SketchSet* s, int user_id, long long isbn, const char* author) {
+    an_observe(&s->local, user_id, isbn, author);
+    an_observe(&s->view, user_id, isbn, author);
+}
+
+void sk_refresh(SketchSet* s) {
+    an_clear(&s->view);
+    an_merge(&s->view, &s->local);
+    an_merge(&s->view, &s->merged);
+}
+
+int sk_save(const SketchSet* s, const char* path) {
+    char tmp[300];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    FILE* f = fopen(tmp, "wb");
+    if (!f) return 0;
+
+    put_u32(f, SKETCH_MAGIC);
+    put_u32(f, SKETCH_VERSION);
+    put_u32(f, CMS_WIDTH);
+    put_u32(f, CMS_DEPTH);
+    put_u32(f, DS_WIDTH);
+    put_u32(f, DS_DEPTH);
+    put_u32(f, HLL_P);
+    put_u32(f, HLL_GLOBAL_P);
+    put_section(f, &s->local);
+    put_section(f, &s->merged);
+
+    /* o arquivo antigo só é trocado depois que o novo está inteiro no disco */
+    int ok = !ferror(f) && plat_sync_file(f) == 0;
+    if (fclose(f) != 0) ok = 0;
+    if (ok && plat_replace(tmp, path) == 0) {
+        plat_sync_dir();
+        return 1;
+    }
+    remove(tmp);
+    return 0;
+}
+
+int sk_load(SketchSet* s, const char* path) {
+    int st = sk_read(path, &s->local, &s->merged);
+    if (st <= 0) {
+        an_clear(&s->local);
+        an_clear(&s->merged);
+    }
+    return st;
+}
+
+int sk_import(SketchSet* s, const char* path) {
+    Analytics other;
+    if (!an_init(&other)) {
+        an_free(&other);
+        return 0;
+    }
+    /* só a parte local da outra filial: o que ela mesclou de outras
+       contaria duas vezes numa troca de mão dupla */
+    int ok = sk_read(path, &other, NULL) == 1;
+    if (ok) {
+        an_merge(&s->merged, &other);
+        an_merge(&s->view, &other);
+    }
+    an_free(&other);
+    return ok;
+}
@@ -0,0 +1,111 @@
+#ifndef SKETCH_H
+#define SKETCH_H
+
+#include <stddef.h>
+
+/* Esboços probabilísticos com memória fixa, independentes do número de
+   eventos, e que podem ser mesclados entre filiais (mesmos parâmetros). */
+
+#define SKETCH_FILE "esbocos.dat"
+
+#define CMS_WIDTH   4096   /* colunas do Count-Min */
+#define CMS_DEPTH   4      /* linhas (funções hash) do Count-Min */
+
+#define HLL_P       6                  /* registradores por célula: 2^6 */
+#define HLL_REGS    (1 << HLL_P)
+#define HLL_GLOBAL_P 12                /* HLL global mais preciso: 2^12 */
+#define HLL_GLOBAL_REGS (1 << HLL_GLOBAL_P)
+
+#define DS_WIDTH    4096   /* colunas da matriz de HLLs */
+#define DS_DEPTH    3
+
+#define HH_CAP      32     /* candidatos a mais populares guardados */
+
+/* Count-Min: estimativa de frequência (nunca subestima) */
+typedef struct {
+    unsigned int* cells;   /* CMS_DEPTH x CMS_WIDTH */
+    unsigned long long total;
+} CountMin;
+
+/* "Count-Min de HyperLogLogs": distintos por chave, com memória fixa.
+   Cada chave cai em uma célula por linha; a estimativa é o mínimo.
+   Como no Count-Min, chaves que dividem a célula somam ruído: o valor é
+   confiável para chaves grandes (livros/usuários muito ativos). */
+typedef struct {
+    unsigned char* regs;   /* DS_DEPTH x DS_WIDTH x HLL_REGS */
+} DistinctSketch;
+
+/* Candidato a mais popular */
+typedef struct {
+    unsigned long long key;
+    long long id;          /* ISBN (livros) ou 0 (autores) */
+    char label[80];        /* nome do autor (autores) */
+    unsigned int est;
+} HeavyHitter;
+
+typedef struct {
+    HeavyHitter items[HH_CAP];
+    int n;
+} HeavyList;
+
+typedef struct {
+    CountMin books;               /* empréstimos por livro */
+    CountMin authors;             /* empréstimos por autor */
+    HeavyList top_books;
+    HeavyList top_authors;
+    DistinctSketch per_book;      /* leitores distintos por livro */
+    DistinctSketch per_user;      /* livros distintos por usuário */
+    unsigned char all_users[HLL_GLOBAL_REGS];
+    unsigned char all_books[HLL_GLOBAL_REGS];
+    unsigned long long events;
+    unsigned long long hist_seq;  /* eventos do histórico já vistos (marca do arquivo) */
+} Analytics;
+
+/* lifecycle */
+int  an_init(Analytics* a);
+void an_free(Analytics* a);
+
+/* registra um empréstimo (author pode ser NULL) */
+void an_observe(Analytics* a, int user_id, long long isbn, const char* author);
+
+/* consultas */
+unsigned int an_book_borrows(Analytics* a, long long isbn);
+unsigned int an_author_borrows(Analytics* a, const char* author);
+double an_book_readers(Analytics* a, long long isbn);     /* leitores distintos */
+double an_user_books(Analytics* a, int user_id);          /* livros distintos */
+double an_total_users(Analytics* a);
+double an_total_books(Analytics* a);
+size_t an_memory(void);                                    /* bytes usados */
+
+/* copia até k candidatos (livros ou autores) em ordem decrescente */
+int  an_heavy(const HeavyList* l, int k, HeavyHitter* out);
+
+/* mescla 'src' em 'dst' (ex.: esboços de outra filial) */
+void an_merge(Analytics* dst, const Analytics* src);
+void an_clear(Analytics* a);    /* zera (mantém a memória) */
+
+/* ---------- Esboços da biblioteca ----------
+   A parte local vem do histórico desta biblioteca e pode ser refeita dele.
+   A mesclada veio de outras filiais e só existe no arquivo: fica separada
+   para que refazer a local não a apague. As consultas leem 'view'. */
+typedef struct {
+    Analytics local;
+    Analytics merged;
+    Analytics view;     /* local + merged */
+} SketchSet;
+
+int  sk_init(SketchSet* s);
+void sk_free(SketchSet* s);
+void sk_observe(SketchSet* s, int user_id, long long isbn, const char* author); /* local e view */
+void sk_refresh(SketchSet* s);  /* refaz a view depois de mexer na parte local */
+
+/* Arquivo (little-endian, com cabeçalho, parâmetros e as duas partes).
+   sk_save grava num .tmp, faz fsync e só então troca o arquivo. */
+int  sk_save(const SketchSet* s, const char* path);
+/* 1 = carregou (sem refazer a view), 0 = não existe, -1 = estragado ou
+   com parâmetros diferentes; nos dois últimos casos fica tudo zerado */
+int  sk_load(SketchSet* s, const char* path);
+/* mescla a parte local do arquivo de outra filial (1 = ok) */
+int  sk_import(SketchSet* s, const char* path);
+
+#endif
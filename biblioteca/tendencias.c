@@ -0,0 +1,434 @@
+#include "tendencias.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+
+#define SECS_PER_DAY 86400LL
+
+/* ---------- Funções auxiliares ---------- */
+
+static void* xmalloc(size_t sz) {
+    void* p = malloc(sz);
+    if (!p) {
+        printf("Erro: sem memória.\n");
+        exit(1);
+    }
+    return p;
+}
+
+/* mesmo misturador de bits usado na hash de livros */
+static unsigned int hash_isbn(long long isbn) {
+    unsigned long long x = (unsigned long long)isbn;
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return (unsigned int)(x & 0xFFFFFFFFu);
+}
+
+static int slot_of(long long day) {
+    return (int)(day % TREND_DAYS);
+}
+
+/* Atualiza o ranking de uma janela (contagem 0 sai do ranking) */
+static void window_set(TopRank* r, long long isbn, int count) {
+    if (count <= 0) {
+        rank_remove(r, isbn);
+    } else if (rank_count(r, isbn) < 0) {
+        rank_add(r, isbn, NULL, count);
+    } else {
+        rank_update(r, isbn, count);
+    }
+}
+
+/* ---------- Heap indexado pela pontuação ---------- */
+
+static int hp_higher(TrendBook* a, TrendBook* b) {
+    if (a->score != b->score) return a->score > b->score;
+    return a->isbn < b->isbn; /* desempate: ISBN menor primeiro */
+}
+
+static void hp_swap(Trending* t, int i, int j) {
+    TrendBook* tmp = t->heap[i];
+    t->heap[i] = t->heap[j];
+    t->heap[j] = tmp;
+    t->heap[i]->heap_pos = i;
+    t->heap[j]->heap_pos = j;
+}
+
+static void hp_up(Trending* t, int i) {
+    while (i > 0) {
+        int p = (i - 1) / 2;
+        if (!hp_higher(t->heap[i], t->heap[p])) break;
+        hp_swap(t, i, p);
+        i = p;
+    }
+}
+
+static void hp_down(Trending* t, int i) {
+    while (1) {
+        int l = 2 * i + 1;
+        int r = 2 * i + 2;
+        int best = i;
+
+        if (l < t->heap_size && hp_higher(t->heap[l], t->heap[best])) best = l;
+        if (r < t->heap_size && hp_higher(t->heap[r], t->heap[best])) best = r;
+
+        if (best == i) break;
+        hp_swap(t, i, best);
+        i = best;
+    }
+}
+
+static void hp_push(Trending* t, TrendBook* b) {
+    if (t->heap_size == t->heap_cap) {
+        int newcap = (t->heap_cap == 0) ? 16 : t->heap_cap * 2;
+        TrendBook** tmp = (TrendBook**)realloc(t->heap, sizeof(TrendBook*) * (size_t)newcap);
+        if (!tmp) {
+            printf("Erro: sem memória.\n");
+            exit(1);
+        }
+        t->heap = tmp;
+        t->heap_cap = newcap;
+    }
+    b->heap_pos = t->heap_size;
+    t->heap[t->heap_size++] = b;
+    hp_up(t, b->heap_pos);
+}
+
+static void hp_remove(Trending* t, TrendBook* b) {
+    int i = b->heap_pos;
+    t->heap_size--;
+    if (i != t->heap_size) {
+        t->heap[i] = t->heap[t->heap_size];
+        t->heap[i]->heap_pos = i;
+        hp_up(t, i);
+        hp_down(t, i);
+    }
+    b->heap_pos = -1;
+}
+
+/* ---------- Livros ---------- */
+
+static TrendBook* book_find(Trending* t, long long isbn) {
+    int idx = (int)(hash_isbn(isbn) % (unsigned int)t->size);
+    for (TrendBook* b = t->table[idx]; b; b = b->hnext) {
+        if (b->isbn == isbn) return b;
+    }
+    return NULL;
+}
+
+/* Dobra a tabela quando fica cheia (um livro por bucket em média) */
+static void table_grow(Trending* t) {
+    int newsize = t->size * 2;
+    TrendBook** nt = (TrendBook**)calloc((size_t)newsize, sizeof(TrendBook*));
+    if (!nt) {
+        printf("Erro: sem memória.\n");
+        exit(1);
+    }
+    for (int i = 0; i < t->size; i++) {
+        TrendBook* b = t->table[i];
+        while (b) {
+            TrendBook* nx = b->hnext;
+            int idx = (int)(hash_isbn(b->isbn) % (unsigned int)newsize);
+            b->hnext = nt[idx];
+            nt[idx] = b;
+            b = nx;
+        }
+    }
+    free(t->table);
+    t->table = nt;
+    t->size = newsize;
+}
+
+static TrendBook* book_get_or_create(Trending* t, long long isbn) {
+    TrendBook* b = book_find(t, isbn);
+    if (b) return b;
+
+    b = (TrendBook*)xmalloc(sizeof(TrendBook));
+    b->isbn = isbn;
+    b->week = 0;
+    b->month = 0;
+    b->score = 0.0;
+    b->last_day = -1;
+    b->last_slot = -1;
+
+    if (t->n >= t->size) table_grow(t);
+    int idx = (int)(hash_isbn(isbn) % (unsigned int)t->size);
+    b->hnext = t->table[idx];
+    t->table[idx] = b;
+    t->n++;
+
+    hp_push(t, b);
+    return b;
+}
+
+/* Livro sem empréstimos nos últimos 30 dias sai do motor */
+static void book_drop(Trending* t, TrendBook* b) {
+    int idx = (int)(hash_isbn(b->isbn) % (unsigned int)t->size);
+    TrendBook* prev = NULL;
+    for (TrendBook* cur = t->table[idx]; cur; cur = cur->hnext) {
+        if (cur == b) {
+            if (prev) prev->hnext = cur->hnext;
+            else t->table[idx] = cur->hnext;
+            break;
+        }
+        prev = cur;
+    }
+    hp_remove(t, b);
+    rank_remove(&t->week, b->isbn);
+    rank_remove(&t->month, b->isbn);
+    t->n--;
+    free(b);
+}
+
+/* ---------- Anel de dias ---------- */
+
+static TrendHit* day_append(TrendDay* d, TrendBook* b) {
+    if (d->n == d->cap) {
+        int newcap = (d->cap == 0) ? 8 : d->cap * 2;
+        TrendHit* tmp = (TrendHit*)realloc(d->hits, sizeof(TrendHit) * (size_t)newcap);
+        if (!tmp) {
+            printf("Erro: sem memória.\n");
+            exit(1);
+        }
+        d->hits = tmp;
+        d->cap = newcap;
+    }
+    TrendHit* h = &d->hits[d->n++];
+    h->book = b;
+    h->count = 0;
+    return h;
+}
+
+/* Passa para o dia seguinte: um dia sai da semana e outro sai do mês */
+static void advance_one(Trending* t) {
+    long long next = t->today + 1;
+
+    /* dia next-7 deixa a janela de 7 dias */
+    TrendDay* w = &t->ring[slot_of(next - TREND_WEEK_DAYS)];
+    if (w->day == next - TREND_WEEK_DAYS) {
+        for (int i = 0; i < w->n; i++) {
+            TrendBook* b = w->hits[i].book;
+            b->week -= w->hits[i].count;
+            window_set(&t->week, b->isbn, b->week);
+        }
+    }
+
+    /* dia next-30 deixa a janela de 30 dias e libera o balde para 'next' */
+    TrendDay* m = &t->ring[slot_of(next)];
+    if (m->day == next - TREND_DAYS) {
+        for (int i = 0; i < m->n; i++) {
+            TrendBook* b = m->hits[i].book;
+            b->month -= m->hits[i].count;
+            if (b->month <= 0) book_drop(t, b);
+            else window_set(&t->month, b->isbn, b->month);
+        }
+    }
+    m->day = next;
+    m->n = 0;
+
+    t->today = next;
+}
+
+/* ---------- API ---------- */
+
+int trend_init(Trending* t, int size) {
+    for (int i = 0; i < TREND_DAYS; i++) {
+        t->ring[i].day = -1;
+        t->ring[i].hits = NULL;
+        t->ring[i].n = 0;
+        t->ring[i].cap = 0;
+    }
+    t->today = -1;
+    t->size = size;
+    t->n = 0;
+    t->heap = NULL;
+    t->heap_size = 0;
+    t->heap_cap = 0;
+    t->epoch = 0;
+
+    t->table = (TrendBook**)calloc((size_t)size, sizeof(TrendBook*));
+    if (!t->table) return 0;
+    if (!rank_init(&t->week, size)) return 0;
+    if (!rank_init(&t->month, size)) return 0;
+    return 1;
+}
+
+void trend_free(Trending* t) {
+    if (!t || !t->table) return;
+
+    for (int i = 0; i < t->size; i++) {
+        TrendBook* b = t->table[i];
+        while (b) {
+            TrendBook* nx = b->hnext;
+            free(b);
+            b = nx;
+        }
+    }
+    for (int i = 0; i < TREND_DAYS; i++) {
+        free(t->ring[i].hits);
+        t->ring[i].hits = NULL;
+        t->ring[i].n = t->ring[i].cap = 0;
+    }
+    free(t->table);
+    free(t->heap);
+    rank_free(&t->week);
+    rank_free(&t->month);
+    t->table = NULL;
+    t->heap = NULL;
+    t->heap_size = t->heap_cap = 0;
+    t->size = 0;
+    t->n = 0;
+}
+
+void trend_advance(Trending* t, long long now) {
+    if (!t || t->today < 0 || now <= 0) return;
+
+    long long day = now / SECS_PER_DAY;
+    /* depois de TREND_DAYS passos todos os baldes já expiraram */
+    int steps = 0;
+    while (t->today < day && steps <= TREND_DAYS) {
+        advance_one(t);
+        steps++;
+    }
+    if (t->today < day) {
+        t->today = day;
+        t->ring[slot_of(day)].day = day;
+        t->ring[slot_of(day)].n = 0;
+    }
+}
+
+void trend_add(Trending* t, long long isbn, long long ts) {
+    if (!t || ts <= 0) return; /* evento sem data (histórico antigo) */
+
+    long long day = ts / SECS_PER_DAY;
+    if (t->today < 0) {
+        t->today = day;
+        t->ring[slot_of(day)].day = day;
+        t->epoch = ts;
+    } else if (day > t->today) {
+        trend_advance(t, ts);
+    }
+
+    /* fora da janela de 30 dias: não conta */
+    if (day <= t->today - TREND_DAYS) return;
+
+    TrendBook* b = book_get_or_create(t, isbn);
+
+    TrendDay* d = &t->ring[slot_of(day)];
+    if (d->day != day) {
+        d->day = day;
+        d->n = 0;
+    }
+
+    TrendHit* hit = NULL;
+    if (b->last_day == day) {
+        hit = &d->hits[b->last_slot];
+    } else if (day > b->last_day) {
+        hit = day_append(d, b);
+        b->last_day = day;
+        b->last_slot = d->n - 1;
+    } else {
+        /* evento fora de ordem: procura o livro no balde daquele dia */
+        for (int i = 0; i < d->n; i++) {
+            if (d->hits[i].book == b) { hit = &d->hits[i]; break; }
+        }
+        if (!hit) hit = day_append(d, b);
+    }
+    hit->count++;
+
+    b->month++;
+    window_set(&t->month, isbn, b->month);
+    if (day > t->today - TREND_WEEK_DAYS) {
+        b->week++;
+        window_set(&t->week, isbn, b->week);
+    }
+
+    /* forward decay: peso 2^((ts - epoch) / meia-vida); a ordem entre os
+       livros não muda com o tempo, então o heap só é tocado no evento */
+    double expo = (double)(ts - t->epoch) / (double)TREND_HALF_LIFE;
+    if (expo > 512.0) {
+        double f = exp2(-expo);
+        for (int i = 0; i < t->heap_size; i++) t->heap[i]->score *= f;
+        t->epoch = ts;
+        expo = 0.0;
+    }
+    b->score += exp2(expo);
+    hp_up(t, b->heap_pos);
+}
+
+/* pontuação trazida para o instante 'now' */
+static double score_at(Trending* t, TrendBook* b, long long now) {
+    return b->score * exp2((double)(t->epoch - now) / (double)TREND_HALF_LIFE);
+}
+
+/* mini-heap de candidatos (posições do heap principal) */
+static void cand_up(Trending* t, int* c, int i) {
+    while (i > 0) {
+        int p = (i - 1) / 2;
+        if (!hp_higher(t->heap[c[i]], t->heap[c[p]])) break;
+        int tmp = c[i]; c[i] = c[p]; c[p] = tmp;
+        i = p;
+    }
+}
+
+static void cand_down(Trending* t, int* c, int n, int i) {
+    while (1) {
+        int l = 2 * i + 1;
+        int r = 2 * i + 2;
+        int best = i;
+
+        if (l < n && hp_higher(t->heap[c[l]], t->heap[c[best]])) best = l;
+        if (r < n && hp_higher(t->heap[c[r]], t->heap[c[best]])) best = r;
+
+        if (best == i) break;
+        int tmp = c[i]; c[i] = c[best]; c[best] = tmp;
+        i = best;
+    }
+}
+
+int trend_top(Trending* t, TrendWindow w, int k, long long now, TrendEntry* out) {
+    if (!t || !t->table || k <= 0) return 0;
+
+    if (w == TREND_WEEK || w == TREND_MONTH) {
+        RankItem** items = (RankItem**)xmalloc(sizeof(RankItem*) * (size_t)k);
+        int n = rank_top(w == TREND_WEEK ? &t->week : &t->month, k, items);
+        for (int i = 0; i < n; i++) {
+            TrendBook* b = book_find(t, items[i]->isbn);
+            out[i].isbn = items[i]->isbn;
+            out[i].count = items[i]->bucket->count;
+            out[i].score = b ? score_at(t, b, now) : 0.0;
+        }
+        free(items);
+        return n;
+    }
+
+    /* decaimento: busca pelos maiores do heap sem alterá-lo, O(K log K).
+       'cand' é um max-heap auxiliar de posições do heap principal. */
+    int* cand = (int*)xmalloc(sizeof(int) * (size_t)(k + 2));
+    int nc = 0, n = 0;
+    if (t->heap_size > 0) cand[nc++] = 0;
+
+    while (nc > 0 && n < k) {
+        int idx = cand[0];
+        cand[0] = cand[--nc];
+        cand_down(t, cand, nc, 0);
+
+        TrendBook* b = t->heap[idx];
+        out[n].isbn = b->isbn;
+        out[n].count = b->month;
+        out[n].score = score_at(t, b, now);
+        n++;
+
+        /* os filhos entram como candidatos */
+        for (int c = 2 * idx + 1; c <= 2 * idx + 2 && c < t->heap_size; c++) {
+            cand[nc] = c;
+            cand_up(t, cand, nc);
+            nc++;
+        }
+    }
+    free(cand);
+    return n;
+}
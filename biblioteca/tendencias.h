@@ -0,0 +1,80 @@
+#ifndef TENDENCIAS_H
+#define TENDENCIAS_H
+
+#include "top_livros.h"
+
+#define TREND_DAYS        30   /* janela maior (dias guardados no anel) */
+#define TREND_WEEK_DAYS   7    /* janela curta */
+#define TREND_HALF_LIFE   (7LL * 86400LL) /* meia-vida do decaimento (segundos) */
+
+/* Janelas que podem ser consultadas */
+typedef enum {
+    TREND_WEEK = 1,   /* últimos 7 dias */
+    TREND_MONTH = 2,  /* últimos 30 dias */
+    TREND_DECAY = 3   /* pontuação com decaimento exponencial */
+} TrendWindow;
+
+/* Estado de um livro que teve empréstimos nos últimos 30 dias */
+typedef struct TrendBook {
+    long long isbn;
+    int week;                  /* empréstimos na janela de 7 dias */
+    int month;                 /* empréstimos na janela de 30 dias */
+    double score;              /* soma com decaimento (escala "forward decay") */
+    int heap_pos;              /* posição no heap de pontuação */
+    long long last_day;        /* último dia em que recebeu evento */
+    int last_slot;             /* posição no balde desse dia */
+    struct TrendBook* hnext;   /* encadeamento na hash por ISBN */
+} TrendBook;
+
+/* Contagem de um livro dentro de um dia */
+typedef struct {
+    TrendBook* book;
+    int count;
+} TrendHit;
+
+/* Um dia do anel: livros que tiveram empréstimo naquele dia */
+typedef struct {
+    long long day;
+    TrendHit* hits;
+    int n;
+    int cap;
+} TrendDay;
+
+/* Resultado de uma consulta */
+typedef struct {
+    long long isbn;
+    int count;      /* empréstimos na janela (semana/mês) */
+    double score;   /* pontuação com decaimento, no instante da consulta */
+} TrendEntry;
+
+typedef struct {
+    TrendDay ring[TREND_DAYS];  /* anel de baldes diários */
+    long long today;            /* dia mais recente já visto (-1 = vazio) */
+
+    TrendBook** table;          /* hash ISBN -> livro (dobra quando enche) */
+    int size;
+    int n;
+
+    TopRank week;               /* baldes por contagem: TOP-K em O(K) */
+    TopRank month;
+
+    TrendBook** heap;           /* max-heap indexado pela pontuação */
+    int heap_size;
+    int heap_cap;
+    long long epoch;            /* referência do decaimento (segundos) */
+} Trending;
+
+/* lifecycle */
+int  trend_init(Trending* t, int size);
+void trend_free(Trending* t);
+
+/* registra um empréstimo do ISBN no instante ts (segundos desde 1970) */
+void trend_add(Trending* t, long long isbn, long long ts);
+
+/* avança o relógio até 'now', expirando os dias que saíram das janelas */
+void trend_advance(Trending* t, long long now);
+
+/* TOP-K da janela pedida (chamar trend_advance antes); retorna quantos */
+int  trend_top(Trending* t, TrendWindow w, int k, long long now, TrendEntry* out);
+
+#endif
@@ -0,0 +1,145 @@
+/* Verificação do Union-Find concorrente (dsu_paralelo.c).
+
+   Sorteia pares e une os mesmos pares no DSU sequencial (dsu_union) e no
+   concorrente (cdsu_union_pairs com 1, 2, 4 e 8 threads). Depois de
+   cdsu_to_dsu, a partição e o tamanho de cada grupo têm que ser iguais
+   aos do sequencial. Os casos vão de poucos pares (quase tudo sozinho) a
+   muitos (um grupo gigante), e cada um roda algumas vezes para dar
+   chance às corridas entre as threads.
+
+   Uso: teste_dsu.exe [semente]        (retorna 0 se tudo bateu) */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "dsu.h"
+#include "dsu_paralelo.h"
+
+#define CHECK_ROUNDS 5
+
+static const int threads[] = {1, 2, 4, 8};
+
+typedef struct {
+    int n;        /* elementos */
+    long pairs;   /* pares unidos */
+} CheckCase;
+
+/* pares >= 8 * 1024 para que cdsu_union_pairs use mesmo as 8 threads */
+static const CheckCase cases[] = {
+    {200000, 20000},    /* esparso: muitos grupos pequenos */
+    {100000, 60000},    /* perto do limiar do grupo gigante */
+    {50000, 400000},    /* denso: quase tudo num grupo */
+    {1000, 100000},     /* poucos elementos, muita disputa pelas raízes */
+};
+
+static void* xmalloc(size_t n) {
+    void* p = malloc(n);
+    if (!p) {
+        printf("Erro: sem memória.\n");
+        exit(1);
+    }
+    return p;
+}
+
+/* xorshift64: mesma sequência para a mesma semente em qualquer plataforma */
+static unsigned long long rng_next(unsigned long long* s) {
+    unsigned long long x = *s;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    *s = x;
+    return x;
+}
+
+/* menor elemento do grupo de cada i: representante que não depende de
+   qual raiz cada versão escolheu */
+static void min_of_group(DSU* d, int* out) {
+    for (int i = 0; i < d->n; i++) out[i] = d->n;
+    for (int i = 0; i < d->n; i++) {
+        int r = dsu_find(d, i);
+        if (i < out[r]) out[r] = i;
+    }
+    for (int i = 0; i < d->n; i++) out[i] = out[dsu_find(d, i)];
+}
+
+/* compara o resultado de nt threads com o sequencial; 1 = igual */
+static int check_threads(const CheckCase* c, const int* a, const int* b,
+                         const int* want_min, DSU* want, int nt) {
+    CDSU cd;
+    DSU got;
+    if (!cdsu_init(&cd, c->n) || !cdsu_union_pairs(&cd, a, b, c->pairs, nt) ||
+        !cdsu_to_dsu(&cd, &got)) {
+        printf("Erro: sem memória.\n");
+        exit(1);
+    }
+    cdsu_free(&cd);
+
+    int* got_min = (int*)xmalloc(sizeof(int) * (size_t)c->n);
+    min_of_group(&got, got_min);
+
+    int ok = 1;
+    for (int i = 0; i < c->n && ok; i++) {
+        if (got_min[i] != want_min[i]) {
+            printf("  %d thread(s): elemento %d no grupo de %d (esperado %d)\n",
+                   nt, i, got_min[i], want_min[i]);
+            ok = 0;
+        } else if (dsu_size(&got, i) != dsu_size(want, i)) {
+            printf("  %d thread(s): grupo de %d com %d elementos (esperado %d)\n",
+                   nt, i, dsu_size(&got, i), dsu_size(want, i));
+            ok = 0;
+        }
+    }
+    free(got_min);
+    dsu_free(&got);
+    return ok;
+}
+
+int main(int argc, char** argv) {
+    unsigned long long seed = argc > 1 ? strtoull(argv[1], NULL, 10) : 20240601ULL;
+    if (seed == 0) seed = 1;   /* xorshift não sai do zero */
+    int ncases = (int)(sizeof(cases) / sizeof(cases[0]));
+    int nthreads = (int)(sizeof(threads) / sizeof(threads[0]));
+    int failed = 0;
+
+    printf("Semente %llu\n", seed);
+    for (int k = 0; k < ncases; k++) {
+        const CheckCase* c = &cases[k];
+        int* a = (int*)xmalloc(sizeof(int) * (size_t)c->pairs);
+        int* b = (int*)xmalloc(sizeof(int) * (size_t)c->pairs);
+        int* want_min = (int*)xmalloc(sizeof(int) * (size_t)c->n);
+        int case_ok = 1;
+
+        for (int round = 0; round < CHECK_ROUNDS; round++) {
+            for (long i = 0; i < c->pairs; i++) {
+                a[i] = (int)(rng_next(&seed) % (unsigned long long)c->n);
+                b[i] = (int)(rng_next(&seed) % (unsigned long long)c->n);
+            }
+
+            DSU want;
+            if (!dsu_init(&want, c->n)) {
+                printf("Erro: sem memória.\n");
+                exit(1);
+            }
+            for (long i = 0; i < c->pairs; i++) dsu_union(&want, a[i], b[i]);
+            min_of_group(&want, want_min);
+
+            for (int t = 0; t < nthreads; t++) {
+                if (!check_threads(c, a, b, want_min, &want, threads[t])) case_ok = 0;
+            }
+            dsu_free(&want);
+        }
+
+        printf("%d elementos, %ld pares (x%d): %s\n", c->n, c->pairs, CHECK_ROUNDS,
+               case_ok ? "ok" : "DIFERENTE");
+        if (!case_ok) failed++;
+        free(a);
+        free(b);
+        free(want_min);
+    }
+
+    if (failed) {
+        printf("%d caso(s) com diferença.\n", failed);
+        return 1;
+    }
+    printf("DSU concorrente igual ao sequencial em todos os casos.\n");
+    return 0;
+}
@@ -61,12 +61,13 @@ static WordEntry* entry_get_or_create(TextIndex* ti, const char* word) {
     ti->buckets[idx] = e;
     return e;
 }
-/* Indexa um texto (título ou autor) em palavras */
-static void index_text(TextIndex* ti, const char* text, long long isbn) {
+/* Próxima palavra de 'text' a partir de *pos, já normalizada em w.
+   Retorna 0 quando acabou. */
+static int next_word(const char* text, size_t* pos, char* w, size_t w_sz) {
     /* quebra em tokens simples por espaço/pontuação */
     char buf[128];
     size_t len = strlen(text);
-    size_t start = 0;
+    size_t start = *pos;
 
     while (start < len) {
         /* pula caracteres que não são letras/números */
@@ -77,22 +78,52 @@ static void index_text(TextIndex* ti, const char* text, long long isbn) {
         while (end < len && isalnum((unsigned char)text[end])) end++;
 
         size_t toklen = end - start;
-        if (toklen > 0) {
-            if (toklen >= sizeof(buf)) toklen = sizeof(buf) - 1;
-            memcpy(buf, text + start, toklen);
-            buf[toklen] = '\0';
-
-            char w[32];
-            normalize_word(w, sizeof(w), buf);
-            if (w[0] != '\0') {
-                WordEntry* e = entry_get_or_create(ti, w);
-                isbn_list_add_unique(&e->isbns, isbn);
-            }
+        if (toklen >= sizeof(buf)) toklen = sizeof(buf) - 1;
+        memcpy(buf, text + start, toklen);
+        buf[toklen] = '\0';
+        start = end + 1;
+
+        normalize_word(w, w_sz, buf);
+        if (w[0] != '\0') {
+            *pos = start;
+            return 1;
         }
+    }
+    *pos = len;
+    return 0;
+}
 
-        start = end + 1;
+/* Indexa um texto (título ou autor) em palavras */
+static void index_text(TextIndex* ti, const char* text, long long isbn) {
+    char w[32];
+    size_t pos = 0;
+    while (next_word(text, &pos, w, sizeof(w))) {
+        WordEntry* e = entry_get_or_create(ti, w);
+        isbn_list_add_unique(&e->isbns, isbn);
+    }
+}
+
+/* Tira o ISBN das palavras de um texto */
+static void unindex_text(TextIndex* ti, const char* text, long long isbn) {
+    char w[32];
+    size_t pos = 0;
+    while (next_word(text, &pos, w, sizeof(w))) {
+        int idx = (int)(hash_word(w) % (unsigned int)ti->size);
+        for (WordEntry* e = ti->buckets[idx]; e; e = e->next) {
+            if (strcmp(e->word, w) != 0) continue;
+            for (IsbnNode** pp = &e->isbns; *pp; pp = &(*pp)->next) {
+                if ((*pp)->isbn == isbn) {
+                    IsbnNode* dead = *pp;
+                    *pp = dead->next;
+                    free(dead);
+                    break;
+                }
+            }
+            break;
+        }
     }
 }
+
 /* Inicializa a tabela hash */
 int ti_init(TextIndex* ti, int size) {
     ti->size = size;
@@ -127,10 +158,31 @@ void ti_free(TextIndex* ti) {
 /* Constrói o índice a partir da lista de livros */
 void ti_build(TextIndex* ti, BookNode* books) {
     for (BookNode* cur = books; cur; cur = cur->next) {
-        index_text(ti, cur->data.title, cur->data.isbn);
-        index_text(ti, cur->data.author, cur->data.isbn);
+        ti_add_book(ti, &cur->data);
     }
 }
+
+void ti_add_book(TextIndex* ti, const Book* b) {
+    index_text(ti, b->title, b->isbn);
+    index_text(ti, b->author, b->isbn);
+}
+
+void ti_remove_book(TextIndex* ti, const Book* b) {
+    unindex_text(ti, b->title, b->isbn);
+    unindex_text(ti, b->author, b->isbn);
+}
+
+int ti_text_has_word(const char* text, const char* word_in) {
+    char q[32], w[32];
+    normalize_word(q, sizeof(q), word_in);
+    if (q[0] == '\0') return 0;
+
+    size_t pos = 0;
+    while (next_word(text, &pos, w, sizeof(w))) {
+        if (strcmp(w, q) == 0) return 1;
+    }
+    return 0;
+}
 /* Busca uma palavra no índice e retorna a lista de ISBNs */
 IsbnNode* ti_find(TextIndex* ti, const char* word_in) {
     if (!ti || !ti->buckets) return NULL;
@@ -147,3 +199,129 @@ IsbnNode* ti_find(TextIndex* ti, const char* word_in) {
     }
     return NULL;
 }
+
+/* ---------- Arquivo ---------- */
+
+static void put_u32(FILE* f, unsigned int v) {
+    unsigned char b[4];
+    for (int i = 0; i < 4; i++) b[i] = (unsigned char)(v >> (8 * i));
+    fwrite(b, 1, 4, f);
+}
+
+static void put_u64(FILE* f, unsigned long long v) {
+    unsigned char b[8];
+    for (int i = 0; i < 8; i++) b[i] = (unsigned char)(v >> (8 * i));
+    fwrite(b, 1, 8, f);
+}
+
+static unsigned int get_u32(const unsigned char* p) {
+    unsigned int v = 0;
+    for (int i = 0; i < 4; i++) v |= (unsigned int)p[i] << (8 * i);
+    return v;
+}
+
+static unsigned long long get_u64(const unsigned char* p) {
+    unsigned long long v = 0;
+    for (int i = 0; i < 8; i++) v |= (unsigned long long)p[i] << (8 * i);
+    return v;
+}
+
+int ti_save(const TextIndex* ti, const char* path, unsigned long long stamp) {
+    FILE* f = fopen(path, "wb");
+    if (!f) {
+        printf("Erro ao abrir %s para escrita.\n", path);
+        return 0;
+    }
+
+    unsigned int n_words = 0;
+    for (int i = 0; i < ti->size; i++) {
+        for (WordEntry* e = ti->buckets[i]; e; e = e->next) if (e->isbns) n_words++;
+    }
+    put_u32(f, TI_MAGIC);
+    put_u32(f, TI_VERSION);
+    put_u64(f, stamp);
+    put_u32(f, n_words);
+
+    /* palavra (tamanho + bytes), quantidade e os ISBNs na ordem da lista */
+    for (int i = 0; i < ti->size; i++) {
+        for (WordEntry* e = ti->buckets[i]; e; e = e->next) {
+            if (!e->isbns) continue;
+            unsigned char len = (unsigned char)strlen(e->word);
+            unsigned int n = 0;
+            for (IsbnNode* c = e->isbns; c; c = c->next) n++;
+            fwrite(&len, 1, 1, f);
+            fwrite(e->word, 1, len, f);
+            put_u32(f, n);
+            for (IsbnNode* c = e->isbns; c; c = c->next) put_u64(f, (unsigned long long)c->isbn);
+        }
+    }
+
+    int ok = !ferror(f);
+    fclose(f);
+    return ok;
+}
+
+int ti_load(TextIndex* ti, const char* path, unsigned long long stamp) {
+    FILE* f = fopen(path, "rb");
+    if (!f) return 0;
+
+    /* o arquivo inteiro de uma vez; depois é só percorrer o buffer */
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    if (size < 20) {
+        fclose(f);
+        return 0;
+    }
+    unsigned char* buf = (unsigned char*)malloc((size_t)size);
+    if (!buf) { printf("Erro: sem memória.\n"); exit(1); }
+    int ok = fread(buf, 1, (size_t)size, f) == (size_t)size;
+    fclose(f);
+
+    /* de outro catálogo (ou de outra versão do formato): não serve */
+    ok = ok && get_u32(buf) == TI_MAGIC && get_u32(buf + 4) == TI_VERSION &&
+         get_u64(buf + 8) == stamp;
+
+    const unsigned char* p = buf + 20;
+    const unsigned char* end = buf + size;
+    unsigned int n_words = ok ? get_u32(buf + 16) : 0;
+    for (unsigned int i = 0; ok && i < n_words; i++) {
+        unsigned int len = end - p >= 1 ? p[0] : 32;
+        if (len == 0 || len >= 32 || end - p < (long)(1 + len + 4)) {
+            ok = 0;
+            break;
+        }
+        char w[32];
+        memcpy(w, p + 1, len);
+        w[len] = '\0';
+        p += 1 + len;
+        unsigned int n = get_u32(p);
+        p += 4;
+        if ((unsigned long long)(end - p) < (unsigned long long)n * 8) {
+            ok = 0;
+            break;
+        }
+
+        WordEntry* e = entry_get_or_create(ti, w);
+        IsbnNode** tail = &e->isbns;
+        while (*tail) tail = &(*tail)->next;
+        for (unsigned int k = 0; k < n; k++, p += 8) {
+            IsbnNode* node = (IsbnNode*)malloc(sizeof(IsbnNode));
+            if (!node) { printf("Erro: sem memória.\n"); exit(1); }
+            node->isbn = (long long)get_u64(p);
+            node->next = NULL;
+            *tail = node;
+            tail = &node->next;
+        }
+    }
+    ok = ok && p == end;
+    free(buf);
+
+    if (!ok) {
+        /* estragado ou velho: volta vazio */
+        int size_b = ti->size;
+        ti_free(ti);
+        ti_init(ti, size_b);
+    }
+    return ok;
+}
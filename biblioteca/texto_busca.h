@@ -3,6 +3,8 @@
 
 #include "livros.h"
 
+#define TI_MAGIC   0x31585449   /* "ITX1" */
+#define TI_VERSION 1
 
 /* Nó da lista ligada de ISBNs */
 typedef struct IsbnNode {
@@ -34,4 +36,18 @@ void ti_build(TextIndex* ti, BookNode* books);
 /* procurar palavra (retorna lista de ISBNs ou NULL) */
 IsbnNode* ti_find(TextIndex* ti, const char* word);
 
+/* Mantém o índice junto com o catálogo */
+void ti_add_book(TextIndex* ti, const Book* b);
+void ti_remove_book(TextIndex* ti, const Book* b);
+
+/* A palavra aparece no texto? (mesma normalização do índice; serve para
+   buscar varrendo a lista enquanto o índice não está pronto) */
+int  ti_text_has_word(const char* text, const char* word);
+
+/* Arquivo do índice, marcado com a versão do catálogo ('stamp').
+   ti_load só aceita o arquivo se a marca for igual; senão deixa o índice
+   vazio e retorna 0. */
+int  ti_save(const TextIndex* ti, const char* path, unsigned long long stamp);
+int  ti_load(TextIndex* ti, const char* path, unsigned long long stamp);
+
 #endif
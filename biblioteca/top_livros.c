@@ -100,13 +100,10 @@ int heap_build_from_list(BookHeap* h, BookNode* head) {
     return 1;
 }
 
-/* Imprime o top K sem destruir o heap original (faz cópia) */
-void heap_print_top(BookHeap* h, int k) {
-    if (!h || h->size == 0) {
-        printf("\n(Nenhum livro no heap)\n");
-        return;
-    }
-    if (k <= 0) return;
+/* Copia o top K para 'out' sem destruir o heap original (faz cópia);
+   retorna quantos */
+int heap_top(BookHeap* h, int k, Book** out) {
+    if (!h || h->size == 0 || k <= 0) return 0;
     if (k > h->size) k = h->size;
     /* Cria cópia do heap */
     BookHeap copy = {0};
@@ -115,18 +112,278 @@ void heap_print_top(BookHeap* h, int k) {
     copy.data = (Book**)malloc(sizeof(Book*) * (size_t)copy.cap);
     if (!copy.data) {
         printf("Erro: sem memória.\n");
-        return;
+        exit(1);
     }
     for (int i = 0; i < h->size; i++) copy.data[i] = h->data[i];
 
-    printf("\n---- TOP %d LIVROS (MAIS EMPRESTADOS) ----\n", k);
-    for (int i = 1; i <= k; i++) {
+    int n = 0;
+    while (n < k) {
         Book* b = heap_pop(&copy);
         if (!b) break;
-        printf("%2d) %I64d | \"%s\" | emprest.: %d | disp: %d/%d\n",
-               i, (long long)b->isbn, b->title,
-               b->times_borrowed, b->copies_available, b->copies_total);
+        out[n++] = b;
     }
 
     heap_free(&copy);
+    return n;
+}
+
+/* ---------- Ranking incremental (baldes por contagem) ---------- */
+
+/* mesmo misturador de bits usado na hash de livros */
+static unsigned int rank_hash(long long isbn) {
+    unsigned long long x = (unsigned long long)isbn;
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return (unsigned int)(x & 0xFFFFFFFFu);
+}
+
+static int rank_index(TopRank* r, long long isbn) {
+    return (int)(rank_hash(isbn) % (unsigned int)r->size);
+}
+
+static RankItem* item_find(TopRank* r, long long isbn) {
+    for (RankItem* it = r->table[rank_index(r, isbn)]; it; it = it->hnext) {
+        if (it->isbn == isbn) return it;
+    }
+    return NULL;
+}
+
+/* Dobra a tabela quando fica cheia (um item por bucket em média), para a
+   busca por ISBN de cada empréstimo não virar uma varredura do catálogo */
+static void rank_grow(TopRank* r) {
+    int newsize = r->size * 2;
+    RankItem** nt = (RankItem**)calloc((size_t)newsize, sizeof(RankItem*));
+    if (!nt) {
+        printf("Erro: sem memória.\n");
+        exit(1);
+    }
+    for (int i = 0; i < r->size; i++) {
+        RankItem* it = r->table[i];
+        while (it) {
+            RankItem* nx = it->hnext;
+            int idx = (int)(rank_hash(it->isbn) % (unsigned int)newsize);
+            it->hnext = nt[idx];
+            nt[idx] = it;
+            it = nx;
+        }
+    }
+    free(r->table);
+    r->table = nt;
+    r->size = newsize;
+}
+
+static RankBucket* bucket_new(int count) {
+    RankBucket* b = (RankBucket*)malloc(sizeof(RankBucket));
+    if (!b) {
+        printf("Erro: sem memória.\n");
+        exit(1);
+    }
+    b->count = count;
+    b->head = b->tail = NULL;
+    b->prev = b->next = NULL;
+    return b;
+}
+
+/* Acha (ou cria) o balde com a contagem pedida, andando a partir de 'near'.
+   Para +1/-1 o balde certo é o próprio vizinho, então custa O(1). */
+static RankBucket* bucket_locate(TopRank* r, RankBucket* near, int count) {
+    RankBucket* b = near ? near : r->bottom;
+    if (!b) {
+        b = bucket_new(count);
+        r->top = r->bottom = b;
+        return b;
+    }
+
+    /* sobe enquanto o balde acima ainda não passa da contagem */
+    while (b->count < count && b->prev && b->prev->count <= count) b = b->prev;
+    /* desce enquanto o balde abaixo ainda não fica menor que a contagem */
+    while (b->count > count && b->next && b->next->count >= count) b = b->next;
+    if (b->count == count) return b;
+
+    RankBucket* nb = bucket_new(count);
+    if (b->count < count) {
+        /* entra logo acima de b */
+        nb->prev = b->prev;
+        nb->next = b;
+        if (b->prev) b->prev->next = nb;
+        else r->top = nb;
+        b->prev = nb;
+    } else {
+        /* entra logo abaixo de b */
+        nb->next = b->next;
+        nb->prev = b;
+        if (b->next) b->next->prev = nb;
+        else r->bottom = nb;
+        b->next = nb;
+    }
+    return nb;
+}
+
+/* Coloca o item no fim do balde (empates: quem chegou antes fica na frente) */
+static void item_append(RankBucket* b, RankItem* it) {
+    it->bucket = b;
+    it->next = NULL;
+    it->prev = b->tail;
+    if (b->tail) b->tail->next = it;
+    else b->head = it;
+    b->tail = it;
+}
+
+/* Tira o item do balde; balde vazio é liberado */
+static void item_unlink(TopRank* r, RankItem* it) {
+    RankBucket* b = it->bucket;
+
+    if (it->prev) it->prev->next = it->next;
+    else b->head = it->next;
+    if (it->next) it->next->prev = it->prev;
+    else b->tail = it->prev;
+
+    it->prev = it->next = NULL;
+    it->bucket = NULL;
+
+    if (!b->head) {
+        if (b->prev) b->prev->next = b->next;
+        else r->top = b->next;
+        if (b->next) b->next->prev = b->prev;
+        else r->bottom = b->prev;
+        free(b);
+    }
+}
+
+int rank_init(TopRank* r, int size) {
+    r->top = r->bottom = NULL;
+    r->n = 0;
+    r->size = size;
+    r->table = (RankItem**)calloc((size_t)size, sizeof(RankItem*));
+    if (!r->table) return 0;
+    return 1;
+}
+
+void rank_free(TopRank* r) {
+    if (!r || !r->table) return;
+
+    RankBucket* b = r->top;
+    while (b) {
+        RankBucket* nb = b->next;
+        RankItem* it = b->head;
+        while (it) {
+            RankItem* nx = it->next;
+            free(it);
+            it = nx;
+        }
+        free(b);
+        b = nb;
+    }
+    free(r->table);
+    r->table = NULL;
+    r->top = r->bottom = NULL;
+    r->size = 0;
+    r->n = 0;
+}
+
+int rank_add(TopRank* r, long long isbn, Book* book, int count) {
+    if (!r || !r->table) return 0;
+    if (item_find(r, isbn)) return 0; /* já existe */
+
+    RankItem* it = (RankItem*)malloc(sizeof(RankItem));
+    if (!it) {
+        printf("Erro: sem memória.\n");
+        exit(1);
+    }
+    it->isbn = isbn;
+    it->book = book;
+    item_append(bucket_locate(r, NULL, count), it);
+
+    if (r->n >= r->size) rank_grow(r);
+    int idx = rank_index(r, isbn);
+    it->hnext = r->table[idx];
+    r->table[idx] = it;
+    r->n++;
+    return 1;
+}
+
+int rank_remove(TopRank* r, long long isbn) {
+    if (!r || !r->table) return 0;
+
+    int idx = rank_index(r, isbn);
+    RankItem* prev = NULL;
+    RankItem* cur = r->table[idx];
+
+    while (cur) {
+        if (cur->isbn == isbn) {
+            if (prev) prev->hnext = cur->hnext;
+            else r->table[idx] = cur->hnext;
+            item_unlink(r, cur);
+            free(cur);
+            r->n--;
+            return 1;
+        }
+        prev = cur;
+        cur = cur->hnext;
+    }
+    return 0;
+}
+
+/* Move o livro para o balde da nova contagem */
+void rank_update(TopRank* r, long long isbn, int count) {
+    if (!r || !r->table) return;
+
+    RankItem* it = item_find(r, isbn);
+    if (!it || it->bucket->count == count) return;
+
+    /* localiza antes de desligar: o balde antigo pode ser liberado */
+    RankBucket* dst = bucket_locate(r, it->bucket, count);
+    item_unlink(r, it);
+    item_append(dst, it);
+}
+
+int rank_count(TopRank* r, long long isbn) {
+    if (!r || !r->table) return -1;
+    RankItem* it = item_find(r, isbn);
+    return it ? it->bucket->count : -1;
+}
+
+int rank_top(TopRank* r, int k, RankItem** out) {
+    int n = 0;
+    if (!r) return 0;
+    for (RankBucket* b = r->top; b && n < k; b = b->next) {
+        for (RankItem* it = b->head; it && n < k; it = it->next) {
+            out[n++] = it;
+        }
+    }
+    return n;
+}
+
+/* ordem inicial igual à do heap: mais emprestado, depois ISBN menor */
+static int cmp_rank_build(const void* a, const void* b) {
+    const Book* x = *(Book* const*)a;
+    const Book* y = *(Book* const*)b;
+    if (x->times_borrowed != y->times_borrowed)
+        return (x->times_borrowed > y->times_borrowed) ? -1 : 1;
+    if (x->isbn != y->isbn) return (x->isbn < y->isbn) ? -1 : 1;
+    return 0;
+}
+
+/* Monta o ranking a partir da lista (uma vez, O(n log n)) */
+int rank_build_from_list(TopRank* r, BookNode* head) {
+    int n = 0;
+    for (BookNode* cur = head; cur; cur = cur->next) n++;
+    if (n == 0) return 1;
+
+    Book** arr = (Book**)malloc(sizeof(Book*) * (size_t)n);
+    if (!arr) return 0;
+
+    int i = 0;
+    for (BookNode* cur = head; cur; cur = cur->next) arr[i++] = &cur->data;
+    qsort(arr, (size_t)n, sizeof(Book*), cmp_rank_build);
+
+    /* em ordem decrescente cada inserção cai no balde de baixo: O(1) */
+    for (i = 0; i < n; i++) {
+        rank_add(r, arr[i]->isbn, arr[i], arr[i]->times_borrowed);
+    }
+    free(arr);
+    return 1;
 }
@@ -21,7 +21,56 @@ Book* heap_peek(BookHeap* h);          /* maior prioridade */
 Book* heap_pop(BookHeap* h);           /* remove maior */
 int   heap_push(BookHeap* h, Book* b); /* insere */
 
-/* imprime TOP-K sem destruir o heap original */
-void heap_print_top(BookHeap* h, int k);
+/* copia até k livros do topo para 'out' sem destruir o heap; retorna quantos */
+int  heap_top(BookHeap* h, int k, Book** out);
+
+/* ---------- Ranking incremental (baldes por contagem) ----------
+   Cada balde guarda os livros com a mesma contagem de empréstimos e os
+   baldes ficam numa lista dupla ordenada (maior contagem primeiro).
+   Um empréstimo move o livro para o balde vizinho em O(1) e o TOP-K é
+   lido direto do topo em O(K), sem reconstruir nem copiar nada. */
+
+struct RankBucket;
+
+typedef struct RankItem {
+    long long isbn;
+    Book* book;                  /* dados do livro (pode ser NULL) */
+    struct RankBucket* bucket;   /* balde da contagem atual */
+    struct RankItem* prev;       /* vizinhos dentro do balde */
+    struct RankItem* next;
+    struct RankItem* hnext;      /* encadeamento na tabela hash por ISBN */
+} RankItem;
+
+typedef struct RankBucket {
+    int count;
+    RankItem* head;
+    RankItem* tail;
+    struct RankBucket* prev;     /* balde de contagem maior */
+    struct RankBucket* next;     /* balde de contagem menor */
+} RankBucket;
+
+typedef struct {
+    RankBucket* top;     /* maior contagem */
+    RankBucket* bottom;  /* menor contagem */
+    RankItem** table;    /* hash ISBN -> item */
+    int size;            /* número de buckets da hash (dobra quando enche) */
+    int n;               /* quantidade de itens */
+} TopRank;
+
+/* lifecycle */
+int  rank_init(TopRank* r, int size);
+void rank_free(TopRank* r);
+
+/* construir a partir da lista (empates: ISBN menor primeiro) */
+int  rank_build_from_list(TopRank* r, BookNode* head);
+
+/* operações */
+int  rank_add(TopRank* r, long long isbn, Book* book, int count); /* 1 se inseriu, 0 se já existia */
+int  rank_remove(TopRank* r, long long isbn);                     /* 1 se removeu, 0 se não achou */
+void rank_update(TopRank* r, long long isbn, int count);         /* O(1) para +1/-1 */
+int  rank_count(TopRank* r, long long isbn);                     /* -1 se não existe */
+
+/* copia até k itens do topo para 'out' (O(K)); retorna quantos */
+int  rank_top(TopRank* r, int k, RankItem** out);
 
 #endif
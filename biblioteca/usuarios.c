@@ -12,6 +12,8 @@ static UserNode* usernode_new(const User* u) {
         exit(1);
     }
     n->data = *u; /* copia os dados do usuário */
+    n->slot = -1;
+    n->dirty = 1;
     n->next = NULL;
     return n;
 }
@@ -33,7 +35,7 @@ void users_push_front(UserNode** head, const User* u) {
     *head = n; /* cabeça passa a ser o novo nó */
 }
 /* Remove um usuário pelo ID */
-int users_remove(UserNode** head, int id) {
+int users_remove(UserNode** head, SlotMap* slots, int id) {
     UserNode* prev = NULL;
     UserNode* cur = *head;
 
@@ -41,6 +43,7 @@ int users_remove(UserNode** head, int id) {
         if (cur->data.id == id) {
             if (prev) prev->next = cur->next; /* remove do meio/fim */
             else *head = cur->next;           /* remove da cabeça */
+            sm_release(slots, cur->slot);    /* vira lápide no próximo save */
             free(cur);
             return 1;
         }
@@ -50,20 +53,6 @@ int users_remove(UserNode** head, int id) {
     return 0;
 }
 
-/* Imprime todos os usuários */
-void users_print(UserNode* head) {
-    if (!head) {
-        printf("\n(Nenhum usuário cadastrado)\n");
-        return;
-    }
-
-    printf("\n---- LISTA DE USUÁRIOS ----\n");
-    for (UserNode* cur = head; cur; cur = cur->next) {
-        User* u = &cur->data;
-        printf("ID: %d | Nome: %s | Email: %s\n", u->id, u->name, u->email);
-    }
-}
-
 void users_free(UserNode* head) {
     while (head) {
         UserNode* next = head->next;
@@ -72,32 +61,102 @@ void users_free(UserNode* head) {
     }
 }
 
-/* ---------- Arquivo ---------- */
-/* Salva todos os usuários em arquivo binário */
-void users_save(UserNode* head) {
-    FILE* f = fopen(USERS_FILE, "wb");
-    if (!f) {
-        printf("Erro ao abrir %s para escrita.\n", USERS_FILE);
-        return;
+void users_touch(UserNode* n) {
+    n->dirty = 1;
+}
+
+/* ---------- Banco ---------- */
+
+/* Registro no banco: little-endian, campos em posição fixa */
+void user_encode(const User* u, unsigned char* p) {
+    memset(p, 0, DB_REC_USER);
+    le_put32(p, (unsigned int)u->id);
+    memcpy(p + 4, u->name, sizeof(u->name));
+    memcpy(p + 84, u->email, sizeof(u->email));
+}
+
+void user_decode(const unsigned char* p, User* u) {
+    u->id = (int)le_get32(p);
+    memcpy(u->name, p + 4, sizeof(u->name));
+    memcpy(u->email, p + 84, sizeof(u->email));
+    u->name[sizeof(u->name) - 1] = '\0';
+    u->email[sizeof(u->email) - 1] = '\0';
+}
+
+/* Registro lido no slot: lápide, duplicado ou usuário */
+static void load_slot(UserNode** head, SlotMap* slots, const User* u) {
+    long slot = slots->n_slots++;
+    if (u->id == USER_TOMBSTONE) {
+        sm_loaded_free(slots, slot);
+    } else if (users_find_by_id(*head, u->id)) {
+        sm_release(slots, slot);   /* duplicado: vira lápide */
+    } else {
+        users_push_front(head, u);
+        (*head)->slot = slot;
+        (*head)->dirty = 0;
     }
+}
+
+UserNode* users_load_db(Db* db, SlotMap* slots) {
+    UserNode* head = NULL;
+    unsigned char buf[64 * DB_REC_USER];
+    DbReader r;
+    size_t got;
+
+    sm_free(slots);
+    db_reader_open(db, DB_USERS, &r);
+    while ((got = db_read(&r, buf, sizeof(buf))) >= DB_REC_USER) {
+        for (size_t off = 0; off + DB_REC_USER <= got; off += DB_REC_USER) {
+            User u;
+            user_decode(buf + off, &u);
+            load_slot(&head, slots, &u);
+        }
+    }
+    return head;
+}
+
+unsigned char* users_changes(UserNode* head, SlotMap* slots, size_t* out_len) {
+    SlotPatch p;
+    sp_init(&p, DB_REC_USER);
+    unsigned char rec[DB_REC_USER];
+
+    long mark = sm_begin(slots);
     for (UserNode* cur = head; cur; cur = cur->next) {
-        fwrite(&cur->data, sizeof(User), 1, f);
+        if (cur->slot < 0) cur->slot = sm_take(slots);
+        else if (!cur->dirty && !slots->full) continue;
+        user_encode(&cur->data, rec);
+        sp_put(&p, cur->slot, rec);
+        cur->dirty = 0;
     }
-    fclose(f);
-    printf("Usuários salvos em %s.\n", USERS_FILE);
+
+    User tomb;
+    memset(&tomb, 0, sizeof(tomb));
+    tomb.id = USER_TOMBSTONE;
+    user_encode(&tomb, rec);
+    sm_tombstones(slots, mark, &p, rec);
+
+    *out_len = p.len;
+    return p.data;
+}
+
+void users_changes_done(SlotMap* slots, int ok) {
+    if (!ok) slots->full = 1;
+}
+
+void users_changes_all(SlotMap* slots) {
+    slots->full = 1;
 }
 /* Carrega os usuários do arquivo binário */
-UserNode* users_load(void) {
+UserNode* users_load(SlotMap* slots) {
     FILE* f = fopen(USERS_FILE, "rb");
     if (!f) return NULL;
 
     UserNode* head = NULL;
     User tmp;
 
+    sm_free(slots);
     while (fread(&tmp, sizeof(User), 1, f) == 1) {
-        if (!users_find_by_id(head, tmp.id)) {
-            users_push_front(&head, &tmp);
-        }
+        load_slot(&head, slots, &tmp);
     }
     fclose(f);
     return head;
@@ -2,8 +2,12 @@
 #define USUARIOS_H
 
 #include <stdio.h>
+#include <limits.h>
+#include "banco.h"
+#include "registros.h"
 
 #define USERS_FILE "usuarios.dat"
+#define USER_TOMBSTONE INT_MIN   /* id de um slot vago no usuarios.dat */
 
 typedef struct {
     int id;
@@ -13,18 +17,31 @@ typedef struct {
 /* Nó da lista encadeada de usuários */
 typedef struct UserNode {
     User data;
+    long slot;             /* slot na tabela de usuários (-1 = ainda não gravado) */
+    int dirty;             /* alterado desde o último save */
     struct UserNode* next; /* ponteiro para o próximo nó */
 } UserNode;
 
 /* Lista */
 UserNode* users_find_by_id(UserNode* head, int id);
 void users_push_front(UserNode** head, const User* u); /* Insere um novo usuário no início da lista */ 
-int  users_remove(UserNode** head, int id); /* Remove um usuário da lista pelo ID */
-void users_print(UserNode* head); /* Imprime todos os usuários da lista */
+int  users_remove(UserNode** head, SlotMap* slots, int id); /* Remove pelo ID (o slot vira lápide) */
 void users_free(UserNode* head); /* Libera toda a memória da lista de usuários */
+void users_touch(UserNode* n); /* Marca o usuário como alterado (entra no próximo save) */
 
-/* Salva todos os usuários no arquivo binário */
-void users_save(UserNode* head);
-UserNode* users_load(void); /* Carrega os usuários do arquivo binário e cria a lista */
+/* Slots no banco: como nos livros (livros.h) */
+UserNode* users_load(SlotMap* slots); /* Carrega os usuários do usuarios.dat antigo (migração) */
+/* Banco (biblioteca.db): lê a tabela de usuários */
+UserNode* users_load_db(Db* db, SlotMap* slots);
+
+/* Registro de DB_REC_USER bytes (little-endian; também usado no diário) */
+void user_encode(const User* u, unsigned char* p);
+void user_decode(const unsigned char* p, User* u);
+
+/* Save incremental: remendos (slot, registro de DB_REC_USER bytes) só do
+   que mudou desde o último save (ver books_changes) */
+unsigned char* users_changes(UserNode* head, SlotMap* slots, size_t* out_len);
+void users_changes_done(SlotMap* slots, int ok);
+void users_changes_all(SlotMap* slots);   /* o próximo save escreve todos os slots */
 
 #endif